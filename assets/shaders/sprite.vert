@@ -3,11 +3,12 @@ layout(location = 0) in vec2 vert;
 layout(location = 1) in vec2 tex;
 
 uniform mat3 trans_mat;
+uniform vec4 uv_rect; // origin xy, size zw of the sprite in its atlas
 
 out vec2 v_tex;
 
 void main() {
   vec3 vPos = trans_mat * vec3(vert, 1.0);
   gl_Position = vec4(vPos.x, vPos.y, 0, 1);
-  v_tex = tex;
+  v_tex = uv_rect.xy + tex * uv_rect.zw;
 }
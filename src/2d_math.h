@@ -3,6 +3,8 @@
 #include <cmath>
 #include <cstring>
 #include <array>
+#include <algorithm>
+#include <functional>
 
 
 class math_consts {
@@ -191,7 +193,7 @@ public:
 
   // Returns this vector projected onto the supplied vector.
   vector_2<T> proj(vector_2<T> const& basis) const {
-    vector_2f norm_basis = basis.normalized();
+    vector_2<T> norm_basis = basis.normalized();
     float magnitude = dot(norm_basis);
     return magnitude * norm_basis;
   }
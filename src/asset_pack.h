@@ -0,0 +1,276 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "text/font_metrics.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// An asset_pack is a single file holding assets already in the form the game uses them,
+// decoded RGBA textures, shader sources and parsed font metrics, so loading one is mapping the file
+// and handing pointers into the mapping to GL.
+// Packs are written by asset_pack_writer, see tools/pack_builder.cpp.
+//
+// Layout, all integers in the builder's native byte order:
+//   asset_pack_header
+//   asset_pack_entry[entry_count] sorted by name
+//   entry data, each entry starting at a multiple of asset_pack_alignment
+// Text entries are followed by a 0 which is not counted in their size so they can be used as c strings.
+
+constexpr uint32_t asset_pack_version = 1;
+constexpr size_t asset_pack_alignment = 16;
+constexpr size_t asset_pack_max_name = 48; // including the 0 suffix
+
+enum class asset_pack_kind : uint32_t {
+  rgba_texture, // width * height * 4 bytes
+  text,
+  prop_font_metrics // a prop_font_metrics
+};
+
+struct asset_pack_header {
+  char magic[4]; // "WMPK"
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t reserved;
+};
+
+struct asset_pack_entry {
+  char name[asset_pack_max_name]; // path relative to the assets directory using '/'
+  asset_pack_kind kind;
+  uint32_t width; // textures only
+  uint32_t height; // textures only
+  uint32_t reserved;
+  uint64_t offset; // from the start of the file
+  uint64_t size; // bytes of data
+
+  std::string_view name_view() const {
+    return { name, strnlen(name, asset_pack_max_name) };
+  }
+};
+
+static_assert(sizeof(asset_pack_header) % asset_pack_alignment == 0, "entries must stay aligned");
+static_assert(sizeof(asset_pack_entry) % asset_pack_alignment == 0, "entries must stay aligned");
+
+class asset_pack {
+private:
+  mapped_file file;
+  asset_pack_entry const* entries = nullptr;
+  uint32_t entry_count = 0;
+
+  bool check_layout() const {
+    if (file.size() < sizeof(asset_pack_header)) {
+      return false;
+    }
+    asset_pack_header const* header = reinterpret_cast<asset_pack_header const*>(file.data());
+    if ((std::memcmp(header->magic, "WMPK", 4) != 0) || (header->version != asset_pack_version)) {
+      return false;
+    }
+    uint64_t table_end = sizeof(asset_pack_header) + uint64_t{ header->entry_count } * sizeof(asset_pack_entry);
+    if (table_end > file.size()) {
+      return false;
+    }
+    asset_pack_entry const* table = reinterpret_cast<asset_pack_entry const*>(file.data() + sizeof(asset_pack_header));
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+      asset_pack_entry const& entry = table[i];
+      uint64_t padded_size = entry.size + ((entry.kind == asset_pack_kind::text) ? 1 : 0);
+      if ((entry.offset < table_end) || (entry.offset % asset_pack_alignment != 0) ||
+          (entry.offset > file.size()) || (padded_size > file.size() - entry.offset)) {
+        return false;
+      }
+      if ((entry.kind == asset_pack_kind::rgba_texture) && (entry.size != uint64_t{ entry.width } * entry.height * 4)) {
+        return false;
+      }
+      if ((entry.kind == asset_pack_kind::prop_font_metrics) && (entry.size != sizeof(prop_font_metrics))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  /*
+  Maps the pack, the pack is invalid if the file is missing or is not a pack of this version.
+  O(entries)
+  */
+  explicit asset_pack(char const* filename) : file(filename) {
+    if (!check_layout()) {
+      file = mapped_file();
+      return;
+    }
+    entry_count = reinterpret_cast<asset_pack_header const*>(file.data())->entry_count;
+    entries = reinterpret_cast<asset_pack_entry const*>(file.data() + sizeof(asset_pack_header));
+  }
+
+  // do not copy or assign, entries point into the mapping
+  asset_pack(asset_pack&) = delete;
+  asset_pack& operator=(const asset_pack&) = delete;
+
+  bool valid() const {
+    return file.valid();
+  }
+
+  size_t size() const {
+    return entry_count;
+  }
+
+  asset_pack_entry const& entry_at(size_t idx) const {
+    assert(idx < entry_count);
+    return entries[idx];
+  }
+
+  /*
+  Returns the entry with the given name or null.
+  O(log(entries))
+  */
+  asset_pack_entry const* find(std::string_view name) const {
+    asset_pack_entry const* end = entries + entry_count;
+    asset_pack_entry const* it = std::lower_bound(entries, end, name, [](asset_pack_entry const& entry, std::string_view target) {
+      return (entry.name_view() < target);
+    });
+    if ((it == end) || (it->name_view() != name)) {
+      return nullptr;
+    }
+    return it;
+  }
+
+  unsigned char const* entry_data(asset_pack_entry const& entry) const {
+    return file.data() + entry.offset;
+  }
+
+  /*
+  Returns the entry's text followed by a 0, or null if there is no such text entry.
+  O(log(entries))
+  */
+  char const* find_text(std::string_view name) const {
+    asset_pack_entry const* entry = find(name);
+    if ((entry == nullptr) || (entry->kind != asset_pack_kind::text)) {
+      return nullptr;
+    }
+    return reinterpret_cast<char const*>(entry_data(*entry));
+  }
+
+  /*
+  Returns the texture entry with the given name or null.
+  O(log(entries))
+  */
+  asset_pack_entry const* find_texture(std::string_view name) const {
+    asset_pack_entry const* entry = find(name);
+    if ((entry == nullptr) || (entry->kind != asset_pack_kind::rgba_texture)) {
+      return nullptr;
+    }
+    return entry;
+  }
+
+  /*
+  Returns the font metrics with the given name or null.
+  O(log(entries))
+  */
+  prop_font_metrics const* find_prop_font_metrics(std::string_view name) const {
+    asset_pack_entry const* entry = find(name);
+    if ((entry == nullptr) || (entry->kind != asset_pack_kind::prop_font_metrics)) {
+      return nullptr;
+    }
+    return reinterpret_cast<prop_font_metrics const*>(entry_data(*entry));
+  }
+};
+
+// Collects assets in memory and writes them out as an asset_pack.
+class asset_pack_writer {
+private:
+  struct pending_entry {
+    asset_pack_entry entry;
+    std::vector<unsigned char> bytes;
+  };
+
+  std::vector<pending_entry> pending;
+
+  bool add(std::string_view name, asset_pack_kind kind, uint32_t width, uint32_t height, void const* data, size_t size) {
+    if (name.size() >= asset_pack_max_name) {
+      fprintf(stderr, "Asset name too long for a pack %.*s\n", static_cast<int>(name.size()), name.data());
+      return false;
+    }
+    pending_entry added{};
+    std::memcpy(added.entry.name, name.data(), name.size());
+    added.entry.kind = kind;
+    added.entry.width = width;
+    added.entry.height = height;
+    added.entry.size = size;
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    added.bytes.assign(bytes, bytes + size);
+    if (kind == asset_pack_kind::text) {
+      added.bytes.push_back(0);
+    }
+    pending.push_back(std::move(added));
+    return true;
+  }
+
+  static uint64_t align_up(uint64_t offset) {
+    return (offset + (asset_pack_alignment - 1)) / asset_pack_alignment * asset_pack_alignment;
+  }
+
+public:
+  bool add_texture(std::string_view name, uint32_t width, uint32_t height, unsigned char const* rgba) {
+    return add(name, asset_pack_kind::rgba_texture, width, height, rgba, size_t{ width } * height * 4);
+  }
+
+  bool add_text(std::string_view name, std::string_view text) {
+    return add(name, asset_pack_kind::text, 0, 0, text.data(), text.size());
+  }
+
+  bool add_prop_font_metrics(std::string_view name, prop_font_metrics const& metrics) {
+    return add(name, asset_pack_kind::prop_font_metrics, 0, 0, &metrics, sizeof(metrics));
+  }
+
+  /*
+  Writes the pack, returning false if the file could not be written or two assets share a name.
+  O(n log n)
+  */
+  bool write(char const* filename) {
+    std::sort(pending.begin(), pending.end(), [](pending_entry const& left, pending_entry const& right) {
+      return (left.entry.name_view() < right.entry.name_view());
+    });
+    for (size_t i = 1; i < pending.size(); i++) {
+      if (pending[i - 1].entry.name_view() == pending[i].entry.name_view()) {
+        fprintf(stderr, "Asset %s is in the pack twice\n", pending[i].entry.name);
+        return false;
+      }
+    }
+
+    uint64_t offset = sizeof(asset_pack_header) + pending.size() * sizeof(asset_pack_entry);
+    for (pending_entry& p : pending) {
+      offset = align_up(offset);
+      p.entry.offset = offset;
+      offset += p.bytes.size();
+    }
+
+    FILE* out = fopen(filename, "wb");
+    if (out == nullptr) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+      return false;
+    }
+    asset_pack_header header{};
+    std::memcpy(header.magic, "WMPK", 4);
+    header.version = asset_pack_version;
+    header.entry_count = static_cast<uint32_t>(pending.size());
+    bool ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    for (pending_entry const& p : pending) {
+      ok = ok && (fwrite(&(p.entry), sizeof(p.entry), 1, out) == 1);
+    }
+    uint64_t written = sizeof(asset_pack_header) + pending.size() * sizeof(asset_pack_entry);
+    unsigned char const zeros[asset_pack_alignment] = {};
+    for (pending_entry const& p : pending) {
+      ok = ok && (fwrite(zeros, 1, p.entry.offset - written, out) == p.entry.offset - written);
+      ok = ok && (fwrite(p.bytes.data(), 1, p.bytes.size(), out) == p.bytes.size());
+      written = p.entry.offset + p.bytes.size();
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+    }
+    return ok;
+  }
+};
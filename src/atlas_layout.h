@@ -0,0 +1,119 @@
+#pragma once
+
+#include "2d_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+// A rectangle in texture coordinates, origin is the top left corner as images are stored top row first.
+struct uv_rect {
+  vector_2f origin{ 0.0f, 0.0f };
+  vector_2f size{ 1.0f, 1.0f };
+
+  /*
+  The cell at frame of a sheet cut into frames.x by frames.y equal cells.
+  */
+  uv_rect frame(vector_2i frames, vector_2i current_frame) const {
+    vector_2f cell{ size.x / frames.x, size.y / frames.y };
+    return { origin + vector_2f{ cell.x * current_frame.x, cell.y * current_frame.y }, cell };
+  }
+};
+
+// Where each image of an atlas went, found by layout_atlas.
+struct atlas_layout {
+  struct placement {
+    size_t page;
+    vector_2i origin; // pixel of the image's top left corner in its page
+  };
+
+  std::vector<vector_2i> page_sizes;
+  std::vector<placement> placements; // in the order the sizes were given
+};
+
+/*
+Packs images of the given sizes onto as few pages of at most max_page_size square as it can,
+leaving padding pixels around each image so filtering never samples a neighbour.
+Images are placed tallest first on shelves, left to right, which is close to optimal for a few dozen sprites.
+Every image must fit on a page by itself.
+O(n log n)
+*/
+inline atlas_layout layout_atlas(std::vector<vector_2i> const& sizes, int max_page_size, int padding = 1) {
+  atlas_layout layout;
+  layout.placements.resize(sizes.size());
+  if (sizes.empty()) {
+    return layout;
+  }
+
+  int widest = 0;
+  long long total_area = 0;
+  for (vector_2i const& size : sizes) {
+    assert((size.x + 2 * padding <= max_page_size) && (size.y + 2 * padding <= max_page_size));
+    widest = std::max(widest, size.x + 2 * padding);
+    total_area += static_cast<long long>(size.x + 2 * padding) * (size.y + 2 * padding);
+  }
+  // A power of two near square page, wide enough for the widest image.
+  int page_width = 1;
+  while ((page_width < widest) || (static_cast<long long>(page_width) * page_width < total_area)) {
+    page_width *= 2;
+  }
+  page_width = std::min(page_width, max_page_size);
+
+  std::vector<size_t> order(sizes.size());
+  std::iota(order.begin(), order.end(), size_t{ 0 });
+  std::stable_sort(order.begin(), order.end(), [&sizes](size_t left, size_t right) {
+    return (sizes[left].y > sizes[right].y) || ((sizes[left].y == sizes[right].y) && (sizes[left].x > sizes[right].x));
+  });
+
+  size_t page = 0;
+  int shelf_x = 0;
+  int shelf_y = 0;
+  int shelf_height = 0;
+  layout.page_sizes.push_back({ page_width, 0 });
+  for (size_t idx : order) {
+    vector_2i padded{ sizes[idx].x + 2 * padding, sizes[idx].y + 2 * padding };
+    if (shelf_x + padded.x > page_width) { // next shelf
+      shelf_y += shelf_height;
+      shelf_x = 0;
+      shelf_height = 0;
+    }
+    if (shelf_y + padded.y > max_page_size) { // next page
+      page++;
+      layout.page_sizes.push_back({ page_width, 0 });
+      shelf_x = 0;
+      shelf_y = 0;
+      shelf_height = 0;
+    }
+    layout.placements[idx] = { page, { shelf_x + padding, shelf_y + padding } };
+    shelf_x += padded.x;
+    shelf_height = std::max(shelf_height, padded.y);
+    layout.page_sizes[page].y = std::max(layout.page_sizes[page].y, shelf_y + shelf_height);
+  }
+  return layout;
+}
+
+/*
+Copies tightly packed RGBA images into freshly made pages of the layout, anything not covered by an image is transparent black.
+O(pixels)
+*/
+inline std::vector<std::vector<unsigned char>> compose_atlas_pages(
+    atlas_layout const& layout, std::vector<vector_2i> const& sizes, std::vector<unsigned char const*> const& images) {
+  assert((sizes.size() == images.size()) && (sizes.size() == layout.placements.size()));
+  std::vector<std::vector<unsigned char>> pages(layout.page_sizes.size());
+  for (size_t page = 0; page < pages.size(); page++) {
+    pages[page].resize(static_cast<size_t>(layout.page_sizes[page].x) * layout.page_sizes[page].y * 4);
+  }
+  for (size_t i = 0; i < images.size(); i++) {
+    atlas_layout::placement const& place = layout.placements[i];
+    vector_2i page_size = layout.page_sizes[place.page];
+    size_t row_bytes = static_cast<size_t>(sizes[i].x) * 4;
+    for (int row = 0; row < sizes[i].y; row++) {
+      unsigned char* to = pages[place.page].data() + ((static_cast<size_t>(place.origin.y) + row) * page_size.x + place.origin.x) * 4;
+      std::memcpy(to, images[i] + row * row_bytes, row_bytes);
+    }
+  }
+  return pages;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "renderable.h"
+#include "space_buckets.h"
+#include "sized_vector.h"
+
+// A renderable_parent which also files its children in space_buckets by position, for children that are
+// looked up by where they are rather than by index. Children need a trans and a relocate() returning a newly
+// allocated copy of themselves, see threat. Subclasses keep the buckets up to date in update.
+template<typename child_type>
+class bucketed_parent : public renderable_parent<child_type, true> {
+public:
+  using child_buckets = space_buckets<child_type*, 20, 20>;
+
+protected:
+  child_buckets buckets;
+
+public:
+  explicit bucketed_parent(bounds b) : buckets(std::move(b)) {}
+
+  /*
+  Sorts the children along a Morton curve of the buckets they are in and moves them to match.
+  The buckets hold raw pointers to the old children so they are refilled with the moved ones,
+  anything looking children up before the next update still finds them.
+  O(n log n)
+  */
+  void sort_storage() {
+    this->reorder_children([this](child_type& child) {
+      return buckets.curve_key(child.trans.get_position());
+    }, [](child_type& child) {
+      return child.relocate();
+    });
+    refill_buckets();
+  }
+
+  /*
+  Refills the buckets with every child where it is now, for when children were added or moved outside of update.
+  O(n)
+  */
+  void refill_buckets() {
+    buckets.clear();
+    for (int i = 0; i < this->child_count(); i++) {
+      child_type& child = this->child_at(i);
+      buckets.add_entry(child.trans.get_position(), &child);
+    }
+  }
+
+  sized_vector<typename child_buckets::bucket_ptr, 9> get_nearby(vector_2f location) {
+    return buckets.find_adj_buckets(location);
+  }
+};
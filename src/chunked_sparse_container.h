@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "sparse_container.h"
+#include "fast_bitset.h"
+
+// chunked_sparse_container is a growable sparse_container made of blocks of B slots which are allocated as they are needed.
+// Like sparse_container references and iterators stay valid through insertions and deletions,
+// blocks are never moved or freed while the container is alive (unless shrink_to_fit is called),
+// and end is a sentinel which stays valid however many blocks are added.
+// An empty container holds no blocks.
+template<typename T, size_t B>
+class chunked_sparse_container final {
+private:
+  using block_type = sparse_container<T, B>;
+
+  std::vector<std::unique_ptr<block_type>> _blocks;
+  size_t _size = 0;
+  size_t _first_free_block = 0; // no block before this has a free slot
+
+public:
+  static constexpr size_t end_block() {
+    return fast_bitset_utils::npos();
+  }
+
+  using value_type = T;
+  using reference = T & ;
+  using const_reference = T const&;
+  using pointer = T * ;
+  using const_pointer = T const*;
+  using size_type = size_t;
+
+  template<bool C>
+  class base_iterator {
+  public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::conditional_t<C, T const, T>;
+    using reference = std::conditional_t<C, T const&, T&>;
+    using pointer = std::conditional_t<C, T const*, T*>;
+    using iterator_category = std::input_iterator_tag;
+    using container_pointer = std::conditional_t<C, chunked_sparse_container<T, B> const*, chunked_sparse_container<T, B>*>;
+    using block_iterator = std::conditional_t<C, typename block_type::const_iterator, typename block_type::iterator>;
+
+    template<bool D>
+    base_iterator(base_iterator<D> other) : _con(other.container()), _block(other.block()), _it(other.block_position()) {}
+
+    base_iterator& operator++() { // pre-increment
+      assert(_block != end_block());
+      ++_it;
+      if (_it == block_end(_block)) {
+        seek_from_block(_block + 1);
+      }
+      return *this;
+    }
+
+    base_iterator operator++(int) { // post-increment
+      base_iterator other = *this;
+      operator++();
+      return other;
+    }
+
+    base_iterator operator+(difference_type amount) const {
+      base_iterator other = *this;
+      other += amount;
+      return other;
+    }
+
+    base_iterator operator+=(difference_type amount) {
+      for (difference_type d = 0; d < amount; d++) {
+        operator++();
+      }
+      return *this;
+    }
+
+    reference operator*() const {
+      return *_it;
+    }
+
+    pointer operator->() const {
+      return &(*_it);
+    }
+
+    bool operator==(base_iterator<C> const& other) const {
+      if ((_con != other._con) || (_block != other._block)) {
+        return false;
+      }
+      return (_block == end_block()) || (_it == other._it);
+    }
+
+    bool operator!=(base_iterator<C> const& other) const {
+      return !(operator==(other));
+    }
+
+    container_pointer container() const {
+      return _con;
+    }
+
+    // The index of the block the iterator is in, end_block() for the end iterator.
+    size_t block() const {
+      return _block;
+    }
+
+    block_iterator block_position() const {
+      return _it;
+    }
+
+  private:
+    container_pointer _con;
+    size_t _block; // end_block() for the end iterator
+    block_iterator _it; // only meaningful when _block is not end_block()
+
+    friend class chunked_sparse_container<T, B>;
+
+    base_iterator(container_pointer con) : _con(con), _block(end_block()), _it() {}
+
+    block_iterator block_end(size_t block) const {
+      return end_of(*(_con->_blocks[block]));
+    }
+
+    static block_iterator begin_of(std::conditional_t<C, block_type const&, block_type&> block) {
+      if constexpr (C) {
+        return block.cbegin();
+      } else {
+        return block.begin();
+      }
+    }
+
+    static block_iterator end_of(std::conditional_t<C, block_type const&, block_type&> block) {
+      if constexpr (C) {
+        return block.cend();
+      } else {
+        return block.end();
+      }
+    }
+
+    // Moves to the first element of the first non empty block at or after block, or to the end.
+    void seek_from_block(size_t block) {
+      for (; block < _con->_blocks.size(); block++) {
+        block_type& candidate = *(_con->_blocks[block]);
+        if (candidate.size() > 0) {
+          _block = block;
+          _it = begin_of(candidate);
+          return;
+        }
+      }
+      _block = end_block();
+    }
+  };
+
+  using iterator = base_iterator<false>;
+  using const_iterator = base_iterator<true>;
+
+  chunked_sparse_container() {}
+
+  // do not copy or assign, moving is ok
+  chunked_sparse_container(chunked_sparse_container<T, B>&) = delete;
+  chunked_sparse_container<T, B>& operator=(chunked_sparse_container<T, B> const&) = delete;
+  chunked_sparse_container(chunked_sparse_container<T, B>&& other) = default;
+  chunked_sparse_container<T, B>& operator=(chunked_sparse_container<T, B>&& other) = default;
+
+  // O(blocks)
+  iterator begin() {
+    iterator it{ this };
+    it.seek_from_block(0);
+    return it;
+  }
+
+  // O(1)
+  iterator end() {
+    return iterator{ this };
+  }
+
+  // O(blocks)
+  const_iterator cbegin() const {
+    const_iterator it{ this };
+    it.seek_from_block(0);
+    return it;
+  }
+
+  // O(1)
+  const_iterator cend() const {
+    return const_iterator{ this };
+  }
+
+  // O(blocks) to find a block with room, allocates a block when all are full
+  reference push(T const& value) {
+    return emplace(value);
+  }
+
+  reference push(T&& value) {
+    return emplace(std::move(value));
+  }
+
+  template<typename... Args>
+  reference emplace(Args&&... args) {
+    while ((_first_free_block < _blocks.size()) && (_blocks[_first_free_block]->size() == B)) {
+      _first_free_block++;
+    }
+    if (_first_free_block == _blocks.size()) {
+      _blocks.push_back(std::make_unique<block_type>());
+    }
+    _size++;
+    return _blocks[_first_free_block]->emplace(std::forward<Args>(args)...);
+  }
+
+  void erase(const_iterator pos) {
+    assert(pos._block != end_block());
+    block_type& block = *(_blocks[pos._block]);
+    block.erase(pos._it);
+    _size--;
+    if (pos._block < _first_free_block) {
+      _first_free_block = pos._block;
+    }
+  }
+
+  /*
+  Calls func(value) for every element, see sparse_container::for_each_occupied.
+  */
+  template<typename F>
+  void for_each_occupied(F func) {
+    for (size_t b = 0; b < _blocks.size(); b++) {
+      if (_blocks[b]->size() > 0) {
+        _blocks[b]->for_each_occupied(std::ref(func));
+      }
+    }
+  }
+
+  template<typename F>
+  void for_each_occupied(F func) const {
+    for (size_t b = 0; b < _blocks.size(); b++) {
+      block_type const& block = *(_blocks[b]);
+      if (block.size() > 0) {
+        block.for_each_occupied(std::ref(func));
+      }
+    }
+  }
+
+  /*
+  Erases every element for which pred(value) is true, see sparse_container::erase_if.
+  Returns the number of elements erased.
+  */
+  template<typename F>
+  size_t erase_if(F pred) {
+    size_t num_deleted = 0;
+    for (size_t b = 0; b < _blocks.size(); b++) {
+      if (_blocks[b]->size() > 0) {
+        size_t block_deleted = _blocks[b]->erase_if(std::ref(pred));
+        if ((block_deleted > 0) && (b < _first_free_block)) {
+          _first_free_block = b;
+        }
+        num_deleted += block_deleted;
+      }
+    }
+    _size -= num_deleted;
+    return num_deleted;
+  }
+
+  // O(capacity) keeps the blocks
+  void clear() noexcept {
+    for (std::unique_ptr<block_type>& block : _blocks) {
+      block->clear();
+    }
+    _size = 0;
+    _first_free_block = 0;
+  }
+
+  /*
+  Frees empty blocks at the back of the container.
+  Iterators into freed blocks, including ones to erased elements, become invalid.
+  O(blocks)
+  */
+  void shrink_to_fit() {
+    while (!_blocks.empty() && (_blocks.back()->size() == 0)) {
+      _blocks.pop_back();
+    }
+    if (_first_free_block > _blocks.size()) {
+      _first_free_block = _blocks.size();
+    }
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  // The number of slots in the allocated blocks.
+  size_t capacity() const {
+    return _blocks.size() * B;
+  }
+
+  static constexpr size_t block_capacity() {
+    return B;
+  }
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "fast_bitset.h"
+#include "mapped_file.h"
+
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Delimiter scanning for columnar_csv, 16 bytes per step with SSE2 where it is available.
+namespace csv_scan {
+  /*
+  Calls on_delimiter(offset, is_newline) for every ',' and '\n' in text, in order.
+  O(n)
+  */
+  template<typename F>
+  void for_each_delimiter(std::string_view text, F&& on_delimiter) {
+    char const* data = text.data();
+    size_t const size = text.size();
+    size_t i = 0;
+#ifdef FAST_BITSET_SSE
+    __m128i const commas = _mm_set1_epi8(',');
+    __m128i const newlines = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+      uint64_t newline_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines)));
+      uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, commas))) | newline_mask;
+      while (mask != 0) {
+        uint32_t bit = fast_bitset_utils::word_least_significant_bit(mask);
+        on_delimiter(i + bit, ((newline_mask >> bit) & 1) != 0);
+        mask &= mask - 1;
+      }
+    }
+#endif
+    for (; i < size; i++) {
+      if ((data[i] == ',') || (data[i] == '\n')) {
+        on_delimiter(i, data[i] == '\n');
+      }
+    }
+  }
+
+  /*
+  The number of '\n' in text.
+  O(n)
+  */
+  inline size_t count_newlines(std::string_view text) {
+    char const* data = text.data();
+    size_t const size = text.size();
+    size_t count = 0;
+    size_t i = 0;
+#ifdef FAST_BITSET_SSE
+    __m128i const newlines = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+      count += fast_bitset_utils::count_word_bits(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines))));
+    }
+#endif
+    for (; i < size; i++) {
+      count += (data[i] == '\n') ? 1 : 0;
+    }
+    return count;
+  }
+};
+
+enum class csv_column_type {
+  integer, // every cell is an int, also readable as floats
+  real, // every cell is a float
+  text
+};
+
+// columnar_csv parses a csv into flat per column arrays of cell offsets, so a whole file costs
+// a fixed handful of allocations however many rows it has, and keeps no pointers into its text so it can be moved freely.
+// Columns whose every cell is a number are parsed once while loading and stored typed.
+// The text is either owned or a mapped_file, which is read in place.
+// Like parse_csv, quoting is not supported, empty lines are skipped and a '\r' before a '\n' is dropped.
+// Rows must all have the same number of cells, otherwise the csv is not valid().
+class columnar_csv {
+private:
+  struct column {
+    csv_column_type type = csv_column_type::text;
+    std::vector<int32_t> ints; // integer columns only
+    std::vector<float> floats; // integer and real columns
+  };
+
+  std::string owned_text;
+  mapped_file mapped_text;
+  bool is_mapped = false;
+
+  size_t row_count = 0;
+  size_t col_count = 0;
+  bool valid_ = false;
+  // cell (row, col) is text[cell_begins[col * row_count + row], cell_ends[col * row_count + row])
+  std::vector<uint32_t> cell_begins;
+  std::vector<uint32_t> cell_ends;
+  std::vector<uint32_t> header_begins;
+  std::vector<uint32_t> header_ends;
+  std::vector<column> columns;
+
+  void parse(bool has_header) {
+    std::string_view all = text();
+    if (all.size() >= UINT32_MAX) {
+      fprintf(stderr, "csv too large to index\n");
+      return;
+    }
+
+    // The first pass counts lines so the offsets are allocated once, empty lines make this an overestimate.
+    size_t max_rows = csv_scan::count_newlines(all) + 1;
+    std::vector<uint32_t> row_major_begins;
+    std::vector<uint32_t> row_major_ends;
+    size_t cells_in_row = 0;
+    size_t rows_found = 0;
+    size_t row_begin = 0;
+    size_t cell_begin = 0;
+    bool ok = true;
+
+    auto end_cell = [&](size_t end) {
+      row_major_begins.push_back(static_cast<uint32_t>(cell_begin));
+      row_major_ends.push_back(static_cast<uint32_t>(end));
+      cells_in_row++;
+    };
+    auto end_row = [&](size_t end) {
+      if ((end > row_begin) && (all[end - 1] == '\r')) {
+        end--;
+      }
+      if (end == row_begin) { // skip empty rows
+        return;
+      }
+      end_cell(end);
+      if (rows_found == 0) {
+        col_count = cells_in_row;
+        row_major_begins.reserve(col_count * max_rows);
+        row_major_ends.reserve(col_count * max_rows);
+      } else if (cells_in_row != col_count) {
+        fprintf(stderr, "csv row %zu has %zu cells instead of %zu\n", rows_found, cells_in_row, col_count);
+        ok = false;
+      }
+      rows_found++;
+      cells_in_row = 0;
+    };
+
+    csv_scan::for_each_delimiter(all, [&](size_t offset, bool is_newline) {
+      if (is_newline) {
+        end_row(offset);
+        row_begin = offset + 1;
+      } else {
+        end_cell(offset);
+      }
+      cell_begin = offset + 1;
+    });
+    end_row(all.size());
+    if (!ok) {
+      return;
+    }
+
+    size_t first_row = 0;
+    if (has_header && (rows_found > 0)) {
+      header_begins.assign(row_major_begins.begin(), row_major_begins.begin() + col_count);
+      header_ends.assign(row_major_ends.begin(), row_major_ends.begin() + col_count);
+      first_row = 1;
+    }
+    row_count = rows_found - first_row;
+
+    cell_begins.resize(row_count * col_count);
+    cell_ends.resize(row_count * col_count);
+    for (size_t row = 0; row < row_count; row++) {
+      for (size_t col = 0; col < col_count; col++) {
+        size_t from = (row + first_row) * col_count + col;
+        cell_begins[col * row_count + row] = row_major_begins[from];
+        cell_ends[col * row_count + row] = row_major_ends[from];
+      }
+    }
+
+    columns.resize(col_count);
+    for (size_t col = 0; col < col_count; col++) {
+      type_column(col);
+    }
+    valid_ = true;
+  }
+
+  void type_column(size_t col) {
+    column& c = columns[col];
+    if (row_count == 0) {
+      return;
+    }
+    c.ints.resize(row_count);
+    bool all_ints = true;
+    for (size_t row = 0; (row < row_count) && all_ints; row++) {
+      std::string_view value = cell(row, col);
+      std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), c.ints[row]);
+      all_ints = (!value.empty()) && (result.ec == std::errc()) && (result.ptr == value.data() + value.size());
+    }
+    c.floats.resize(row_count);
+    if (all_ints) {
+      c.type = csv_column_type::integer;
+      for (size_t row = 0; row < row_count; row++) {
+        c.floats[row] = static_cast<float>(c.ints[row]);
+      }
+      return;
+    }
+    c.ints = {};
+
+    bool all_floats = true;
+    for (size_t row = 0; (row < row_count) && all_floats; row++) {
+      std::string_view value = cell(row, col);
+      std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), c.floats[row]);
+      all_floats = (!value.empty()) && (result.ec == std::errc()) && (result.ptr == value.data() + value.size());
+    }
+    if (all_floats) {
+      c.type = csv_column_type::real;
+    } else {
+      c.floats = {};
+    }
+  }
+
+public:
+  /*
+  Parses text, taking the first row as the header when has_header is set.
+  O(n)
+  */
+  explicit columnar_csv(std::string csv_text, bool has_header = true) : owned_text(std::move(csv_text)) {
+    parse(has_header);
+  }
+
+  /*
+  Parses the mapped file in place, keeping it mapped for as long as the csv lives.
+  An invalid mapped_file gives an invalid csv.
+  O(n)
+  */
+  explicit columnar_csv(mapped_file file, bool has_header = true) : mapped_text(std::move(file)), is_mapped(true) {
+    if (mapped_text.valid()) {
+      parse(has_header);
+    }
+  }
+
+  // do not copy or assign
+  columnar_csv(columnar_csv&) = delete;
+  columnar_csv& operator=(const columnar_csv&) = delete;
+
+  //moving is ok, cells are offsets so they survive the text moving
+  columnar_csv(columnar_csv&&) = default;
+  columnar_csv& operator=(columnar_csv&&) = default;
+
+  bool valid() const {
+    return valid_;
+  }
+
+  std::string_view text() const {
+    return is_mapped ? mapped_text.view() : std::string_view{ owned_text };
+  }
+
+  size_t rows() const {
+    return row_count;
+  }
+
+  size_t cols() const {
+    return col_count;
+  }
+
+  bool has_header() const {
+    return (header_begins.size() == col_count) && (col_count > 0);
+  }
+
+  std::string_view header(size_t col) const {
+    assert(has_header() && (col < col_count));
+    return text().substr(header_begins[col], header_ends[col] - header_begins[col]);
+  }
+
+  /*
+  Returns the column with the given header name or cols() if there is none.
+  O(cols)
+  */
+  size_t find_col(std::string_view name) const {
+    for (size_t col = 0; col < header_begins.size(); col++) {
+      if (header(col) == name) {
+        return col;
+      }
+    }
+    return col_count;
+  }
+
+  std::string_view cell(size_t row, size_t col) const {
+    assert((row < row_count) && (col < col_count));
+    size_t idx = col * row_count + row;
+    return text().substr(cell_begins[idx], cell_ends[idx] - cell_begins[idx]);
+  }
+
+  std::string_view operator()(size_t row, size_t col) const {
+    return cell(row, col);
+  }
+
+  csv_column_type column_type(size_t col) const {
+    assert(col < col_count);
+    return columns[col].type;
+  }
+
+  /*
+  Every value of an integer column, in row order.
+  O(1)
+  */
+  std::vector<int32_t> const& int_column(size_t col) const {
+    assert(column_type(col) == csv_column_type::integer);
+    return columns[col].ints;
+  }
+
+  /*
+  Every value of an integer or real column, in row order.
+  O(1)
+  */
+  std::vector<float> const& float_column(size_t col) const {
+    assert(column_type(col) != csv_column_type::text);
+    return columns[col].floats;
+  }
+
+  int32_t int_at(size_t row, size_t col) const {
+    return int_column(col)[row];
+  }
+
+  float float_at(size_t row, size_t col) const {
+    return float_column(col)[row];
+  }
+};
@@ -1,9 +1,9 @@
 #pragma once
 
-#include "gl_includes.h"
+#include "utils.h"
+#include "mapped_file.h"
 #include<vector>
 #include<string>
-#include<fstream>
 #include<cstdlib>
 #include<cstring>
 #include<array>
@@ -15,6 +15,7 @@ class csv {
 private:
   int row_count;
   int col_count;
+  mapped_file mapping; // when parsed from a mapped file the values point into it instead of data
 public:
   std::string const data;
   std::vector<std::vector<std::string_view>> const values;
@@ -35,6 +36,11 @@ public:
     }
   }
 
+  csv(mapped_file file, std::vector<std::vector<std::string_view>> vals, std::vector<std::string_view> head) :
+    csv(std::string(), std::move(vals), std::move(head)) {
+    mapping = std::move(file);
+  }
+
   bool has_header() const {
     return (header.size() == col_count);
   }
@@ -112,11 +118,38 @@ inline csv parse_csv_no_header(std::string buffer) {
   return csv(std::move(buffer), std::move(values), {});
 }
 
+/*
+Parses the file in place, the csv keeps it mapped and its values point into the mapping.
+*/
+inline csv parse_csv(mapped_file file) {
+  std::string_view reader = file.view();
+  std::vector<std::string_view> header = parse_csv_row(reader);
+  std::vector<std::vector<std::string_view>> values = parse_csv_body(reader);
+  return csv(std::move(file), std::move(values), std::move(header));
+}
+
+inline csv parse_csv_no_header(mapped_file file) {
+  std::string_view reader = file.view();
+  std::vector<std::vector<std::string_view>> values = parse_csv_body(reader);
+  return csv(std::move(file), std::move(values), {});
+}
+
+/*
+Maps and parses the file, exits if it can not be read as there is no csv to return.
+Map the file and use parse_csv to handle the error instead.
+*/
 inline csv read_csv(char const* filename) {
-  return parse_csv(read_file_to_string(filename));
+  mapped_file file{ filename };
+  if (!file.report(filename)) {
+    exit(-1);
+  }
+  return parse_csv(std::move(file));
 }
 
 inline csv read_csv_no_header(char const* filename) {
-  return parse_csv_no_header(read_file_to_string(filename));
-
+  mapped_file file{ filename };
+  if (!file.report(filename)) {
+    exit(-1);
+  }
+  return parse_csv_no_header(std::move(file));
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "vertex_array.h"
 #include "color.h"
 #include "sprite.h"
+#include "frame_arena.h"
 #include <vector>
 #include <cassert>
 
@@ -62,21 +63,25 @@ public:
     return new explosion_effect(ctx, std::move(parts), 100, 0.01f);
   }
 
-  static explosion_effect explode_sprite(point_particle_context* ctx,  sprite& spr, vector_2f center, matrix_3f const& parent_trans, generator_type& gen, int duration=60) {
-    assert(spr.tex != nullptr);
+  /*
+  Breaks the drawn part of the sprite into one particle per visible pixel, read from the atlas's CPU copy.
+  The particles are only needed until they are uploaded so they are built in the frame_arena.
+  */
+  static explosion_effect explode_sprite(point_particle_context* ctx, frame_arena& arena, sprite& spr, vector_2f center, matrix_3f const& parent_trans, generator_type& gen, int duration=60) {
+    assert((spr.region != nullptr) && (spr.region->pixels != nullptr));
 
-    unsigned char* pixel_data = spr.tex->data();
-    vector_2i image_size{ spr.tex->width(), spr.tex->height() };
+    unsigned char const* pixel_data = spr.region->pixels;
+    vector_2i image_size = spr.region->tex_size;
 
-    vector_2i frame_size = image_size / spr.frames;
+    // the pixels of the drawn part of the atlas
+    vector_2i offset{ static_cast<int>(spr.uv.origin.x * image_size.x + 0.5f), static_cast<int>(spr.uv.origin.y * image_size.y + 0.5f) };
+    vector_2i frame_size{ static_cast<int>(spr.uv.size.x * image_size.x + 0.5f), static_cast<int>(spr.uv.size.y * image_size.y + 0.5f) };
     int max_particle_count = frame_size.x * frame_size.y;
-    std::vector<pt_particle> parts;
+    arena_vector<pt_particle> parts{ arena };
     parts.reserve(max_particle_count);
 
     matrix_3f total_trans = parent_trans * spr.local_trans;
 
-    vector_2i offset = frame_size * spr.current_frame;
-
     for (int x = 0; x < frame_size.x; x++) {
       for (int y = 0; y < frame_size.y; y++) {
 
@@ -100,17 +105,24 @@ public:
       }
     }
 
-    return explosion_effect{ ctx, std::move(parts), duration, spr.mask_color.values[3] / duration };
+    return explosion_effect{ ctx, parts.data(), parts.size(), duration, spr.mask_color.values[3] / duration };
   }
 
   explosion_effect(point_particle_context* ctx, std::vector<pt_particle> parts, int dur, float al_step) :
+      explosion_effect(ctx, parts.data(), parts.size(), dur, al_step) {
+  }
+
+  /*
+  Uploads count particles starting at parts, the particles are not needed after construction.
+  */
+  explosion_effect(point_particle_context* ctx, pt_particle const* parts, size_t count, int dur, float al_step) :
       context(ctx),
       duration(dur),
       alpha_step(al_step) {
 
-    sva.size = parts.size();
+    sva.size = count;
     sva.vb.bind(GL_SHADER_STORAGE_BUFFER);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(pt_particle) * sva.size, parts.data(), GL_STATIC_DRAW);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(pt_particle) * sva.size, parts, GL_STATIC_DRAW);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sva.vb.vbo);
 
     sva.va.bind();
@@ -5,12 +5,21 @@
 #include <limits>
 #include <array>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FAST_BITSET_SSE
+#include <emmintrin.h>
+#endif
+
 namespace fast_bitset_utils {
   size_t constexpr npos() {
     return std::numeric_limits<size_t>::max();
   }
 
-  uint32_t count_chunk_bits(uint32_t v) {
+  inline uint32_t count_chunk_bits(uint32_t v) {
     // Bit Twiddling Hacks 
     // Counting bits set, in parallel
     v = v - ((v >> 1) & 0x55555555);
@@ -18,7 +27,7 @@ namespace fast_bitset_utils {
     return ((v + (v >> 4) & 0xF0F0F0F) * 0x1010101) >> 24;
   }
 
-  uint32_t mask_most_significant_bit(uint32_t v) {
+  inline uint32_t mask_most_significant_bit(uint32_t v) {
     // Bit Twiddling Hacks 
     // Find the log base 2 of an N-bit integer in O(lg(N)) operations with multiply and lookup 
     static int const multiply_de_bruijn_bit_position[32] =
@@ -29,7 +38,7 @@ namespace fast_bitset_utils {
     return multiply_de_bruijn_bit_position[(uint32_t)(v * 0x077CB531U) >> 27];
   }
 
-  uint32_t chunk_most_significant_bit(uint32_t v) {
+  inline uint32_t chunk_most_significant_bit(uint32_t v) {
     // Bit Twiddling Hacks 
     // Find the log base 2 of an N-bit integer in O(lg(N)) operations with multiply and lookup 
     static int const multiply_de_bruijn_bit_position[32] =
@@ -47,57 +56,113 @@ namespace fast_bitset_utils {
     return multiply_de_bruijn_bit_position[(uint32_t)(v * 0x07C4ACDDU) >> 27];
   }
 
-  uint32_t chunk_least_significant_mask(uint32_t v) {
+  inline uint32_t chunk_least_significant_mask(uint32_t v) {
     return v & (~(v - 1));
   }
 
-  uint32_t chunk_least_significant_bit(uint32_t v) {
+  inline uint32_t chunk_least_significant_bit(uint32_t v) {
     return mask_most_significant_bit(chunk_least_significant_mask(v));
   }
 
+  // The number of set bits in a 64 bit word, a single popcnt where the compiler exposes it.
+  inline uint32_t count_word_bits(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_popcountll(v));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<uint32_t>(__popcnt64(v));
+#else
+    return count_chunk_bits(static_cast<uint32_t>(v)) + count_chunk_bits(static_cast<uint32_t>(v >> 32));
+#endif
+  }
+
+  // The index of the lowest set bit of a non zero 64 bit word, a single tzcnt/bsf where the compiler exposes it.
+  inline uint32_t word_least_significant_bit(uint64_t v) {
+    assert(v != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(v));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return static_cast<uint32_t>(idx);
+#else
+    uint32_t low = static_cast<uint32_t>(v);
+    if (low != 0) {
+      return chunk_least_significant_bit(low);
+    }
+    return 32 + chunk_least_significant_bit(static_cast<uint32_t>(v >> 32));
+#endif
+  }
+
+  // The index of the highest set bit of a non zero 64 bit word.
+  inline uint32_t word_most_significant_bit(uint64_t v) {
+    assert(v != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<uint32_t>(__builtin_clzll(v));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return static_cast<uint32_t>(idx);
+#else
+    uint32_t high = static_cast<uint32_t>(v >> 32);
+    if (high != 0) {
+      return 32 + chunk_most_significant_bit(high);
+    }
+    return chunk_most_significant_bit(static_cast<uint32_t>(v));
+#endif
+  }
+
 };
 
+// fast_bitset is a fixed size bitset stored in 64 bit chunks.
+// Scans use bit scan instructions and skip whole chunks, with SSE2 checking two chunks per step where it is available.
+// Bits past N in the last chunk are always zero.
 template<size_t N>
 class fast_bitset {
-private:
+public:
+  using chunk_type = uint64_t;
 
-  size_t constexpr chunk_count() const {
-    return (N + 31) / 32;
-  }
+  // The bits are stored in chunks of this many bits, bit i is bit (i % bits_per_chunk) of chunk (i / bits_per_chunk).
+  static constexpr size_t bits_per_chunk = 64;
 
-  size_t constexpr full_chunk_count() const {
-    return N / 32;
+  static constexpr size_t chunk_count() {
+    return (N + 63) / 64;
   }
 
-  size_t constexpr last_chunk_size() const {
-    return N - 32 * (N / 32);
+  // The chunk holding bits [chunk_idx * bits_per_chunk, (chunk_idx + 1) * bits_per_chunk).
+  chunk_type chunk_at(size_t chunk_idx) const {
+    assert(chunk_idx < chunk_count());
+    return _chunks[chunk_idx];
   }
 
-  uint32_t constexpr last_chunk_mask() const {
-    return std::numeric_limits<uint32_t>::max() >> (32 - last_chunk_size());
+private:
+  static constexpr chunk_type all_ones = std::numeric_limits<chunk_type>::max();
+
+  // The bits of the chunk which are inside the bitset.
+  static constexpr chunk_type chunk_mask(size_t chunk_idx) {
+    return ((chunk_idx == chunk_count() - 1) && ((N % 64) != 0)) ? ((chunk_type{ 1 } << (N % 64)) - 1) : all_ones;
   }
 
-  std::array<uint32_t, (N + 31) / 32> _chunks;
+  alignas(16) std::array<chunk_type, (N + 63) / 64> _chunks;
 
-  uint32_t& get_chunk(size_t pos) {
+  chunk_type& get_chunk(size_t pos) {
     assert(pos < size());
-    return _chunks[pos / 32];
+    return _chunks[pos / 64];
   }
 
-  uint32_t const& get_chunk(size_t pos) const {
+  chunk_type const& get_chunk(size_t pos) const {
     assert(pos < size());
-    return _chunks[pos / 32];
+    return _chunks[pos / 64];
   }
 
-  static void set_chunk_bit(uint32_t& chunk, size_t pos) {
-    chunk |= (uint32_t{ 1 } << pos);
+  static void set_chunk_bit(chunk_type& chunk, size_t pos) {
+    chunk |= (chunk_type{ 1 } << pos);
   }
 
-  static void reset_chunk_bit(uint32_t& chunk, size_t pos) {
-    chunk &= (~(uint32_t{ 1 } << pos));
+  static void reset_chunk_bit(chunk_type& chunk, size_t pos) {
+    chunk &= (~(chunk_type{ 1 } << pos));
   }
 
-  static void set_chunk_bit(uint32_t& chunk, size_t pos, bool value) {
+  static void set_chunk_bit(chunk_type& chunk, size_t pos, bool value) {
     // If this needs to be faster use:
     // Bit Twiddling Hacks 
     // Conditionally set or clear bits without branching 
@@ -108,12 +173,102 @@ private:
     }
   }
 
-  static bool get_chunk_bit(uint32_t chunk, size_t pos) {
+  static bool get_chunk_bit(chunk_type chunk, size_t pos) {
     return (chunk >> pos) & 1;
   }
 
-  static void flip_chunk_bit(uint32_t& chunk, size_t pos) {
-    chunk ^= (uint32_t{ 1 } << pos);
+  static void flip_chunk_bit(chunk_type& chunk, size_t pos) {
+    chunk ^= (chunk_type{ 1 } << pos);
+  }
+
+  /*
+  Returns the index of the first chunk at or after chunk_idx which is not equal to skip_value, or chunk_count().
+  skip_value must be all zeros or all ones.
+  */
+  size_t skip_chunks(size_t chunk_idx, chunk_type skip_value) const {
+#ifdef FAST_BITSET_SSE
+    __m128i skip = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(skip_value)));
+    for (; chunk_idx + 2 <= chunk_count(); chunk_idx += 2) {
+      __m128i chunks = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_chunks.data() + chunk_idx));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(chunks, skip)) != 0xFFFF) {
+        break; // one of the pair differs, the scalar loop finds which
+      }
+    }
+#endif
+    for (; chunk_idx < chunk_count(); chunk_idx++) {
+      if (_chunks[chunk_idx] != skip_value) {
+        break;
+      }
+    }
+    return chunk_idx;
+  }
+
+  size_t first_true_from_chunk(size_t chunk_idx) const {
+    chunk_idx = skip_chunks(chunk_idx, 0);
+    if (chunk_idx == chunk_count()) {
+      return fast_bitset_utils::npos();
+    }
+    return fast_bitset_utils::word_least_significant_bit(_chunks[chunk_idx]) + 64 * chunk_idx;
+  }
+
+  size_t first_false_from_chunk(size_t chunk_idx) const {
+    chunk_idx = skip_chunks(chunk_idx, all_ones);
+    if (chunk_idx == chunk_count()) {
+      return fast_bitset_utils::npos();
+    }
+    chunk_type free_bits = ~_chunks[chunk_idx] & chunk_mask(chunk_idx);
+    if (free_bits == 0) {
+      return fast_bitset_utils::npos(); // only the partial last chunk can be full without being all ones
+    }
+    return fast_bitset_utils::word_least_significant_bit(free_bits) + 64 * chunk_idx;
+  }
+
+  enum class combine_op {
+    and_op,
+    or_op,
+    and_not_op
+  };
+
+  template<combine_op op>
+  static chunk_type combine_chunk(chunk_type left, chunk_type right) {
+    switch (op) {
+    case combine_op::and_op:
+      return left & right;
+    case combine_op::or_op:
+      return left | right;
+    default:
+      return left & ~right;
+    }
+  }
+
+#ifdef FAST_BITSET_SSE
+  template<combine_op op>
+  static __m128i combine_pair(__m128i left, __m128i right) {
+    switch (op) {
+    case combine_op::and_op:
+      return _mm_and_si128(left, right);
+    case combine_op::or_op:
+      return _mm_or_si128(left, right);
+    default:
+      return _mm_andnot_si128(right, left); // _mm_andnot_si128 negates its first argument
+    }
+  }
+#endif
+
+  // Combines every chunk with the matching chunk of other, two chunks at a time with SSE2.
+  template<combine_op op>
+  void combine(fast_bitset<N> const& other) {
+    size_t chunk_idx = 0;
+#ifdef FAST_BITSET_SSE
+    for (; chunk_idx + 2 <= chunk_count(); chunk_idx += 2) {
+      __m128i* mine = reinterpret_cast<__m128i*>(_chunks.data() + chunk_idx);
+      __m128i const* theirs = reinterpret_cast<__m128i const*>(other._chunks.data() + chunk_idx);
+      _mm_store_si128(mine, combine_pair<op>(_mm_load_si128(mine), _mm_load_si128(theirs)));
+    }
+#endif
+    for (; chunk_idx < chunk_count(); chunk_idx++) {
+      _chunks[chunk_idx] = combine_chunk<op>(_chunks[chunk_idx], other._chunks[chunk_idx]);
+    }
   }
 
 public:
@@ -129,121 +284,56 @@ public:
 
   public:
     reference & operator=(bool x) noexcept {
-      set_chunk_bit(_con.get_chunk(_idx), _idx % 32, x);
+      set_chunk_bit(_con.get_chunk(_idx), _idx % 64, x);
       return *this;
     }
     reference& operator=(reference const& x) noexcept {
-      set_chunk_bit(_con.get_chunk(_idx), _idx % 32, x);
+      set_chunk_bit(_con.get_chunk(_idx), _idx % 64, x);
       return *this;
     }
 
     operator bool() const noexcept {
-      return get_chunk_bit(_con.get_chunk(_idx), _idx % 32);
+      return get_chunk_bit(_con.get_chunk(_idx), _idx % 64);
     }
 
     reference& flip() noexcept {
-      flip_chunk_bit(_con.get_chunk(_idx), _idx % 32);
+      flip_chunk_bit(_con.get_chunk(_idx), _idx % 64);
       return *this;
     }
   };
 
+  // O(N/64)
   size_t first_true(size_t start) const {
     assert(start < size());
 
-    size_t chunk_idx = start / 32;
-    size_t chunk_pos = start % 32;
-
-    uint32_t chunk = _chunks[chunk_idx] >> chunk_pos;
-
+    size_t chunk_idx = start / 64;
+    chunk_type chunk = _chunks[chunk_idx] & (all_ones << (start % 64));
     if (chunk != 0) {
-      return fast_bitset_utils::chunk_least_significant_bit(chunk) + start;
+      return fast_bitset_utils::word_least_significant_bit(chunk) + 64 * chunk_idx;
     }
-
-    for (chunk_idx++; chunk_idx < chunk_count(); chunk_idx++) {
-      chunk = _chunks[chunk_idx];
-      if (chunk == 0) {
-        continue;
-      }
-      return fast_bitset_utils::chunk_least_significant_bit(chunk) + 32 * chunk_idx;
-    }
-
-    return fast_bitset_utils::npos();
+    return first_true_from_chunk(chunk_idx + 1);
   }
 
+  // O(N/64)
   size_t first_true() const {
-    for (size_t chunk_idx = 0; chunk_idx < chunk_count(); chunk_idx++) {
-      uint32_t chunk = _chunks[chunk_idx];
-      if (chunk == 0) {
-        continue;
-      }
-      return fast_bitset_utils::chunk_least_significant_bit(chunk) + 32 * chunk_idx;
-    }
-
-    return fast_bitset_utils::npos();
+    return first_true_from_chunk(0);
   }
 
+  // O(N/64)
   size_t first_false(size_t start) const {
     assert(start < size());
 
-    size_t chunk_idx = start / 32;
-    size_t chunk_pos = start % 32;
-
-    uint32_t chunk = _chunks[chunk_idx] >> chunk_pos;
-
-    // the last chunk may be incomplete
-    if (chunk_idx == (chunk_count() - 1)) {
-      uint32_t max_left = last_chunk_mask() >> chunk_pos;
-
-      if (chunk != max_left) {
-        return fast_bitset_utils::chunk_least_significant_bit(~chunk) + start;
-      }
-
-      return fast_bitset_utils::npos();
-    } else {
-      uint32_t max_left = std::numeric_limits<uint32_t>::max() >> chunk_pos;
-
-      if (chunk != max_left) {
-        return fast_bitset_utils::chunk_least_significant_bit(~chunk) + start;
-      }
-    }
-    
-    // check the full chunks
-    for (chunk_idx++; chunk_idx < full_chunk_count(); chunk_idx++) {
-      chunk = ~_chunks[chunk_idx];
-      if (chunk == 0) {
-        continue;
-      }
-      return fast_bitset_utils::chunk_least_significant_bit(chunk) + 32 * chunk_idx;
-    }
-
-    // check the last chunk if it has not been checked yet
-    if (chunk_idx < chunk_count()) {
-      uint32_t chunk = _chunks[chunk_count() - 1];
-      if (chunk != last_chunk_mask()) {
-        return fast_bitset_utils::chunk_least_significant_bit(~chunk) + 32 * (chunk_count() - 1);
-      }
+    size_t chunk_idx = start / 64;
+    chunk_type chunk = ~_chunks[chunk_idx] & chunk_mask(chunk_idx) & (all_ones << (start % 64));
+    if (chunk != 0) {
+      return fast_bitset_utils::word_least_significant_bit(chunk) + 64 * chunk_idx;
     }
-
-    return fast_bitset_utils::npos();
+    return first_false_from_chunk(chunk_idx + 1);
   }
 
+  // O(N/64)
   size_t first_false() const {
-    for (size_t chunk_idx = 0; chunk_idx < full_chunk_count(); chunk_idx++) {
-      uint32_t chunk = ~_chunks[chunk_idx];
-      if (chunk == 0) {
-        continue;
-      }
-      return fast_bitset_utils::chunk_least_significant_bit(chunk) + 32 * chunk_idx;
-    }
-
-    if (full_chunk_count() < chunk_count()) {
-      uint32_t chunk = _chunks[chunk_count() - 1];
-      if (chunk != last_chunk_mask()) {
-        return fast_bitset_utils::chunk_least_significant_bit(~chunk) + 32 * (chunk_count() - 1);
-      }
-    }
-
-    return fast_bitset_utils::npos();
+    return first_false_from_chunk(0);
   }
 
   reference operator[](size_t pos) {
@@ -251,34 +341,54 @@ public:
     return reference(*this, pos);
   }
 
-  // O(N/32)
+  // O(N/64)
   size_t count() const {
     size_t total = 0;
     for (size_t i = 0; i < chunk_count(); i++) {
-      total += fast_bitset_utils::count_chunk_bits(_chunks[i]);
+      total += fast_bitset_utils::count_word_bits(_chunks[i]);
     }
     return total;
   }
 
+  /*
+  Returns the index of the first chunk at or after chunk_idx with any bit set, or chunk_count().
+  O(N/64)
+  */
+  size_t first_non_empty_chunk(size_t chunk_idx) const {
+    if (chunk_idx >= chunk_count()) {
+      return chunk_count();
+    }
+    return skip_chunks(chunk_idx, 0);
+  }
+
+  // O(N/64)
+  bool any() const {
+    return skip_chunks(0, 0) != chunk_count();
+  }
+
+  // O(N/64)
+  bool none() const {
+    return !any();
+  }
+
   constexpr size_t size() const noexcept {
     return N;
   }
 
   bool test(size_t pos) const {
     assert(pos < size());
-    return get_chunk_bit(get_chunk(pos), pos);
+    return get_chunk_bit(get_chunk(pos), pos % 64);
   }
 
   bool operator[](size_t pos) const {
     return test(pos);
   }
 
-  // O(N/32)
+  // O(N/64)
   fast_bitset<N>& set() {
-    for (size_t i = 0; i < full_chunk_count(); i++) {
-      _chunks[i] = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < chunk_count(); i++) {
+      _chunks[i] = chunk_mask(i);
     }
-    _chunks[chunk_count() - 1] = last_chunk_mask();
     return *this;
   }
 
@@ -289,7 +399,7 @@ public:
     return *this;
   }
 
-  // O(N/32)
+  // O(N/64)
   fast_bitset<N>& reset() {
     for (size_t i = 0; i < chunk_count(); i++) {
       _chunks[i] = 0;
@@ -304,12 +414,11 @@ public:
     return *this;
   }
 
-  // O(N/32)
+  // O(N/64)
   fast_bitset<N>& flip() {
-    for (size_t i = 0; i < full_chunk_count(); i++) {
-      _chunks[i] = ~_chunks[i];
+    for (size_t i = 0; i < chunk_count(); i++) {
+      _chunks[i] ^= chunk_mask(i);
     }
-    _chunks[chunk_count() - 1] ^= last_chunk_mask();
     return *this;
   }
 
@@ -320,7 +429,36 @@ public:
     return *this;
   }
 
+  // O(N/64)
+  fast_bitset<N>& operator&=(fast_bitset<N> const& other) {
+    combine<combine_op::and_op>(other);
+    return *this;
+  }
+
+  // O(N/64)
+  fast_bitset<N>& operator|=(fast_bitset<N> const& other) {
+    combine<combine_op::or_op>(other);
+    return *this;
+  }
+
+  /*
+  Clears every bit which is set in other.
+  O(N/64)
+  */
+  fast_bitset<N>& and_not(fast_bitset<N> const& other) {
+    combine<combine_op::and_not_op>(other);
+    return *this;
+  }
+
+  bool operator==(fast_bitset<N> const& other) const {
+    return (_chunks == other._chunks);
+  }
+
+  bool operator!=(fast_bitset<N> const& other) const {
+    return !(*this == other);
+  }
+
   fast_bitset() {
     reset();
   }
-};
\ No newline at end of file
+};
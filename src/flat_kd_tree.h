@@ -0,0 +1,658 @@
+#pragma once
+
+#include "2d_math.h"
+#include "geom.h"
+#include "kd_tree.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FLAT_KD_TREE_SSE
+#include <emmintrin.h>
+#endif
+
+template <typename V>
+struct flat_kd_dist {
+  V* ptr;
+  float dist;
+
+  flat_kd_dist() : ptr(nullptr), dist(std::numeric_limits<float>::max()) {}
+  flat_kd_dist(V* pt, float dis) : ptr(pt), dist(dis) {}
+
+  bool operator<(flat_kd_dist<V> const& other) const {
+    return (dist < other.dist);
+  }
+};
+
+// flat_kd_tree is a cache friendly alternative to kd_tree for large point sets.
+// Positions are stored as separate x and y arrays (structure of arrays) away from the values,
+// so searching only pulls coordinates into the cache and values are touched only for results.
+// Rather than splitting down to single elements points are grouped into leaf blocks of B points
+// which are scanned all at once with SIMD.
+// Every node stores the bounds of the points beneath it so whole subtrees can be skipped by
+// comparing against a box rather than a single splitting plane.
+// Searches do not allocate, the traversal stack lives on the call stack.
+//
+// The tree can also be kept live instead of being rebuilt every tick.
+// Points are identified by handles, which for build are the indices of the input points.
+// move, insert and remove keep every query correct immediately by growing the bounds along the
+// path to the root, and refit tightens the bounds and rebuilds only the subtrees whose balance
+// has degraded past a threshold. insert also rebuilds the topmost subtree along its path which it
+// has unbalanced, so inserting points in order cannot grow the tree deeper than the traversal stack.
+template<typename V, size_t B = 16>
+class flat_kd_tree {
+  static_assert(B % 4 == 0, "leaf blocks are scanned 4 points at a time");
+  static_assert(B >= 4, "leaf blocks must hold at least 4 points");
+
+public:
+  using handle_type = uint32_t;
+
+  static constexpr handle_type invalid_handle() {
+    return std::numeric_limits<handle_type>::max();
+  }
+
+private: // private types
+
+  struct flat_kd_node {
+    bounds box; // bounds of every point beneath this node, tight after build or refit
+    uint32_t first; // internal nodes: index of the left child, the right child follows it. leaves: block index
+    uint32_t count; // number of points beneath this node
+    float split; // the splitting coordinate for internal nodes
+    uint16_t division_axis;
+    uint16_t leaf;
+  };
+
+  struct point_record {
+    vector_2f pos;
+    V value;
+    handle_type handle;
+  };
+
+  using vec_it = typename std::vector<point_record>::iterator;
+  using vec_dst = typename std::vector<point_record>::difference_type;
+
+  struct build_arg {
+    vec_it start;
+    vec_it stop;
+    uint32_t node;
+  };
+
+  // No child of a node insert leaves behind holds more than this fraction of the node's points,
+  // the same as refit's default.
+  static constexpr float insert_balance_threshold = 0.75f;
+
+  // Keeping insert_balance_threshold bounds the depth of a tree of 2^32 points by log base 4/3 of 2^32, about 77,
+  // build, refit and remove never make the tree deeper and each level pushes at most one extra node
+  static constexpr size_t max_stack_depth = 128;
+
+  template<typename T>
+  struct fixed_stack {
+    std::array<T, max_stack_depth> items;
+    size_t size = 0;
+
+    void push(T item) {
+      assert(size < max_stack_depth);
+      items[size++] = item;
+    }
+
+    T pop() {
+      return items[--size];
+    }
+
+    bool empty() const {
+      return (size == 0);
+    }
+  };
+
+  static constexpr uint32_t no_parent = std::numeric_limits<uint32_t>::max();
+
+private: // static members
+
+  static bool compare_record_x(point_record const& left, point_record const& right) {
+    return left.pos.x < right.pos.x;
+  }
+
+  static bool compare_record_y(point_record const& left, point_record const& right) {
+    return left.pos.y < right.pos.y;
+  }
+
+  static float box_distance_squared(bounds const& box, vector_2f const& pos) {
+    float dx = std::max(std::max(box.min_bound.x - pos.x, pos.x - box.max_bound.x), 0.0f);
+    float dy = std::max(std::max(box.min_bound.y - pos.y, pos.y - box.max_bound.y), 0.0f);
+    return dx * dx + dy * dy;
+  }
+
+  // An inverted box which contains nothing and is never closer than any distance
+  static bounds empty_box() {
+    float inf = std::numeric_limits<float>::infinity();
+    return { { inf, inf }, { -inf, -inf } };
+  }
+
+  static bounds box_union(bounds const& left, bounds const& right) {
+    return { left.min_bound.min(right.min_bound), left.max_bound.max(right.max_bound) };
+  }
+
+  static float box_area(bounds const& box) {
+    vector_2f extent = box.max_bound - box.min_bound;
+    return std::max(extent.x, 0.0f) * std::max(extent.y, 0.0f);
+  }
+
+  static bounds range_bounds(vec_it start, vec_it stop) {
+    bounds box = empty_box();
+    for (vec_it it = start; it != stop; ++it) {
+      box.min_bound = box.min_bound.min(it->pos);
+      box.max_bound = box.max_bound.max(it->pos);
+    }
+    return box;
+  }
+
+  static float unused_coordinate() {
+    return std::numeric_limits<float>::infinity();
+  }
+
+private: // private varriables
+
+  std::vector<flat_kd_node> nodes;
+  std::vector<uint32_t> parents; // parent of each node
+
+  // Point coordinates, values and handles in leaf blocks of B
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<V> values;
+  std::vector<handle_type> slot_handles;
+  std::vector<uint32_t> block_leaves; // the leaf node which owns each block
+
+  std::vector<uint32_t> handle_slots; // slot of each handle
+  std::vector<handle_type> free_handles;
+  std::vector<uint32_t> free_node_pairs;
+  std::vector<uint32_t> free_blocks;
+
+  // scratch space for rebuilding subtrees
+  std::vector<point_record> rebuild_records;
+  std::vector<build_arg> arg_stack;
+
+private: // private methods
+
+  uint32_t allocate_block(uint32_t leaf) {
+    uint32_t block;
+    if (!free_blocks.empty()) {
+      block = free_blocks.back();
+      free_blocks.pop_back();
+    } else {
+      block = static_cast<uint32_t>(block_leaves.size());
+      xs.resize(xs.size() + B, unused_coordinate());
+      ys.resize(ys.size() + B, unused_coordinate());
+      values.resize(values.size() + B);
+      slot_handles.resize(slot_handles.size() + B, invalid_handle());
+      block_leaves.push_back(leaf);
+    }
+    block_leaves[block] = leaf;
+    return block;
+  }
+
+  uint32_t allocate_node_pair(uint32_t parent) {
+    uint32_t first;
+    if (!free_node_pairs.empty()) {
+      first = free_node_pairs.back();
+      free_node_pairs.pop_back();
+    } else {
+      first = static_cast<uint32_t>(nodes.size());
+      nodes.emplace_back();
+      nodes.emplace_back();
+      parents.push_back(parent);
+      parents.push_back(parent);
+    }
+    parents[first] = parent;
+    parents[first + 1] = parent;
+    return first;
+  }
+
+  handle_type allocate_handle() {
+    if (!free_handles.empty()) {
+      handle_type handle = free_handles.back();
+      free_handles.pop_back();
+      return handle;
+    }
+    handle_slots.push_back(0);
+    return static_cast<handle_type>(handle_slots.size() - 1);
+  }
+
+  void write_slot(uint32_t slot, vector_2f const& pos, V&& value, handle_type handle) {
+    xs[slot] = pos.x;
+    ys[slot] = pos.y;
+    values[slot] = std::move(value);
+    slot_handles[slot] = handle;
+    handle_slots[handle] = slot;
+  }
+
+  void clear_slot(uint32_t slot) {
+    xs[slot] = unused_coordinate();
+    ys[slot] = unused_coordinate();
+    values[slot] = V{};
+    slot_handles[slot] = invalid_handle();
+  }
+
+  // Builds the points in [start, stop) into a subtree rooted at the already allocated node root.
+  void build_subtree(uint32_t root, vec_it start, vec_it stop) {
+    arg_stack.clear();
+    arg_stack.push_back({ start, stop, root });
+    while (!arg_stack.empty()) {
+      build_arg args = arg_stack.back();
+      arg_stack.pop_back();
+      vec_dst dst = std::distance(args.start, args.stop);
+
+      flat_kd_node node;
+      node.box = range_bounds(args.start, args.stop);
+      node.count = static_cast<uint32_t>(dst);
+
+      if (dst <= static_cast<vec_dst>(B)) {
+        node.leaf = 1;
+        node.division_axis = 0;
+        node.split = 0;
+        node.first = allocate_block(args.node);
+        uint32_t slot = node.first * B;
+        for (vec_it it = args.start; it != args.stop; ++it, ++slot) {
+          write_slot(slot, it->pos, std::move(it->value), it->handle);
+        }
+        nodes[args.node] = node;
+        continue;
+      }
+
+      // split the widest side of the box
+      vector_2f extent = node.box.max_bound - node.box.min_bound;
+      node.leaf = 0;
+      node.division_axis = (extent.x >= extent.y) ? 0 : 1;
+      vec_dst median_offset = dst / 2;
+      if (node.division_axis == 0) {
+        std::nth_element(args.start, args.start + median_offset, args.stop, compare_record_x);
+        node.split = (args.start + median_offset)->pos.x;
+      } else {
+        std::nth_element(args.start, args.start + median_offset, args.stop, compare_record_y);
+        node.split = (args.start + median_offset)->pos.y;
+      }
+
+      // children are allocated as an adjacent pair
+      node.first = allocate_node_pair(args.node);
+      nodes[args.node] = node;
+
+      arg_stack.push_back({ args.start + median_offset, args.stop, node.first + 1 }); // [median, stop)
+      arg_stack.push_back({ args.start, args.start + median_offset, node.first }); // [start, median)
+    }
+  }
+
+  // Moves every point beneath a node into rebuild_records and releases the subtree's children and blocks.
+  // The node itself stays allocated so it can be rebuilt in place.
+  void collect_subtree(uint32_t root) {
+    fixed_stack<uint32_t> stack;
+    stack.push(root);
+    while (!stack.empty()) {
+      uint32_t idx = stack.pop();
+      flat_kd_node const& node = nodes[idx];
+      if (node.leaf) {
+        uint32_t base = node.first * B;
+        for (uint32_t slot = base; slot < base + node.count; slot++) {
+          rebuild_records.push_back({ { xs[slot], ys[slot] }, std::move(values[slot]), slot_handles[slot] });
+          clear_slot(slot);
+        }
+        free_blocks.push_back(node.first);
+      } else {
+        stack.push(node.first);
+        stack.push(node.first + 1);
+        free_node_pairs.push_back(node.first);
+      }
+    }
+  }
+
+  void rebuild_subtree(uint32_t root) {
+    rebuild_records.clear();
+    collect_subtree(root);
+    build_subtree(root, rebuild_records.begin(), rebuild_records.end());
+  }
+
+  // Grows the boxes from node to the root so they contain pos and adjusts their counts.
+  void grow_to_root(uint32_t idx, vector_2f const& pos, int count_change) {
+    while (idx != no_parent) {
+      flat_kd_node& node = nodes[idx];
+      node.box.min_bound = node.box.min_bound.min(pos);
+      node.box.max_bound = node.box.max_bound.max(pos);
+      node.count += count_change;
+      idx = parents[idx];
+    }
+  }
+
+  // Recomputes tight boxes and counts beneath a node.
+  void refit_node(uint32_t idx) {
+    flat_kd_node& node = nodes[idx];
+    if (node.leaf) {
+      bounds box = empty_box();
+      uint32_t base = node.first * B;
+      for (uint32_t slot = base; slot < base + node.count; slot++) {
+        vector_2f pos{ xs[slot], ys[slot] };
+        box.min_bound = box.min_bound.min(pos);
+        box.max_bound = box.max_bound.max(pos);
+      }
+      node.box = box;
+      return;
+    }
+    refit_node(node.first);
+    refit_node(node.first + 1);
+    flat_kd_node const& left = nodes[node.first];
+    flat_kd_node const& right = nodes[node.first + 1];
+    node.box = box_union(left.box, right.box);
+    node.count = left.count + right.count;
+  }
+
+  bool is_unbalanced(flat_kd_node const& node, float balance_threshold) const {
+    return !node.leaf && (std::max(nodes[node.first].count, nodes[node.first + 1].count) > balance_threshold * node.count);
+  }
+
+  bool is_degraded(flat_kd_node const& node, float balance_threshold, float overlap_threshold) const {
+    if (node.leaf) {
+      return false;
+    }
+    if (node.count <= B / 2) {
+      return true; // small enough to collapse into a single leaf
+    }
+    if (is_unbalanced(node, balance_threshold)) {
+      return true;
+    }
+    flat_kd_node const& left = nodes[node.first];
+    flat_kd_node const& right = nodes[node.first + 1];
+    bounds overlap{ left.box.min_bound.max(right.box.min_bound), left.box.max_bound.min(right.box.max_bound) };
+    float smaller_area = std::min(box_area(left.box), box_area(right.box));
+    return (smaller_area > 0) && (box_area(overlap) > overlap_threshold * smaller_area);
+  }
+
+  // Writes the squared distance from pos to every slot in a block.
+  // Slots past the number of points in the leaf hold infinite distances.
+  void block_distances_squared(uint32_t block, vector_2f const& pos, float* out) const {
+    float const* bx = xs.data() + block * B;
+    float const* by = ys.data() + block * B;
+#ifdef FLAT_KD_TREE_SSE
+    __m128 px = _mm_set1_ps(pos.x);
+    __m128 py = _mm_set1_ps(pos.y);
+    for (size_t i = 0; i < B; i += 4) {
+      __m128 dx = _mm_sub_ps(_mm_loadu_ps(bx + i), px);
+      __m128 dy = _mm_sub_ps(_mm_loadu_ps(by + i), py);
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+#else
+    for (size_t i = 0; i < B; i++) {
+      float dx = bx[i] - pos.x;
+      float dy = by[i] - pos.y;
+      out[i] = dx * dx + dy * dy;
+    }
+#endif
+  }
+
+  // Visits the nodes which may hold points closer than the bound returned by max_dist_sq.
+  // Nearer children are visited first so the bound tightens as quickly as possible.
+  template<typename bound_func_type, typename leaf_func_type>
+  void search(vector_2f const& pos, bound_func_type max_dist_sq, leaf_func_type leaf_func) const {
+    if (nodes.empty()) {
+      return;
+    }
+    fixed_stack<uint32_t> stack;
+    stack.push(0);
+    alignas(16) std::array<float, B> dists;
+    while (!stack.empty()) {
+      flat_kd_node const& node = nodes[stack.pop()];
+      if (box_distance_squared(node.box, pos) > max_dist_sq()) {
+        continue; // nothing in this box can be closer than what has been found so far
+      }
+      if (node.leaf) {
+        block_distances_squared(node.first, pos, dists.data());
+        leaf_func(node.first, node.count, dists.data());
+        continue;
+      }
+      float coord = (node.division_axis == 0) ? pos.x : pos.y;
+      // put the far child bellow the near child on the stack
+      if (coord < node.split) {
+        stack.push(node.first + 1);
+        stack.push(node.first);
+      } else {
+        stack.push(node.first);
+        stack.push(node.first + 1);
+      }
+    }
+  }
+
+  V* value_ptr(uint32_t block, size_t slot) {
+    return &(values[block * B + slot]);
+  }
+
+public: // public methods
+
+  flat_kd_tree() {}
+
+  flat_kd_tree(std::vector<kd_node<V>> new_nodes) {
+    build(std::move(new_nodes));
+  }
+
+  // Builds the tree from scratch. The handle of each point is its index in new_nodes.
+  void build(std::vector<kd_node<V>> new_nodes) {
+    nodes.clear();
+    parents.clear();
+    xs.clear();
+    ys.clear();
+    values.clear();
+    slot_handles.clear();
+    block_leaves.clear();
+    free_handles.clear();
+    free_node_pairs.clear();
+    free_blocks.clear();
+
+    handle_slots.resize(new_nodes.size());
+    rebuild_records.clear();
+    rebuild_records.reserve(new_nodes.size());
+    for (size_t i = 0; i < new_nodes.size(); i++) {
+      rebuild_records.push_back({ new_nodes[i].pos, std::move(new_nodes[i].value), static_cast<handle_type>(i) });
+    }
+
+    nodes.emplace_back();
+    parents.push_back(no_parent);
+    build_subtree(0, rebuild_records.begin(), rebuild_records.end());
+  }
+
+  size_t size() const {
+    return nodes.empty() ? 0 : nodes[0].count;
+  }
+
+  bool empty() const {
+    return (size() == 0);
+  }
+
+  vector_2f position(handle_type handle) const {
+    uint32_t slot = handle_slots[handle];
+    return { xs[slot], ys[slot] };
+  }
+
+  V& value(handle_type handle) {
+    return values[handle_slots[handle]];
+  }
+
+  /*
+  Moves a point.
+  Queries stay correct straight away but bounds only grow until the next refit.
+  O(log n)
+  */
+  void move(handle_type handle, vector_2f const& pos) {
+    uint32_t slot = handle_slots[handle];
+    xs[slot] = pos.x;
+    ys[slot] = pos.y;
+    grow_to_root(block_leaves[slot / B], pos, 0);
+  }
+
+  /*
+  Inserts a point returning its handle.
+  The point goes into the leaf along its splitting path, a full leaf is split in two.
+  If that leaves a node along the path with one child holding more than insert_balance_threshold of its points
+  the topmost such subtree is rebuilt.
+  O(log^2 n) amortized, rebuilds sort each level of the subtree
+  */
+  handle_type insert(vector_2f const& pos, V value) {
+    handle_type handle = allocate_handle();
+    if (nodes.empty()) {
+      nodes.emplace_back();
+      parents.push_back(no_parent);
+      rebuild_records.clear();
+      rebuild_records.push_back({ pos, std::move(value), handle });
+      build_subtree(0, rebuild_records.begin(), rebuild_records.end());
+      return handle;
+    }
+
+    uint32_t idx = 0;
+    while (!nodes[idx].leaf) {
+      flat_kd_node const& node = nodes[idx];
+      float coord = (node.division_axis == 0) ? pos.x : pos.y;
+      idx = (coord < node.split) ? node.first : node.first + 1;
+    }
+
+    flat_kd_node& leaf = nodes[idx];
+    if (leaf.count < B) {
+      write_slot(leaf.first * B + leaf.count, pos, std::move(value), handle);
+      grow_to_root(idx, pos, 1);
+    } else {
+      rebuild_records.clear();
+      collect_subtree(idx);
+      rebuild_records.push_back({ pos, std::move(value), handle });
+      build_subtree(idx, rebuild_records.begin(), rebuild_records.end());
+      grow_to_root(parents[idx], pos, 1);
+    }
+
+    uint32_t unbalanced = no_parent;
+    for (idx = block_leaves[handle_slots[handle] / B]; idx != no_parent; idx = parents[idx]) {
+      if (is_unbalanced(nodes[idx], insert_balance_threshold)) {
+        unbalanced = idx;
+      }
+    }
+    if (unbalanced != no_parent) {
+      rebuild_subtree(unbalanced);
+    }
+    return handle;
+  }
+
+  /*
+  Removes a point, its handle may be reused by a later insert.
+  O(log n)
+  */
+  void remove(handle_type handle) {
+    uint32_t slot = handle_slots[handle];
+    uint32_t block = slot / B;
+    uint32_t leaf_idx = block_leaves[block];
+    flat_kd_node& leaf = nodes[leaf_idx];
+
+    // fill the hole with the last point of the block
+    uint32_t last = block * B + leaf.count - 1;
+    if (slot != last) {
+      write_slot(slot, { xs[last], ys[last] }, std::move(values[last]), slot_handles[last]);
+    }
+    clear_slot(last);
+    free_handles.push_back(handle);
+
+    for (uint32_t idx = leaf_idx; idx != no_parent; idx = parents[idx]) {
+      nodes[idx].count--;
+    }
+  }
+
+  /*
+  Tightens every box and rebuilds the topmost subtrees which have become unbalanced,
+  which have children whose boxes overlap too much, or which hold few enough points to be a single leaf.
+  balance_threshold is the largest fraction of a subtree's points one child may hold.
+  overlap_threshold is the largest fraction of the smaller child's box that may overlap its sibling.
+  Returns the number of subtrees rebuilt.
+  O(n) plus the cost of the rebuilt subtrees
+  */
+  size_t refit(float balance_threshold = 0.75f, float overlap_threshold = 0.5f) {
+    if (nodes.empty()) {
+      return 0;
+    }
+    refit_node(0);
+
+    size_t rebuilt = 0;
+    fixed_stack<uint32_t> stack;
+    stack.push(0);
+    while (!stack.empty()) {
+      uint32_t idx = stack.pop();
+      flat_kd_node const& node = nodes[idx];
+      if (is_degraded(node, balance_threshold, overlap_threshold)) {
+        rebuild_subtree(idx);
+        rebuilt++;
+      } else if (!node.leaf) {
+        stack.push(node.first);
+        stack.push(node.first + 1);
+      }
+    }
+    return rebuilt;
+  }
+
+  flat_kd_dist<V> find_closest(vector_2f const& pos) {
+    V* closest = nullptr;
+    float closest_dist_sq = std::numeric_limits<float>::max();
+    search(pos, [&closest_dist_sq]() {
+      return closest_dist_sq;
+    }, [&](uint32_t block, uint32_t count, float const* dists) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (dists[i] < closest_dist_sq) {
+          closest_dist_sq = dists[i];
+          closest = value_ptr(block, i);
+        }
+      }
+    });
+    if (closest == nullptr) {
+      return {};
+    }
+    return { closest, std::sqrt(closest_dist_sq) };
+  }
+
+  std::vector<flat_kd_dist<V>> find_count_closest(vector_2f const& pos, size_t count) {
+    // a max heap of squared distances
+    std::vector<flat_kd_dist<V>> closests;
+    closests.reserve(count);
+    if (count == 0) {
+      return closests;
+    }
+    search(pos, [&closests, count]() {
+      return (closests.size() < count) ? std::numeric_limits<float>::max() : closests.front().dist;
+    }, [&](uint32_t block, uint32_t leaf_count, float const* dists) {
+      for (uint32_t i = 0; i < leaf_count; i++) {
+        if (closests.size() < count) {
+          closests.emplace_back(value_ptr(block, i), dists[i]);
+          std::push_heap(closests.begin(), closests.end());
+        } else if (dists[i] < closests.front().dist) {
+          std::pop_heap(closests.begin(), closests.end());
+          closests.back() = { value_ptr(block, i), dists[i] };
+          std::push_heap(closests.begin(), closests.end());
+        }
+      }
+    });
+    std::sort_heap(closests.begin(), closests.end());
+    for (flat_kd_dist<V>& close : closests) {
+      close.dist = std::sqrt(close.dist);
+    }
+    return closests;
+  }
+
+  std::vector<flat_kd_dist<V>> find_within(vector_2f const& pos, float max_distance) {
+    std::vector<flat_kd_dist<V>> within;
+    float max_dist_sq = max_distance * max_distance;
+    search(pos, [max_dist_sq]() {
+      return max_dist_sq;
+    }, [&](uint32_t block, uint32_t count, float const* dists) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (dists[i] < max_dist_sq) {
+          within.emplace_back(value_ptr(block, i), dists[i]);
+        }
+      }
+    });
+    std::sort(within.begin(), within.end());
+    for (flat_kd_dist<V>& close : within) {
+      close.dist = std::sqrt(close.dist);
+    }
+    return within;
+  }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// frame_arena is a bump allocator for memory which only needs to live until the end of a frame.
+// Allocating moves a pointer through one block, freeing single allocations does nothing,
+// and reset() releases everything at once.
+// When a frame needs more than the block holds the extra memory comes from overflow blocks,
+// the next reset() replaces them with one block big enough for the whole frame
+// so after the first few frames the arena stops calling malloc at all.
+// Not thread safe, use one arena per thread.
+class frame_arena {
+private: // private varriables
+  std::unique_ptr<unsigned char[]> block;
+  size_t block_capacity;
+  size_t block_used = 0;
+
+  std::vector<std::unique_ptr<unsigned char[]>> overflow_blocks;
+  size_t overflow_used = 0; // bytes requested from overflow blocks since the last reset
+
+private: // private methods
+  static uintptr_t align_up(uintptr_t address, size_t alignment) {
+    assert((alignment & (alignment - 1)) == 0); // alignment must be a power of two
+    return (address + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+  }
+
+public: // public methods
+  explicit frame_arena(size_t initial_capacity = 1 << 20) :
+    block(new unsigned char[initial_capacity]),
+    block_capacity(initial_capacity) {
+  }
+
+  // do not copy or assign, allocators point to the arena
+  frame_arena(frame_arena&) = delete;
+  frame_arena& operator=(frame_arena const&) = delete;
+
+  /*
+  Returns bytes of memory aligned to alignment which stays valid until the next reset().
+  O(1)
+  */
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+    uintptr_t start = align_up(base + block_used, alignment);
+    if (start + bytes <= base + block_capacity) {
+      block_used = (start + bytes) - base;
+      return reinterpret_cast<void*>(start);
+    }
+
+    // the block is full, take a block of its own for this allocation
+    size_t padded = bytes + alignment;
+    overflow_blocks.emplace_back(new unsigned char[padded]);
+    overflow_used += padded;
+    return reinterpret_cast<void*>(align_up(reinterpret_cast<uintptr_t>(overflow_blocks.back().get()), alignment));
+  }
+
+  template<typename T>
+  T* allocate_array(size_t count) {
+    return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  /*
+  Releases every allocation.
+  If the last frame overflowed the block it is replaced with one that fits the whole frame.
+  O(1) unless the block grows
+  */
+  void reset() {
+    if (!overflow_blocks.empty()) {
+      size_t needed = block_used + overflow_used;
+      size_t new_capacity = block_capacity;
+      while (new_capacity < needed) {
+        new_capacity *= 2;
+      }
+      overflow_blocks.clear();
+      overflow_used = 0;
+      block.reset(new unsigned char[new_capacity]);
+      block_capacity = new_capacity;
+    }
+    block_used = 0;
+  }
+
+  // Bytes handed out since the last reset, including alignment padding.
+  size_t bytes_used() const {
+    return block_used + overflow_used;
+  }
+
+  // Bytes which can be handed out before the arena has to allocate.
+  size_t capacity() const {
+    return block_capacity;
+  }
+};
+
+/*
+A standard allocator handing out memory from a frame_arena.
+Deallocating does nothing, the memory comes back when the arena is reset,
+so containers using it must not be used after the reset.
+*/
+template<typename T>
+class arena_allocator {
+public:
+  using value_type = T;
+
+  frame_arena* arena;
+
+  arena_allocator(frame_arena& a) : arena(&a) {}
+
+  template<typename U>
+  arena_allocator(arena_allocator<U> const& other) : arena(other.arena) {}
+
+  T* allocate(size_t count) {
+    return arena->allocate_array<T>(count);
+  }
+
+  void deallocate(T*, size_t) {}
+
+  template<typename U>
+  bool operator==(arena_allocator<U> const& other) const {
+    return (arena == other.arena);
+  }
+
+  template<typename U>
+  bool operator!=(arena_allocator<U> const& other) const {
+    return (arena != other.arena);
+  }
+};
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
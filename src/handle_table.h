@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// handle_table gives objects which can be moved in memory a stable handle.
+// Slots live in a deque so their addresses never change when the table grows.
+// A handle is a slot pointer and the generation of the slot when the handle was taken,
+// releasing a slot bumps its generation so old handles resolve to null even after the slot is reused.
+template<typename T>
+class handle_table {
+public:
+  struct slot {
+    T* target;
+    uint32_t generation;
+    uint32_t index; // the slot's position in the table, with generation it names an object for as long as it lives
+  };
+
+  class handle {
+  private:
+    slot* target_slot;
+    uint32_t generation;
+
+  public:
+    handle() : target_slot(nullptr), generation(0) {}
+    handle(slot* s) : target_slot(s), generation((s == nullptr) ? 0 : s->generation) {}
+
+    /*
+    Returns the object the handle refers to, or null if the slot has been released since the handle was taken.
+    O(1)
+    */
+    T* get() const {
+      if ((target_slot == nullptr) || (target_slot->generation != generation)) {
+        return nullptr;
+      }
+      return target_slot->target;
+    }
+
+    bool operator==(handle const& other) const {
+      return (target_slot == other.target_slot) && (generation == other.generation);
+    }
+
+    bool operator!=(handle const& other) const {
+      return !(*this == other);
+    }
+  };
+
+private: // private varriables
+  std::deque<slot> slots;
+  std::vector<slot*> free_slots;
+
+public: // public methods
+  handle_table() {}
+
+  // do not copy or assign, handles point into the table
+  handle_table(handle_table&) = delete;
+  handle_table& operator=(handle_table const&) = delete;
+
+  /*
+  Takes a slot pointing at target.
+  O(1)
+  */
+  slot* acquire(T* target) {
+    slot* s;
+    if (free_slots.empty()) {
+      slots.push_back({ nullptr, 0, static_cast<uint32_t>(slots.size()) });
+      s = &slots.back();
+    } else {
+      s = free_slots.back();
+      free_slots.pop_back();
+    }
+    s->target = target;
+    return s;
+  }
+
+  /*
+  Releases the slot, every handle taken from it becomes null.
+  O(1)
+  */
+  void release(slot* s) {
+    assert(s != nullptr);
+    assert(s->target != nullptr);
+    s->target = nullptr;
+    s->generation++;
+    free_slots.push_back(s);
+  }
+
+  /*
+  Points the slot at the new location of its object after a move.
+  O(1)
+  */
+  static void retarget(slot* s, T* target) {
+    assert(s != nullptr);
+    s->target = target;
+  }
+
+  // The number of slots currently pointing at an object.
+  size_t size() const {
+    return slots.size() - free_slots.size();
+  }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+// fnv1a_hasher is a 64 bit FNV-1a hash that can be fed incrementally.
+// It is not cryptographic, it is for cache keys and checksums where a changed input
+// should give a different value with overwhelming probability.
+class fnv1a_hasher {
+private:
+  static constexpr uint64_t offset_basis = 14695981039346656037ull;
+  static constexpr uint64_t prime = 1099511628211ull;
+
+  uint64_t state = offset_basis;
+
+public:
+  /*
+  Adds size bytes to the hash.
+  O(size)
+  */
+  void add_bytes(void const* data, size_t size) {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; i++) {
+      state = (state ^ bytes[i]) * prime;
+    }
+  }
+
+  void add(std::string_view text) {
+    add_bytes(text.data(), text.size());
+  }
+
+  /*
+  Adds the bytes of a trivially copyable value, padding and all, so only use it on types without padding.
+  */
+  template<typename T>
+  void add_value(T const& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "only plain values can be hashed by their bytes");
+    add_bytes(&value, sizeof(T));
+  }
+
+  uint64_t value() const {
+    return state;
+  }
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// An input recording is the seed a world was made with plus every input callback it received,
+// each tagged with the tick it was delivered before. Ticks are the only clock the simulation has,
+// so replaying the callbacks before the same ticks re-runs the session exactly however fast it goes.
+//
+// Layout, all integers in the recorder's native byte order:
+//   input_recording_header
+//   events, each a varint count of ticks since the previous event, an input_event_kind byte and its payload:
+//     cursor: float x, float y in window coordinates
+//     mouse_button: uint8 button, uint8 action, uint8 mods
+//     key: int16 key, int32 scancode, uint8 action, uint8 mods
+
+constexpr uint32_t input_recording_version = 1;
+
+enum class input_event_kind : uint8_t {
+  cursor,
+  mouse_button,
+  key
+};
+
+struct input_recording_header {
+  char magic[4]; // "WMIR"
+  uint32_t version;
+  std::array<uint32_t, 4> seed;
+  uint64_t tick_count; // ticks run while recording, a replay runs this many
+  uint64_t event_count;
+};
+
+struct input_event {
+  uint64_t tick;
+  input_event_kind kind;
+  float x = 0; // cursor
+  float y = 0; // cursor
+  int button = 0; // mouse_button
+  int key = 0; // key
+  int scancode = 0; // key
+  int action = 0; // mouse_button and key
+  int mods = 0; // mouse_button and key
+};
+
+// Collects input callbacks as they happen, set_tick must be called before each tick's callbacks are delivered.
+class input_recorder {
+private:
+  std::array<uint32_t, 4> seed;
+  std::vector<unsigned char> bytes;
+  uint64_t current_tick = 0;
+  uint64_t last_event_tick = 0;
+  uint64_t event_count = 0;
+
+  template<typename T>
+  void put(T value) {
+    unsigned char const* raw = reinterpret_cast<unsigned char const*>(&value);
+    bytes.insert(bytes.end(), raw, raw + sizeof(T));
+  }
+
+  void begin_event(input_event_kind kind) {
+    uint64_t delta = current_tick - last_event_tick;
+    while (delta >= 0x80) {
+      bytes.push_back(static_cast<unsigned char>(delta | 0x80));
+      delta >>= 7;
+    }
+    bytes.push_back(static_cast<unsigned char>(delta));
+    bytes.push_back(static_cast<unsigned char>(kind));
+    last_event_tick = current_tick;
+    event_count++;
+  }
+
+public:
+  explicit input_recorder(std::array<uint32_t, 4> const& world_seed) : seed(world_seed) {}
+
+  // do not copy or assign
+  input_recorder(input_recorder&) = delete;
+  input_recorder& operator=(const input_recorder&) = delete;
+
+  void set_tick(uint64_t tick) {
+    assert(tick >= current_tick);
+    current_tick = tick;
+  }
+
+  void cursor(double xpos, double ypos) {
+    begin_event(input_event_kind::cursor);
+    put(static_cast<float>(xpos));
+    put(static_cast<float>(ypos));
+  }
+
+  void mouse_button(int button, int action, int mods) {
+    begin_event(input_event_kind::mouse_button);
+    put(static_cast<uint8_t>(button));
+    put(static_cast<uint8_t>(action));
+    put(static_cast<uint8_t>(mods));
+  }
+
+  void key(int key, int scancode, int action, int mods) {
+    begin_event(input_event_kind::key);
+    put(static_cast<int16_t>(key));
+    put(static_cast<int32_t>(scancode));
+    put(static_cast<uint8_t>(action));
+    put(static_cast<uint8_t>(mods));
+  }
+
+  size_t size_bytes() const {
+    return sizeof(input_recording_header) + bytes.size();
+  }
+
+  /*
+  Writes the recording of the first tick_count ticks, returning false if the file could not be written.
+  O(n)
+  */
+  bool write(char const* filename, uint64_t tick_count) const {
+    FILE* out = fopen(filename, "wb");
+    if (out == nullptr) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+      return false;
+    }
+    input_recording_header header{};
+    std::memcpy(header.magic, "WMIR", 4);
+    header.version = input_recording_version;
+    header.seed = seed;
+    header.tick_count = tick_count;
+    header.event_count = event_count;
+    bool ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    ok = ok && (fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size());
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+    }
+    return ok;
+  }
+};
+
+// A decoded recording, hands back its events tick by tick.
+class input_recording {
+private:
+  input_recording_header header{};
+  std::vector<input_event> events;
+  size_t next_event = 0;
+  bool valid_ = false;
+
+  template<typename T>
+  static bool get(unsigned char const*& at, unsigned char const* end, T& value) {
+    if (static_cast<size_t>(end - at) < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, at, sizeof(T));
+    at += sizeof(T);
+    return true;
+  }
+
+  static bool get_varint(unsigned char const*& at, unsigned char const* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (at == end) {
+        return false;
+      }
+      unsigned char byte = *(at++);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool decode(unsigned char const* at, unsigned char const* end) {
+    if (!get(at, end, header) || (std::memcmp(header.magic, "WMIR", 4) != 0) || (header.version != input_recording_version)) {
+      return false;
+    }
+    if (header.event_count > static_cast<uint64_t>(end - at) / 2) { // every event is at least 2 bytes
+      return false;
+    }
+    events.reserve(static_cast<size_t>(header.event_count));
+    uint64_t tick = 0;
+    for (uint64_t i = 0; i < header.event_count; i++) {
+      uint64_t delta;
+      uint8_t kind;
+      if (!get_varint(at, end, delta) || !get(at, end, kind)) {
+        return false;
+      }
+      tick += delta;
+      input_event event;
+      event.tick = tick;
+      event.kind = static_cast<input_event_kind>(kind);
+      bool ok = false;
+      if (event.kind == input_event_kind::cursor) {
+        ok = get(at, end, event.x) && get(at, end, event.y);
+      } else if (event.kind == input_event_kind::mouse_button) {
+        uint8_t button, action, mods;
+        ok = get(at, end, button) && get(at, end, action) && get(at, end, mods);
+        event.button = button;
+        event.action = action;
+        event.mods = mods;
+      } else if (event.kind == input_event_kind::key) {
+        int16_t key;
+        int32_t scancode;
+        uint8_t action, mods;
+        ok = get(at, end, key) && get(at, end, scancode) && get(at, end, action) && get(at, end, mods);
+        event.key = key;
+        event.scancode = scancode;
+        event.action = action;
+        event.mods = mods;
+      }
+      if (!ok) {
+        return false;
+      }
+      events.push_back(event);
+    }
+    return (at == end);
+  }
+
+public:
+  /*
+  Reads a recording written by input_recorder, the recording is invalid if the file is missing or malformed.
+  O(n)
+  */
+  explicit input_recording(char const* filename) {
+    mapped_file file{ filename };
+    if (!file.report(filename)) {
+      return;
+    }
+    valid_ = decode(file.data(), file.data() + file.size());
+    if (!valid_) {
+      fprintf(stderr, "%s is not an input recording of version %u\n", filename, input_recording_version);
+      events.clear();
+    }
+  }
+
+  bool valid() const {
+    return valid_;
+  }
+
+  std::array<uint32_t, 4> const& seed() const {
+    return header.seed;
+  }
+
+  uint64_t tick_count() const {
+    return header.tick_count;
+  }
+
+  std::vector<input_event> const& all_events() const {
+    return events;
+  }
+
+  /*
+  Delivers the events recorded before tick to target's key_callback, cursor_position_callback
+  and mouse_button_callback, ticks must be asked for in increasing order.
+  O(events delivered)
+  */
+  template<typename T>
+  void deliver(uint64_t tick, T& target) {
+    while ((next_event < events.size()) && (events[next_event].tick <= tick)) {
+      input_event const& event = events[next_event];
+      if (event.kind == input_event_kind::cursor) {
+        target.cursor_position_callback(event.x, event.y);
+      } else if (event.kind == input_event_kind::mouse_button) {
+        target.mouse_button_callback(event.button, event.action, event.mods);
+      } else {
+        target.key_callback(event.key, event.scancode, event.action, event.mods);
+      }
+      next_event++;
+    }
+  }
+};
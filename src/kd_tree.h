@@ -1,10 +1,17 @@
 #pragma once
 
 #include "2d_math.h"
+#include "geom.h"
+#include "frame_arena.h"
+#include "morton.h"
+#include "worker_pool.h"
 #include <algorithm>
+#include <cassert>
 #include <functional>
 #include <cmath>
 #include <limits>
+#include <cstdint>
+#include <vector>
 
 template<typename V>
 struct kd_node {
@@ -26,6 +33,9 @@ struct kd_node_dist {
   }
 };
 
+// kd_tree keeps its nodes in one array where each range's median node splits the rest of the range in two,
+// so the layout has no per node bounds to refit and an insert would shift the array.
+// It is only ever rebuilt, for a spatial index kept live across ticks see flat_kd_tree.
 template<typename V>
 class kd_tree {
 private: // static members
@@ -55,6 +65,8 @@ private: // static members
 
   using vec_it = typename std::vector<kd_node<V>>::iterator;
   using vec_dst = typename std::vector<kd_node<V>>::difference_type;
+  using result_list = std::vector<kd_node_dist<V>>;
+  using arena_result_list = arena_vector<kd_node_dist<V>>;
 
   struct build_arg {
     vec_it start;
@@ -77,7 +89,8 @@ private: // static members
 
   };
 
-  static void consider_for_closests(search_ctx const& ctx, std::vector<kd_node_dist<V>>& closests, kd_node<V>& node) {
+  template<typename list_type>
+  static void consider_for_closests(search_ctx const& ctx, list_type& closests, kd_node<V>& node) {
     if (closests.size() < closests.capacity()) {
       closests.push_back({ node, ctx.pos });
       std::push_heap(closests.begin(), closests.end());
@@ -91,7 +104,8 @@ private: // static members
     }
   }
 
-  static bool skip_given_closests(search_ctx const& ctx, std::vector<kd_node_dist<V>>& closests, float min_dist) {
+  template<typename list_type>
+  static bool skip_given_closests(search_ctx const& ctx, list_type& closests, float min_dist) {
     if (closests.size() < closests.capacity()) {
       return false;
     } else {
@@ -107,22 +121,106 @@ private: // static members
     return (min_dist > closest.dist);
   }
 
-  static void consider_within_distance(search_ctx const& ctx, std::vector<kd_node_dist<V>>& within, kd_node<V>& node) {
+  template<typename list_type>
+  static void consider_within_distance(search_ctx const& ctx, list_type& within, kd_node<V>& node) {
     kd_node_dist<V> new_node{ node, ctx.pos };
     if (new_node.dist < ctx._max_dist) {
       within.push_back(new_node);
     }
   }
 
-  static bool skip_given_distance(search_ctx const& ctx, std::vector<kd_node_dist<V>>& within, float min_dist) {
+  template<typename list_type>
+  static bool skip_given_distance(search_ctx const& ctx, list_type& within, float min_dist) {
     return (min_dist > ctx._max_dist);
   }
 
+  // A heap of closest nodes bounded by a count rather than by the capacity of its storage,
+  // so the storage can be kept between batches asking for different counts.
+  struct bounded_closests {
+    std::vector<kd_node_dist<V>> items;
+    size_t bound = 0;
+
+    size_t size() const {
+      return items.size();
+    }
+
+    size_t capacity() const {
+      return bound;
+    }
+
+    void push_back(kd_node_dist<V> const& item) {
+      items.push_back(item);
+    }
+
+    kd_node_dist<V>& front() {
+      return items.front();
+    }
+
+    kd_node_dist<V>& back() {
+      return items.back();
+    }
+
+    typename std::vector<kd_node_dist<V>>::iterator begin() {
+      return items.begin();
+    }
+
+    typename std::vector<kd_node_dist<V>>::iterator end() {
+      return items.end();
+    }
+  };
+
+  // Per worker scratch space for batched queries.
+  struct batch_scratch {
+    std::vector<search_arg> arg_stack;
+    bounded_closests closests;
+  };
+
+  struct batch_entry {
+    uint32_t key;
+    uint32_t idx;
+
+    bool operator<(batch_entry const& other) const {
+      return (key < other.key);
+    }
+  };
+
+  // A range of node offsets still to be built, used by the parallel builders.
+  struct build_range {
+    size_t start;
+    size_t stop;
+    int division_axis;
+  };
+
+  // Search stacks taken from an arena start with room for this many entries, enough for a balanced tree of 2^32 nodes
+  // so they never regrow and leave dead copies in the arena.
+  static constexpr size_t arena_stack_reserve = 64;
+
+  // Ranges smaller than this are always finished by a single worker.
+  static constexpr size_t parallel_build_min_range = 2048;
+
+  // Top level splitting stops once there are this many ranges per worker.
+  static constexpr size_t parallel_build_ranges_per_worker = 4;
+
 private: // private varriables
 
   // The nodes in the kd tree.
   std::vector<kd_node<V>> nodes;
 
+  // Scratch space reused between batched queries.
+  std::vector<batch_entry> batch_order;
+  std::vector<batch_scratch> batch_scratches;
+
+  // Scratch space reused between parallel builds.
+  std::vector<build_range> build_level;
+  std::vector<build_range> build_next_level;
+  std::vector<std::vector<build_range>> build_stacks;
+
+  // Node indices sorted by x and by y for build_presorted, and which side of the current median each node is on.
+  std::vector<uint32_t> build_x_order;
+  std::vector<uint32_t> build_y_order;
+  std::vector<uint32_t> build_order_scratch;
+  std::vector<uint8_t> build_side;
+
 private: // private methods
 
   void inner_build_recursive(vec_it start, vec_it stop, int division_axis) {
@@ -180,13 +278,9 @@ private: // private methods
   }
 
   template<typename closest_type, typename skip_func_type, skip_func_type skip_func,
-    typename consider_func_type, consider_func_type consider_func>
-  void inner_find_closest_iterative(search_ctx const& ctx, closest_type& closest) {
-
-    // TODO consider pre-allocating
-    // TODO consider putting in class
-    std::vector<search_arg> arg_stack;
-    
+    typename consider_func_type, consider_func_type consider_func, typename stack_type>
+  void inner_find_closest_iterative(search_ctx const& ctx, closest_type& closest, stack_type& arg_stack) {
+    arg_stack.clear();
     arg_stack.push_back({ nodes.begin(), nodes.end(), 0, nullptr });
 
     while (!arg_stack.empty()) {
@@ -231,6 +325,143 @@ private: // private methods
     }
   }
 
+  // Sorts the queries along a Z-order curve over the bounds of the queries.
+  void order_batch(vector_2f const* positions, size_t count) {
+    batch_order.resize(count);
+    if (count == 0) {
+      return;
+    }
+    bounds query_bounds{ positions[0], positions[0] };
+    for (size_t i = 1; i < count; i++) {
+      query_bounds.min_bound = query_bounds.min_bound.min(positions[i]);
+      query_bounds.max_bound = query_bounds.max_bound.max(positions[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+      batch_order[i] = { morton::encode(positions[i], query_bounds), static_cast<uint32_t>(i) };
+    }
+    std::sort(batch_order.begin(), batch_order.end());
+  }
+
+  // Runs query(scratch, idx) for every query index in Morton order split into one contiguous run per worker.
+  template<typename query_func_type>
+  void run_batch(vector_2f const* positions, size_t count, worker_pool* pool, query_func_type query) {
+    order_batch(positions, count);
+    size_t worker_count = (pool == nullptr) ? 1 : pool->size();
+    if (batch_scratches.size() < worker_count) {
+      batch_scratches.resize(worker_count);
+    }
+    if (pool == nullptr) {
+      for (batch_entry const& entry : batch_order) {
+        query(batch_scratches[0], entry.idx);
+      }
+      return;
+    }
+    pool->parallel_for(count, [this, &query](size_t worker_idx, size_t begin, size_t end) {
+      batch_scratch& scratch = batch_scratches[worker_idx];
+      for (size_t i = begin; i < end; i++) {
+        query(scratch, batch_order[i].idx);
+      }
+    });
+  }
+
+  // Places the median of the range on its division axis, exactly as one step of build_iterative does.
+  void nth_element_step(build_range const& range) {
+    vec_it start = nodes.begin() + range.start;
+    vec_it stop = nodes.begin() + range.stop;
+    vec_dst median_offset = std::distance(start, stop) / 2;
+    if (range.division_axis == 0) {
+      std::nth_element(start, start + median_offset, stop, compare_kd_node_x);
+    } else {
+      std::nth_element(start, start + median_offset, stop, compare_kd_node_y);
+    }
+  }
+
+  /*
+  Places the median of the range using the presorted orders.
+  The order along the division axis already has the median in place, the other order is
+  stably partitioned around it so both orders hold the same nodes in every sub range. O(n)
+  */
+  void presorted_step(build_range const& range) {
+    std::vector<uint32_t>& primary = (range.division_axis == 0) ? build_x_order : build_y_order;
+    std::vector<uint32_t>& secondary = (range.division_axis == 0) ? build_y_order : build_x_order;
+    size_t median = range.start + (range.stop - range.start) / 2;
+
+    for (size_t i = range.start; i < range.stop; i++) {
+      build_side[primary[i]] = (i < median) ? 0 : ((i == median) ? 1 : 2);
+    }
+    size_t left = range.start;
+    size_t right = median + 1;
+    for (size_t i = range.start; i < range.stop; i++) {
+      uint32_t idx = secondary[i];
+      uint8_t side = build_side[idx];
+      if (side == 0) {
+        build_order_scratch[left++] = idx;
+      } else if (side == 2) {
+        build_order_scratch[right++] = idx;
+      } else {
+        build_order_scratch[median] = idx;
+      }
+    }
+    std::copy(build_order_scratch.begin() + range.start, build_order_scratch.begin() + range.stop, secondary.begin() + range.start);
+  }
+
+  /*
+  Builds the tree with step(range) placing the median of every range.
+  The top levels are split breadth first with the ranges of each level spread over the pool,
+  then every remaining range is finished depth first by a single worker.
+  Ranges never overlap and each is handled by the same steps as the serial build, so the layout does not depend on the pool.
+  */
+  template<typename step_func_type>
+  void build_in_parallel(worker_pool* pool, step_func_type step) {
+    size_t worker_count = (pool == nullptr) ? 1 : pool->size();
+    if (build_stacks.size() < worker_count) {
+      build_stacks.resize(worker_count);
+    }
+
+    build_level.clear();
+    build_level.push_back({ 0, nodes.size(), 0 });
+    size_t target_ranges = worker_count * parallel_build_ranges_per_worker;
+    while ((worker_count > 1) && (build_level.size() < target_ranges)
+      && (build_level.front().stop - build_level.front().start >= parallel_build_min_range)) {
+      build_next_level.resize(build_level.size() * 2);
+      pool->parallel_for(build_level.size(), [this, &step](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          build_range range = build_level[i];
+          size_t median = range.start + (range.stop - range.start) / 2;
+          int next_axis = next_division_axis(range.division_axis);
+          step(range);
+          build_next_level[i * 2] = { range.start, median, next_axis }; // [start, median)
+          build_next_level[i * 2 + 1] = { median + 1, range.stop, next_axis }; // (median, stop)
+        }
+      });
+      std::swap(build_level, build_next_level);
+    }
+
+    auto finish = [this, &step](size_t worker_idx, size_t begin, size_t end) {
+      std::vector<build_range>& range_stack = build_stacks[worker_idx];
+      for (size_t i = begin; i < end; i++) {
+        range_stack.push_back(build_level[i]);
+        while (!range_stack.empty()) {
+          build_range range = range_stack.back();
+          range_stack.pop_back();
+          if (range.stop - range.start <= 1) { // sorting 1 or fewer elements need not happen
+            continue;
+          }
+          size_t median = range.start + (range.stop - range.start) / 2;
+          int next_axis = next_division_axis(range.division_axis);
+          step(range);
+          range_stack.push_back({ range.start, median, next_axis }); // [start, median)
+          range_stack.push_back({ median + 1, range.stop, next_axis }); // (median, stop)
+        }
+      }
+    };
+    if (worker_count == 1) {
+      finish(0, 0, build_level.size());
+    } else {
+      pool->parallel_for(build_level.size(), finish);
+    }
+  }
+
 public: // public methods
 
   kd_tree() {}
@@ -280,6 +511,71 @@ public: // public methods
     }
   }
 
+  /*
+  Builds the same tree as build_iterative with the top level subtrees split across the workers of the pool.
+  Every sub range is partitioned by the same nth_element calls as the serial build so the node layout is identical.
+  */
+  void build_parallel(std::vector<kd_node<V>> new_nodes, worker_pool& pool) {
+    nodes = std::move(new_nodes);
+    build_in_parallel(&pool, [this](build_range const& range) {
+      nth_element_step(range);
+    });
+  }
+
+  /*
+  Builds the tree from node indices presorted by x and by y, in parallel if a pool is given.
+  The two sorts are the only O(n log n) work, each level after that is a linear partition.
+  When no two nodes share an x or a y coordinate the layout is identical to build_iterative,
+  otherwise ties may place equal nodes on the other side of a median, which searches handle either way.
+  */
+  void build_presorted(std::vector<kd_node<V>> new_nodes, worker_pool* pool = nullptr) {
+    size_t count = new_nodes.size();
+    assert(count <= std::numeric_limits<uint32_t>::max());
+    build_x_order.resize(count);
+    build_y_order.resize(count);
+    build_order_scratch.resize(count);
+    build_side.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      build_x_order[i] = static_cast<uint32_t>(i);
+    }
+    build_y_order = build_x_order;
+
+    std::vector<kd_node<V>> const& unsorted = new_nodes;
+    auto sort_order = [this, &unsorted](size_t, size_t begin, size_t end) {
+      for (size_t axis = begin; axis < end; axis++) {
+        std::vector<uint32_t>& order = (axis == 0) ? build_x_order : build_y_order;
+        std::sort(order.begin(), order.end(), [&unsorted, axis](uint32_t left, uint32_t right) {
+          float left_coord = (axis == 0) ? unsorted[left].pos.x : unsorted[left].pos.y;
+          float right_coord = (axis == 0) ? unsorted[right].pos.x : unsorted[right].pos.y;
+          return (left_coord < right_coord) || ((left_coord == right_coord) && (left < right));
+        });
+      }
+    };
+    if (pool == nullptr) {
+      sort_order(0, 0, 2);
+    } else {
+      pool->parallel_for(2, sort_order);
+    }
+
+    nodes = std::move(new_nodes);
+    build_in_parallel(pool, [this](build_range const& range) {
+      presorted_step(range);
+    });
+
+    // both orders now hold the final layout
+    std::vector<kd_node<V>> sorted;
+    sorted.reserve(count);
+    for (uint32_t idx : build_x_order) {
+      sorted.push_back(std::move(nodes[idx]));
+    }
+    nodes = std::move(sorted);
+  }
+
+  // The nodes in tree order.
+  std::vector<kd_node<V>> const& get_nodes() const {
+    return nodes;
+  }
+
   // O(n) brute force nearest neighbour
   kd_node<V>* find_closest_brute(vector_2f const& pos) {
     kd_node_dist<V> closest{};
@@ -322,8 +618,8 @@ public: // public methods
     std::vector<kd_node_dist<V>> closests;
     closests.reserve(count);
     inner_find_closest_recursive<decltype(closests),
-      decltype(skip_given_closests), skip_given_closests,
-      decltype(consider_for_closests), consider_for_closests>
+      decltype(skip_given_closests<result_list>), skip_given_closests<result_list>,
+      decltype(consider_for_closests<result_list>), consider_for_closests<result_list>>
       (pos, nodes.begin(), nodes.end(), 0, closests);
     std::sort(closests.begin(), closests.end());
     return closests;
@@ -333,8 +629,8 @@ public: // public methods
     std::vector<kd_node_dist<V>> within;
 
     inner_find_closest_recursive<decltype(within),
-      decltype(skip_given_distance), skip_given_distance,
-      decltype(consider_within_distance), consider_within_distance>
+      decltype(skip_given_distance<result_list>), skip_given_distance<result_list>,
+      decltype(consider_within_distance<result_list>), consider_within_distance<result_list>>
       ({ pos, max_distance }, nodes.begin(), nodes.end(), 0, within);
     std::sort(within.begin(), within.end());
     return within;
@@ -342,31 +638,133 @@ public: // public methods
 
   kd_node<V>* find_closest_iterative(vector_2f const& pos) {
     kd_node_dist<V> closest{};
+    std::vector<search_arg> arg_stack;
     inner_find_closest_iterative<decltype(closest),
       decltype(skip_given_closest), skip_given_closest,
-      decltype(consider_for_closest), consider_for_closest>(pos, closest);
+      decltype(consider_for_closest), consider_for_closest>(pos, closest, arg_stack);
     return closest.ptr;
   }
 
   std::vector<kd_node_dist<V>> find_count_closest_iterative(vector_2f const& pos, size_t count) {
     std::vector<kd_node_dist<V>> closests;
     closests.reserve(count);
+    std::vector<search_arg> arg_stack;
     inner_find_closest_iterative<decltype(closests),
-      decltype(skip_given_closests), skip_given_closests,
-      decltype(consider_for_closests), consider_for_closests>(pos, closests);
+      decltype(skip_given_closests<result_list>), skip_given_closests<result_list>,
+      decltype(consider_for_closests<result_list>), consider_for_closests<result_list>>(pos, closests, arg_stack);
     std::sort(closests.begin(), closests.end());
     return closests;
   }
 
   std::vector<kd_node_dist<V>> find_within_iterative(vector_2f const& pos, float max_distance) {
     std::vector<kd_node_dist<V>> within;
+    std::vector<search_arg> arg_stack;
+    inner_find_closest_iterative<decltype(within),
+      decltype(skip_given_distance<result_list>), skip_given_distance<result_list>,
+      decltype(consider_within_distance<result_list>), consider_within_distance<result_list>>
+      ({ pos, max_distance }, within, arg_stack);
+    std::sort(within.begin(), within.end());
+    return within;
+  }
+
+  /*
+  The same searches with the search stack and results taken from a frame_arena so they do not touch the heap.
+  The results are only valid until the arena is reset.
+  */
+  kd_node<V>* find_closest_iterative(vector_2f const& pos, frame_arena& arena) {
+    kd_node_dist<V> closest{};
+    arena_vector<search_arg> arg_stack{ arena };
+    arg_stack.reserve(arena_stack_reserve);
+    inner_find_closest_iterative<decltype(closest),
+      decltype(skip_given_closest), skip_given_closest,
+      decltype(consider_for_closest), consider_for_closest>(pos, closest, arg_stack);
+    return closest.ptr;
+  }
 
+  arena_vector<kd_node_dist<V>> find_count_closest_iterative(vector_2f const& pos, size_t count, frame_arena& arena) {
+    arena_result_list closests{ arena };
+    closests.reserve(count);
+    arena_vector<search_arg> arg_stack{ arena };
+    arg_stack.reserve(arena_stack_reserve);
+    inner_find_closest_iterative<decltype(closests),
+      decltype(skip_given_closests<arena_result_list>), skip_given_closests<arena_result_list>,
+      decltype(consider_for_closests<arena_result_list>), consider_for_closests<arena_result_list>>(pos, closests, arg_stack);
+    std::sort(closests.begin(), closests.end());
+    return closests;
+  }
+
+  arena_vector<kd_node_dist<V>> find_within_iterative(vector_2f const& pos, float max_distance, frame_arena& arena) {
+    arena_result_list within{ arena };
+    arena_vector<search_arg> arg_stack{ arena };
+    arg_stack.reserve(arena_stack_reserve);
     inner_find_closest_iterative<decltype(within),
-      decltype(skip_given_distance), skip_given_distance,
-      decltype(consider_within_distance), consider_within_distance>
-      ({ pos, max_distance }, within);
+      decltype(skip_given_distance<arena_result_list>), skip_given_distance<arena_result_list>,
+      decltype(consider_within_distance<arena_result_list>), consider_within_distance<arena_result_list>>
+      ({ pos, max_distance }, within, arg_stack);
     std::sort(within.begin(), within.end());
     return within;
   }
 
+  // The batched queries keep their scratch space in the tree, so unlike the single queries they change the tree
+  // and two threads must not run batches on the same tree at once. One batch is spread over a pool by passing it in.
+
+  /*
+  Finds the closest node to each of count positions and writes it to closests[i].
+  Queries are run in Morton order so consecutive searches walk the same part of the tree,
+  and are split across the workers of the pool if one is given.
+  Scratch space is kept in the tree so repeated batches of the same size do not allocate.
+  */
+  void find_closest_batch(vector_2f const* positions, size_t count, kd_node<V>** closests, worker_pool* pool = nullptr) {
+    run_batch(positions, count, pool, [this, positions, closests](batch_scratch& scratch, size_t idx) {
+      kd_node_dist<V> closest{};
+      inner_find_closest_iterative<decltype(closest),
+        decltype(skip_given_closest), skip_given_closest,
+        decltype(consider_for_closest), consider_for_closest>(positions[idx], closest, scratch.arg_stack);
+      closests[idx] = closest.ptr;
+    });
+  }
+
+  /*
+  Finds the closest_count closest nodes to each of count positions.
+  The results for position i are written sorted to closests[i * closest_count] through closests[(i + 1) * closest_count - 1].
+  When there are fewer than closest_count nodes the remaining entries have a null ptr.
+  */
+  void find_count_closest_batch(vector_2f const* positions, size_t count, size_t closest_count, kd_node_dist<V>* closests, worker_pool* pool = nullptr) {
+    run_batch(positions, count, pool, [this, positions, closest_count, closests](batch_scratch& scratch, size_t idx) {
+      bounded_closests& heap = scratch.closests;
+      heap.bound = closest_count;
+      if (heap.items.capacity() < closest_count) {
+        heap.items.reserve(closest_count);
+      }
+      heap.items.clear();
+      inner_find_closest_iterative<bounded_closests,
+        decltype(skip_given_closests<bounded_closests>), skip_given_closests<bounded_closests>,
+        decltype(consider_for_closests<bounded_closests>), consider_for_closests<bounded_closests>>(positions[idx], heap, scratch.arg_stack);
+      std::sort(heap.begin(), heap.end());
+      kd_node_dist<V>* out = closests + idx * closest_count;
+      std::copy(heap.begin(), heap.end(), out);
+      std::fill(out + heap.size(), out + closest_count, kd_node_dist<V>{});
+    });
+  }
+
+  /*
+  Finds the nodes within max_distance of each of count positions.
+  within is resized to at least count and within[i] is overwritten with the sorted results for position i.
+  Reusing within across calls lets the result vectors keep their capacity.
+  */
+  void find_within_batch(vector_2f const* positions, size_t count, float max_distance, std::vector<std::vector<kd_node_dist<V>>>& within, worker_pool* pool = nullptr) {
+    if (within.size() < count) {
+      within.resize(count);
+    }
+    run_batch(positions, count, pool, [this, positions, max_distance, &within](batch_scratch& scratch, size_t idx) {
+      std::vector<kd_node_dist<V>>& found = within[idx];
+      found.clear();
+      inner_find_closest_iterative<std::vector<kd_node_dist<V>>,
+        decltype(skip_given_distance<result_list>), skip_given_distance<result_list>,
+        decltype(consider_within_distance<result_list>), consider_within_distance<result_list>>
+        ({ positions[idx], max_distance }, found, scratch.arg_stack);
+      std::sort(found.begin(), found.end());
+    });
+  }
+
 };
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Lockstep keeps several copies of a simulation identical by sending only commands between them.
+// Every peer sends its commands for a tick input_delay ticks ahead, waits until it has every peer's
+// commands for the current tick, applies them all in peer order and steps. Peers also send a checksum
+// of their state after each tick with their next packet, so a simulation that is not deterministic
+// is caught on the first tick where two peers' states differ.
+//
+// Peers may each run on their own thread or be stepped in turn on one thread, input_delay is at least 1
+// so a peer never waits on commands another peer has not had its turn to send.
+
+constexpr uint64_t lockstep_no_tick = std::numeric_limits<uint64_t>::max();
+
+struct lockstep_packet {
+  uint32_t peer;
+  uint64_t tick; // the tick commands are for, or lockstep_no_tick for a packet only carrying a checksum
+  std::vector<unsigned char> commands;
+  uint64_t checksum_tick; // the tick checksum is of, or lockstep_no_tick
+  uint64_t checksum;
+};
+
+// Delivers packets between the peers of one session, thread safe.
+class lockstep_network {
+private:
+  struct mailbox {
+    std::mutex lock;
+    std::condition_variable arrived;
+    std::deque<lockstep_packet> packets;
+  };
+
+  std::vector<mailbox> mailboxes;
+
+public:
+  explicit lockstep_network(uint32_t peer_count) : mailboxes(peer_count) {}
+
+  // do not copy or assign
+  lockstep_network(lockstep_network&) = delete;
+  lockstep_network& operator=(const lockstep_network&) = delete;
+
+  uint32_t peer_count() const {
+    return static_cast<uint32_t>(mailboxes.size());
+  }
+
+  /*
+  Sends the packet to every peer but its sender.
+  O(peers)
+  */
+  void broadcast(lockstep_packet const& packet) {
+    for (uint32_t peer = 0; peer < peer_count(); peer++) {
+      if (peer == packet.peer) {
+        continue;
+      }
+      mailbox& box = mailboxes[peer];
+      {
+        std::lock_guard<std::mutex> guard(box.lock);
+        box.packets.push_back(packet);
+      }
+      box.arrived.notify_one();
+    }
+  }
+
+  /*
+  Waits for the next packet sent to peer.
+  */
+  lockstep_packet receive(uint32_t peer) {
+    mailbox& box = mailboxes[peer];
+    std::unique_lock<std::mutex> guard(box.lock);
+    box.arrived.wait(guard, [&box]() {
+      return !box.packets.empty();
+    });
+    lockstep_packet packet = std::move(box.packets.front());
+    box.packets.pop_front();
+    return packet;
+  }
+};
+
+// One peer's side of a lockstep session, see the top of the file. Each tick is exchange, step, finish_tick.
+class lockstep_peer {
+private:
+  struct tick_commands {
+    std::vector<std::vector<unsigned char>> commands; // by peer
+    std::vector<bool> received;
+    uint32_t received_count = 0;
+  };
+
+  struct tick_checksums {
+    std::vector<uint64_t> checksums; // by peer
+    std::vector<bool> received;
+  };
+
+  lockstep_network& network;
+  uint32_t const id;
+  uint32_t const input_delay;
+  uint64_t current_tick = 0;
+  uint64_t last_checksum_tick = lockstep_no_tick;
+  uint64_t last_checksum = 0;
+  uint64_t first_desync = lockstep_no_tick;
+  std::map<uint64_t, tick_commands> commands_by_tick;
+  std::map<uint64_t, tick_checksums> checksums_by_tick;
+  std::vector<bool> peer_left;
+
+  tick_commands& commands_at(uint64_t tick) {
+    tick_commands& at = commands_by_tick[tick];
+    if (at.received.empty()) {
+      at.commands.resize(network.peer_count());
+      at.received.resize(network.peer_count());
+    }
+    return at;
+  }
+
+  /*
+  Stores the checksum of peer for tick, comparing it with every other peer's checksum for the tick known so far.
+  A tick's checksums are dropped once all of them have been compared.
+  */
+  void add_checksum(uint32_t peer, uint64_t tick, uint64_t checksum) {
+    tick_checksums& at = checksums_by_tick[tick];
+    if (at.received.empty()) {
+      at.checksums.resize(network.peer_count());
+      at.received.resize(network.peer_count());
+    }
+    bool all_received = true;
+    for (uint32_t other = 0; other < network.peer_count(); other++) {
+      if (at.received[other] && (at.checksums[other] != checksum) && (tick < first_desync)) {
+        first_desync = tick;
+      }
+      all_received = all_received && (at.received[other] || (other == peer));
+    }
+    at.checksums[peer] = checksum;
+    at.received[peer] = true;
+    if (all_received) {
+      checksums_by_tick.erase(tick);
+    }
+  }
+
+  void handle(lockstep_packet& packet) {
+    assert((packet.peer < network.peer_count()) && (packet.peer != id));
+    if (packet.checksum_tick != lockstep_no_tick) {
+      add_checksum(packet.peer, packet.checksum_tick, packet.checksum);
+    }
+    if (packet.tick == lockstep_no_tick) {
+      peer_left[packet.peer] = true;
+      return;
+    }
+    tick_commands& at = commands_at(packet.tick);
+    assert(!at.received[packet.peer]);
+    at.commands[packet.peer] = std::move(packet.commands);
+    at.received[packet.peer] = true;
+    at.received_count++;
+  }
+
+  void send(uint64_t tick, std::vector<unsigned char> commands) {
+    lockstep_packet packet{ id, tick, std::move(commands), last_checksum_tick, last_checksum };
+    network.broadcast(packet);
+    if (tick != lockstep_no_tick) {
+      tick_commands& at = commands_at(tick);
+      at.commands[id] = std::move(packet.commands);
+      at.received[id] = true;
+      at.received_count++;
+    }
+  }
+
+public:
+  /*
+  Joins the session as peer id, sending empty commands for the first input_delay ticks.
+  */
+  lockstep_peer(lockstep_network& net, uint32_t peer_id, uint32_t delay) :
+      network(net), id(peer_id), input_delay(delay), peer_left(net.peer_count()) {
+    assert((id < network.peer_count()) && (input_delay >= 1));
+    for (uint32_t tick = 0; tick < input_delay; tick++) {
+      send(tick, {});
+    }
+  }
+
+  // do not copy or assign
+  lockstep_peer(lockstep_peer&) = delete;
+  lockstep_peer& operator=(const lockstep_peer&) = delete;
+
+  uint64_t tick() const {
+    return current_tick;
+  }
+
+  /*
+  Sends this peer's commands for tick() + input_delay along with the checksum of the last tick,
+  then waits for every peer's commands for tick() and returns them in peer order.
+  */
+  std::vector<std::vector<unsigned char>> exchange(std::vector<unsigned char> commands) {
+    send(current_tick + input_delay, std::move(commands));
+    tick_commands* at = &commands_at(current_tick);
+    while (at->received_count < network.peer_count()) {
+      lockstep_packet packet = network.receive(id);
+      handle(packet);
+      at = &commands_at(current_tick);
+    }
+    std::vector<std::vector<unsigned char>> result = std::move(at->commands);
+    commands_by_tick.erase(current_tick);
+    return result;
+  }
+
+  /*
+  Records the checksum of this peer's state after stepping tick() and moves on to the next tick.
+  */
+  void finish_tick(uint64_t checksum) {
+    add_checksum(id, current_tick, checksum);
+    last_checksum_tick = current_tick;
+    last_checksum = checksum;
+    current_tick++;
+  }
+
+  /*
+  Sends the checksum of the last tick, every peer must leave after the same number of ticks.
+  */
+  void leave() {
+    send(lockstep_no_tick, {});
+  }
+
+  /*
+  Waits for every other peer to leave so the last tick's checksums are compared too.
+  Peers stepped in turn on one thread must all leave before any waits.
+  */
+  void wait_for_peers() {
+    for (uint32_t peer = 0; peer < network.peer_count(); peer++) {
+      while ((peer != id) && !peer_left[peer]) {
+        lockstep_packet packet = network.receive(id);
+        handle(packet);
+      }
+    }
+  }
+
+  bool desynced() const {
+    return (first_desync != lockstep_no_tick);
+  }
+
+  // The first tick after which two peers' checksums differed, or lockstep_no_tick.
+  uint64_t desync_tick() const {
+    return first_desync;
+  }
+};
@@ -6,6 +6,10 @@
 #include <cstdio>
 #include <memory>
 #include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "shader.h"
 #include "vertex_array.h"
@@ -16,8 +20,11 @@
 #include "sprite.h"
 #include "world.h"
 #include "resources.h"
+#include "input_recording.h"
+#include "lockstep.h"
 
 stage* global_stage = nullptr;
+input_recorder* global_recorder = nullptr; // set while recording with --record
 
 #ifdef _MSC_VER
 extern "C" {
@@ -35,24 +42,177 @@ void error_callback(int error, const char* description) {
 }
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+  if (global_recorder != nullptr) {
+    global_recorder->key(key, scancode, action, mods);
+  }
   if (global_stage != nullptr) {
     global_stage->key_callback(key, scancode, action, mods);
   }
 }
 
 static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+  if (global_recorder != nullptr) {
+    global_recorder->cursor(xpos, ypos);
+  }
   if (global_stage != nullptr) {
     global_stage->cursor_position_callback(xpos, ypos);
   }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+  if (global_recorder != nullptr) {
+    global_recorder->mouse_button(button, action, mods);
+  }
   if (global_stage != nullptr) {
     global_stage->mouse_button_callback(button, action, mods);
   }
 }
 
-int main(void) {
+/*
+Re-runs a recording with nothing drawn and no waiting on the display, as fast as the updates go.
+The window is hidden, it is only there for the GL context the world's objects live in.
+*/
+int run_replay(GLFWwindow* window, static_resources& sr, int_keyed_resources& dr, input_recording& recording, world_snapshot const* snapshot) {
+  std::array<unsigned int, 4> seed;
+  std::copy(recording.seed().begin(), recording.seed().end(), seed.begin());
+  world w(window, sr, dr, seed);
+  if ((snapshot != nullptr) && !w.load_snapshot(*snapshot)) {
+    return -1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t tick = 0; tick < recording.tick_count(); tick++) {
+    recording.deliver(tick, w);
+    w.update();
+  }
+  glFinish(); // count GL work queued by the updates
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("Replayed %llu ticks in %.3fs, %.1f ticks/s\n",
+    static_cast<unsigned long long>(recording.tick_count()), seconds, recording.tick_count() / seconds);
+  return 0;
+}
+
+/*
+Runs two worlds in lockstep for tick_count ticks, each peer ordering its own team's first legion around a circle,
+and reports the first tick on which their states differed. The worlds share the GL context so they are stepped in turn.
+*/
+int run_lockstep(GLFWwindow* window, static_resources& sr, int_keyed_resources& dr, uint64_t tick_count, world_snapshot const* snapshot) {
+  constexpr uint32_t peer_count = 2; // one per team
+  constexpr uint32_t input_delay = 2;
+  lockstep_network network{ peer_count };
+  std::vector<std::unique_ptr<world>> worlds;
+  std::vector<std::unique_ptr<lockstep_peer>> peers;
+  for (uint32_t p = 0; p < peer_count; p++) {
+    worlds.push_back(std::make_unique<world>(window, sr, dr));
+    worlds.back()->scripted_orders = false;
+    if ((snapshot != nullptr) && !worlds.back()->load_snapshot(*snapshot)) {
+      return -1;
+    }
+    peers.push_back(std::make_unique<lockstep_peer>(network, p, input_delay));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t tick = 0; tick < tick_count; tick++) {
+    for (uint32_t p = 0; p < peer_count; p++) {
+      float ang = tick / 100.0f + p * math_consts::pi();
+      legion_order_command command{ p, 0, vector_2f::create_polar(ang, 100.0f + 100.0f * p) };
+      std::vector<unsigned char> packet(sizeof(command));
+      std::memcpy(packet.data(), &command, sizeof(command));
+      for (std::vector<unsigned char> const& commands : peers[p]->exchange(std::move(packet))) {
+        if (!worlds[p]->apply_commands(commands)) {
+          fprintf(stderr, "Peer %u was sent malformed commands\n", p);
+          return -1;
+        }
+      }
+      worlds[p]->update();
+      peers[p]->finish_tick(worlds[p]->state_hash());
+    }
+  }
+  for (std::unique_ptr<lockstep_peer>& peer : peers) {
+    peer->leave();
+  }
+  for (std::unique_ptr<lockstep_peer>& peer : peers) {
+    peer->wait_for_peers();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (peers[0]->desynced()) {
+    printf("The worlds diverged on tick %llu\n", static_cast<unsigned long long>(peers[0]->desync_tick()));
+    return 1;
+  }
+  printf("Ran %u worlds in lockstep for %llu ticks in %.3fs\n", peer_count, static_cast<unsigned long long>(tick_count), seconds);
+  return 0;
+}
+
+/*
+Checks a snapshot just saved from saved_from loads into a new world in the same state,
+and that saving that world again writes the same bytes.
+*/
+bool check_snapshot_round_trip(GLFWwindow* window, static_resources& sr, int_keyed_resources& dr, world& saved_from, char const* filename) {
+  world_snapshot snapshot{ filename };
+  if (!snapshot.valid()) {
+    return false;
+  }
+  world loaded(window, sr, dr);
+  if (!loaded.load_snapshot(snapshot)) {
+    return false;
+  }
+  if (loaded.state_hash() != saved_from.state_hash()) {
+    fprintf(stderr, "%s does not load back into the state it was saved from\n", filename);
+    return false;
+  }
+
+  std::string resaved_filename = std::string(filename) + ".check";
+  bool same_bytes = false;
+  if (loaded.save_snapshot(resaved_filename.c_str())) {
+    mapped_file saved{ filename };
+    mapped_file resaved{ resaved_filename.c_str() };
+    same_bytes = saved.valid() && resaved.valid() && (saved.view() == resaved.view());
+  }
+  std::remove(resaved_filename.c_str());
+  if (!same_bytes) {
+    fprintf(stderr, "Saving %s again after loading it does not write the same snapshot\n", filename);
+  }
+  return same_bytes;
+}
+
+/*
+Usage: WarMorale [--record file | --replay file | --lockstep ticks] [--snapshot file] [--save-snapshot file]
+--record writes the session's seed and inputs to file on exit, --replay re-runs such a file headlessly.
+--lockstep runs two worlds headlessly in lockstep checking they stay identical.
+--snapshot starts the world from a snapshot, --save-snapshot writes one on exit and checks it loads back the same.
+A recording made from a snapshot must be replayed from the same snapshot.
+*/
+int main(int argc, char** argv) {
+  char const* record_filename = nullptr;
+  char const* replay_filename = nullptr;
+  char const* snapshot_filename = nullptr;
+  char const* save_snapshot_filename = nullptr;
+  uint64_t lockstep_ticks = 0;
+  bool usage_error = ((argc % 2) == 0); // every option takes a value
+  for (int i = 1; (i + 1 < argc) && !usage_error; i += 2) {
+    if (std::strcmp(argv[i], "--record") == 0) {
+      record_filename = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--replay") == 0) {
+      replay_filename = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--snapshot") == 0) {
+      snapshot_filename = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--save-snapshot") == 0) {
+      save_snapshot_filename = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--lockstep") == 0) {
+      lockstep_ticks = std::strtoull(argv[i + 1], nullptr, 10);
+      usage_error = (lockstep_ticks == 0);
+    } else {
+      usage_error = true;
+    }
+  }
+  int mode_count = ((record_filename != nullptr) ? 1 : 0) + ((replay_filename != nullptr) ? 1 : 0) + ((lockstep_ticks != 0) ? 1 : 0);
+  if (usage_error || (mode_count > 1)) {
+    fprintf(stderr, "Usage: %s [--record file | --replay file | --lockstep ticks] [--snapshot file] [--save-snapshot file]\n", argv[0]);
+    return -1;
+  }
+
   /* Initialize the library */
   glfwSetErrorCallback(error_callback);
   if (!glfwInit()) {
@@ -66,6 +226,9 @@ int main(void) {
   int window_height = 720;
   char const* window_title = "War Morale";
   GLFWwindow* window;
+  if ((replay_filename != nullptr) || (lockstep_ticks != 0)) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
   if (windowed) {
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
     window = glfwCreateWindow(window_width, window_height, window_title, NULL, NULL);
@@ -101,16 +264,55 @@ int main(void) {
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  static_resources sr;
+  std::unique_ptr<worker_pool> loading_pool = std::make_unique<worker_pool>();
+  static_resources sr{ loading_pool.get() };
+  loading_pool.reset(); // the threads are only needed while loading
   int_keyed_resources dr;
+
+  std::unique_ptr<world_snapshot> snapshot;
+  if (snapshot_filename != nullptr) {
+    snapshot = std::make_unique<world_snapshot>(snapshot_filename);
+    if (!snapshot->valid()) {
+      glfwTerminate();
+      return -1;
+    }
+  }
+
+  if (replay_filename != nullptr) {
+    input_recording recording{ replay_filename };
+    int result = recording.valid() ? run_replay(window, sr, dr, recording, snapshot.get()) : -1;
+    glfwTerminate();
+    return result;
+  }
+
+  if (lockstep_ticks != 0) {
+    int result = run_lockstep(window, sr, dr, lockstep_ticks, snapshot.get());
+    glfwTerminate();
+    return result;
+  }
+
   world w(window, sr, dr);
+  if (snapshot && !w.load_snapshot(*snapshot)) {
+    glfwTerminate();
+    return -1;
+  }
+  snapshot.reset(); // the world holds nothing from the mapping
   global_stage = &w;
 
+  std::unique_ptr<input_recorder> recorder;
+  if (record_filename != nullptr) {
+    recorder = std::make_unique<input_recorder>(std::array<uint32_t, 4>{ w.seed[0], w.seed[1], w.seed[2], w.seed[3] });
+    global_recorder = recorder.get();
+  }
 
-
+  uint64_t tick = 0;
   while (!glfwWindowShouldClose(window)){
+    if (recorder) {
+      recorder->set_tick(tick);
+    }
     glfwPollEvents();
     global_stage->update();
+    tick++;
    
     glClear(GL_COLOR_BUFFER_BIT);
     global_stage->render();
@@ -118,8 +320,23 @@ int main(void) {
     //check_gl_errors();
   }
 
+  global_stage = nullptr;
+  global_recorder = nullptr;
+  if (recorder) {
+    if (recorder->write(record_filename, tick)) {
+      printf("Recorded %llu ticks to %s, %zu bytes\n", static_cast<unsigned long long>(tick), record_filename, recorder->size_bytes());
+    }
+  }
+  int result = 0;
+  if ((save_snapshot_filename != nullptr) && w.save_snapshot(save_snapshot_filename)) {
+    printf("Saved snapshot of tick %ld to %s\n", w.frame_count, save_snapshot_filename);
+    if (!check_snapshot_round_trip(window, sr, dr, w, save_snapshot_filename)) {
+      result = -1;
+    }
+  }
+
   glfwTerminate();
 
   //getchar();
-  return 0;
+  return result;
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// mapped_file maps a whole file read only into memory.
+// The operating system pages the file in as it is read so nothing is copied,
+// and the mapping is released when the mapped_file is destroyed.
+// A file which could not be opened or mapped gives an invalid mapped_file whose error_message() says why,
+// an empty file is valid with a size of 0 as there is nothing to map.
+class mapped_file {
+private:
+  unsigned char const* data_ = nullptr;
+  size_t size_ = 0;
+  bool valid_ = false;
+  char const* error_ = "not opened"; // what failed, null when valid
+  int system_error_ = 0; // errno, or GetLastError on windows
+
+  void unmap() {
+    if ((data_ != nullptr) && (size_ > 0)) {
+#ifdef _WIN32
+      UnmapViewOfFile(data_);
+#else
+      munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    valid_ = false;
+    error_ = "not opened";
+    system_error_ = 0;
+  }
+
+  void fail(char const* error) {
+    error_ = error;
+#ifdef _WIN32
+    system_error_ = static_cast<int>(GetLastError());
+#else
+    system_error_ = errno;
+#endif
+  }
+
+  void succeed(unsigned char const* data, size_t size) {
+    static unsigned char const empty = 0;
+    data_ = (size > 0) ? data : &empty;
+    size_ = size;
+    valid_ = true;
+    error_ = nullptr;
+    system_error_ = 0;
+  }
+
+  void take(mapped_file& old) {
+    data_ = old.data_;
+    size_ = old.size_;
+    valid_ = old.valid_;
+    error_ = old.error_;
+    system_error_ = old.system_error_;
+    old.data_ = nullptr;
+    old.size_ = 0;
+    old.valid_ = false;
+    old.error_ = "moved from";
+    old.system_error_ = 0;
+  }
+
+public:
+  mapped_file() {}
+
+  explicit mapped_file(char const* filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      fail("could not open");
+      return;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+      fail("could not read the size of");
+    } else if (file_size.QuadPart == 0) {
+      succeed(nullptr, 0);
+    } else {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping == nullptr) {
+        fail("could not map");
+      } else {
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+          fail("could not map");
+        } else {
+          succeed(static_cast<unsigned char const*>(view), static_cast<size_t>(file_size.QuadPart));
+        }
+        CloseHandle(mapping); // the view keeps the mapping alive
+      }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      fail("could not open");
+      return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      fail("could not read the size of");
+    } else if (file_stat.st_size == 0) {
+      succeed(nullptr, 0);
+    } else {
+      void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (view == MAP_FAILED) {
+        fail("could not map");
+      } else {
+        succeed(static_cast<unsigned char const*>(view), static_cast<size_t>(file_stat.st_size));
+      }
+    }
+    close(fd); // the mapping keeps the file alive
+#endif
+  }
+
+  // do not copy or assign
+  mapped_file(mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  //moving is ok
+  mapped_file(mapped_file&& old) {
+    take(old);
+  }
+
+  mapped_file& operator= (mapped_file&& old) {
+    if (this != (&old)) {
+      unmap();
+      take(old);
+    }
+    return *this;
+  }
+
+  ~mapped_file() {
+    unmap();
+  }
+
+  bool valid() const {
+    return valid_;
+  }
+
+  /*
+  Says why the file is not valid, such as "could not open (No such file or directory)", or is empty when it is valid.
+  */
+  std::string error_message() const {
+    if (valid_) {
+      return {};
+    }
+    std::string message = error_;
+    if (system_error_ != 0) {
+#ifdef _WIN32
+      message += " (error " + std::to_string(system_error_) + ")";
+#else
+      message += " (";
+      message += std::strerror(system_error_);
+      message += ")";
+#endif
+    }
+    return message;
+  }
+
+  /*
+  Prints why filename could not be mapped to stderr, returning valid().
+  */
+  bool report(char const* filename) const {
+    if (!valid_) {
+      fprintf(stderr, "Could not read file %s: %s\n", filename, error_message().c_str());
+    }
+    return valid_;
+  }
+
+  unsigned char const* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  std::string_view view() const {
+    return { reinterpret_cast<char const*>(data_), size_ };
+  }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "2d_math.h"
+#include "geom.h"
+#include <algorithm>
+#include <cstdint>
+
+// Morton (Z-order) codes interleave the bits of two coordinates so that points which are close in space
+// tend to have close codes. Sorting by Morton code gives a cheap locality preserving order.
+namespace morton {
+  // Spreads the lower 16 bits of v out to the even bits of the result.
+  inline uint32_t spread_bits(uint32_t v) {
+    // Bit Twiddling Hacks
+    // Interleave bits by Binary Magic Numbers
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+
+  inline uint32_t encode(uint32_t x, uint32_t y) {
+    return spread_bits(x) | (spread_bits(y) << 1);
+  }
+
+  // Quantizes a position within the bounds to 16 bits per axis and encodes it.
+  // Positions outside of the bounds are clamped to the edge.
+  inline uint32_t encode(vector_2f const& pos, bounds const& b) {
+    vector_2f extent = b.max_bound - b.min_bound;
+    vector_2f scale{
+      extent.x > 0 ? 65535.0f / extent.x : 0.0f,
+      extent.y > 0 ? 65535.0f / extent.y : 0.0f };
+    vector_2f cell = (b.clamp(pos) - b.min_bound) * scale;
+    return encode(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y));
+  }
+};
@@ -11,6 +11,12 @@
 
 class obstacle_parent;
 
+// The concrete type of an obstacle, so an obstacle can be saved without RTTI.
+enum class obstacle_shape {
+  circular,
+  polygonal
+};
+
 class obstacle : public renderable {
   friend obstacle_parent;
 private:
@@ -26,10 +32,12 @@ public:
   virtual bool is_segment_occupied(precalc_segment segment, float other_radius) = 0;
   virtual bool is_point_occupied(vector_2f location, float other_radius) = 0;
   virtual vector_2f get_exerted_gradient(vector_2f location, float other_radius) = 0;
+  virtual obstacle_shape shape() const = 0;
   virtual ~obstacle() {} // base class
 };
 
-class circular_obstacle : public obstacle {
+class circular_obstacle final : public obstacle {
+  friend class world; // saves circular_obstacles in snapshots
 private:
   float radius;
   sprite image;
@@ -51,6 +59,10 @@ public:
     return (point_to_segment_distance(trans.get_position(), segment) < (radius + other_radius));
   }
 
+  obstacle_shape shape() const override {
+    return obstacle_shape::circular;
+  }
+
   vector_2f get_exerted_gradient(vector_2f location, float other_radius) override {
     vector_2f gauss_force;
     /*if (radius >= 40.0f) {
@@ -76,7 +88,8 @@ public:
   }
 };
 
-class polygonal_obstacle : public obstacle {
+class polygonal_obstacle final : public obstacle {
+  friend class world; // saves polygonal_obstacles in snapshots
 private:
   precalc_polygon precalc;
   sprite image;
@@ -109,6 +122,10 @@ public:
     return precalc.is_segment_occupied(segment - trans.get_position(), other_radius);
   }
 
+  obstacle_shape shape() const override {
+    return obstacle_shape::polygonal;
+  }
+
   void render(matrix_3f const& parent_trans) override {
     //variadic_local_render(parent_trans, *this, poly, image);
     //variadic_local_render(parent_trans, *this, poly);
@@ -126,6 +143,28 @@ public:
 
   obstacle_parent(bounds b) : buckets(std::move(b)) {}
 
+  /*
+  Takes ownership of the raw pointer child and puts it in the buckets where it is now,
+  rather than on the next update, so it blocks things straight away.
+  */
+  template<typename child_sub_type>
+  child_sub_type* add_placed_orphan(child_sub_type* child) {
+    add_orphan(child);
+    child->old_trans = child->trans;
+    child->local_trans = child->trans.to_matrix();
+    buckets.add_entry(child->trans.get_position(), child);
+    return child;
+  }
+
+  /*
+  Removes every obstacle along with its bucket entry.
+  O(n)
+  */
+  void remove_all_obstacles() {
+    buckets.clear();
+    remove_all_children();
+  }
+
   bool update() {
     bool result = parent_type::update();
     for (int n = 0; n < child_count(); n++) {
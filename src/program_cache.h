@@ -0,0 +1,146 @@
+#pragma once
+#include "gl_includes.h"
+#include "shader.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+struct shader_source {
+  GLenum type;
+  std::string_view source;
+};
+
+// program_cache keeps the driver's binaries of linked programs on disk so later launches
+// can load them with glProgramBinary instead of compiling GLSL.
+// Each program is stored in its own file named by a hash of its shader types and sources
+// and of the GL vendor, renderer and version, so editing a shader or updating the driver
+// just misses the cache. A missing, corrupt or rejected binary falls back to compiling from source
+// and the cache file is rewritten.
+class program_cache {
+private:
+  struct cache_header {
+    char magic[4]; // "WMPB"
+    uint32_t binary_format;
+    uint64_t key; // repeated so a renamed or copied file is not loaded as the wrong program
+    uint64_t size;
+  };
+
+  std::filesystem::path directory;
+  fnv1a_hasher driver_hash;
+
+  static void add_gl_string(fnv1a_hasher& hasher, GLenum name) {
+    char const* value = reinterpret_cast<char const*>(glGetString(name));
+    hasher.add((value != nullptr) ? value : "");
+    hasher.add_value('\n');
+  }
+
+  uint64_t key_of(std::initializer_list<shader_source> sources) const {
+    fnv1a_hasher hasher = driver_hash;
+    for (shader_source const& source : sources) {
+      hasher.add_value(uint32_t{ source.type });
+      hasher.add(source.source);
+      hasher.add_value('\0'); // keeps "ab" + "c" apart from "a" + "bc"
+    }
+    return hasher.value();
+  }
+
+  std::filesystem::path path_of(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory / name;
+  }
+
+  static std::optional<program> load(std::filesystem::path const& path, uint64_t key) {
+    mapped_file file{ path.string().c_str() };
+    if (file.size() < sizeof(cache_header)) {
+      return std::nullopt;
+    }
+    cache_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if ((std::memcmp(header.magic, "WMPB", 4) != 0) || (header.key != key) ||
+        (header.size != file.size() - sizeof(cache_header))) {
+      return std::nullopt;
+    }
+    program loaded = program::from_binary(header.binary_format, file.data() + sizeof(cache_header), static_cast<GLsizei>(header.size));
+    if (!loaded.valid()) {
+      return std::nullopt;
+    }
+    return loaded;
+  }
+
+  void save(std::filesystem::path const& path, uint64_t key, program const& prog) const {
+    GLenum binary_format = 0;
+    std::vector<unsigned char> binary = prog.get_binary(binary_format);
+    if (binary.empty()) {
+      return; // the driver does not support program binaries, every launch compiles
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    FILE* out = fopen(path.string().c_str(), "wb");
+    if (out == nullptr) {
+      fprintf(stderr, "Could not write program cache %s\n", path.string().c_str());
+      return;
+    }
+    cache_header header{};
+    std::memcpy(header.magic, "WMPB", 4);
+    header.binary_format = binary_format;
+    header.key = key;
+    header.size = binary.size();
+    bool ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    ok = ok && (fwrite(binary.data(), 1, binary.size(), out) == binary.size());
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      fprintf(stderr, "Could not write program cache %s\n", path.string().c_str());
+      std::filesystem::remove(path, error); // a partial file would only miss next time, but do not leave it around
+    }
+  }
+
+public:
+  /*
+  Uses directory for the cache files, creating it when the first binary is saved.
+  Must be made on the thread owning the GL context as it reads the driver strings.
+  */
+  explicit program_cache(std::filesystem::path cache_directory) : directory(std::move(cache_directory)) {
+    add_gl_string(driver_hash, GL_VENDOR);
+    add_gl_string(driver_hash, GL_RENDERER);
+    add_gl_string(driver_hash, GL_VERSION);
+  }
+
+  // do not copy or assign
+  program_cache(program_cache&) = delete;
+  program_cache& operator=(const program_cache&) = delete;
+
+  /*
+  Returns the program linked from the sources, loading the cached binary when there is a usable one
+  and otherwise compiling, linking and caching it.
+  O(source length) for the hash, plus the compile on a miss.
+  */
+  program load_or_compile(std::initializer_list<shader_source> sources) const {
+    uint64_t key = key_of(sources);
+    std::filesystem::path path = path_of(key);
+    std::optional<program> cached = load(path, key);
+    if (cached) {
+      return std::move(*cached);
+    }
+
+    std::vector<shader> shaders;
+    shaders.reserve(sources.size());
+    for (shader_source const& source : sources) {
+      shaders.emplace_back(static_cast<int>(source.type), source.source);
+    }
+    program compiled = program::link(shaders);
+    save(path, key, compiled);
+    return compiled;
+  }
+};
@@ -1,9 +1,13 @@
 #pragma once
 #include "2d_math.h"
 #include "sparse_container.h"
+#include "chunked_sparse_container.h"
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <utility>
+#include <cassert>
+#include <type_traits>
 
 class renderable {
 public:
@@ -30,6 +34,7 @@ template<typename child_type, bool ordered>
 class renderable_parent : public renderable {
 private:
   std::vector<std::unique_ptr<child_type>> children;
+  int marked_count = 0; // children destroyed by mark_child_for_removal whose slots are still in children
 
 public:
 
@@ -72,6 +77,31 @@ public:
     }
   }
 
+  /*
+  Destroys the child at the given index but leaves its slot empty until remove_marked_children,
+  so the indices of the other children do not change in the meantime.
+  child_at must not be called with a marked index.
+  O(1)
+  */
+  void mark_child_for_removal(int idx) {
+    assert(children[idx] != nullptr);
+    children[idx].reset();
+    marked_count++;
+  }
+
+  /*
+  Removes the slots of all marked children in one pass keeping the order of the rest.
+  Marking k children then compacting is O(n) where k calls to remove_child_at would be O(n * k).
+  O(n)
+  */
+  void remove_marked_children() {
+    if (marked_count == 0) {
+      return;
+    }
+    children.erase(std::remove(children.begin(), children.end(), nullptr), children.end());
+    marked_count = 0;
+  }
+
   /*
   Finds the index of the child.
   Returns -1 if the child is not one of the renderable_parent's children.
@@ -105,6 +135,33 @@ public:
     return static_cast<int>(children.size());
   }
 
+  /*
+  Sorts the children by key(child), keeping the order of children with equal keys.
+  Each child is replaced by relocate(child) which must return a newly allocated copy of it.
+  The copies are allocated in the sorted order before any old child is freed
+  so children next to each other in the order tend to be next to each other in memory.
+  O(n log n)
+  */
+  template<typename key_func_type, typename relocate_func_type>
+  void reorder_children(key_func_type key, relocate_func_type relocate) {
+    using key_type = decltype(key(std::declval<child_type&>()));
+    std::vector<std::pair<key_type, int>> order;
+    order.reserve(children.size());
+    for (int i = 0; i < child_count(); i++) {
+      order.push_back({ key(child_at(i)), i });
+    }
+    std::stable_sort(order.begin(), order.end(), [](std::pair<key_type, int> const& left, std::pair<key_type, int> const& right) {
+      return (left.first < right.first);
+    });
+
+    std::vector<std::unique_ptr<child_type>> relocated;
+    relocated.reserve(children.size());
+    for (auto const& entry : order) {
+      relocated.emplace_back(relocate(child_at(entry.second)));
+    }
+    children = std::move(relocated);
+  }
+
   renderable_parent() {};
   virtual ~renderable_parent() {} // this is a base class
   renderable_parent(renderable_parent&) = delete; // do not copy
@@ -122,17 +179,197 @@ public:
   virtual bool update() {
     for (int i = child_count() - 1; i >= 0; i--) {
       if (child_at(i).update()) {
-        remove_child_at(i);
+        mark_child_for_removal(i);
       }
     }
+    remove_marked_children();
     return false;
   }
 };
 
-template<typename T, size_t N>
-class sparse_parent : public renderable {
+/*
+partitioned_parent keeps its children grouped by concrete type, one partition per type.
+Updating and rendering loop over one partition at a time with the concrete type known,
+so the children's update and render calls are direct and can be inlined,
+only moving to the next partition costs a virtual call.
+Children are ordered by type, in the order each type was first added, then by when they were added.
+*/
+template<typename base_type>
+class partitioned_parent : public renderable {
+private:
+  class partition {
+  public:
+    void const* const type_key;
+    std::vector<std::unique_ptr<base_type>> children; // all of the partition's type
+
+    partition(void const* key) : type_key(key) {}
+    virtual void update_children() = 0;
+    virtual void render_children(matrix_3f const& trans) = 0;
+    virtual void reorder_children(std::vector<int> const& order) = 0;
+    virtual ~partition() {} // this is a base class
+  };
+
+  template<typename T>
+  class typed_partition final : public partition {
+  public:
+    typed_partition() : partition(type_key_of<T>()) {}
+
+    T& typed_child_at(size_t idx) {
+      return static_cast<T&>(*(this->children[idx]));
+    }
+
+    // Children are destroyed as they finish and their slots compacted in one pass at the end.
+    void update_children() override {
+      bool any_finished = false;
+      for (size_t i = this->children.size(); i-- > 0;) {
+        if (typed_child_at(i).update()) {
+          this->children[i].reset();
+          any_finished = true;
+        }
+      }
+      if (any_finished) {
+        this->children.erase(std::remove(this->children.begin(), this->children.end(), nullptr), this->children.end());
+      }
+    }
+
+    void render_children(matrix_3f const& trans) override {
+      for (size_t i = 0; i < this->children.size(); i++) {
+        typed_child_at(i).render(trans);
+      }
+    }
+
+    void reorder_children(std::vector<int> const& order) override {
+      std::vector<std::unique_ptr<base_type>> relocated;
+      relocated.reserve(this->children.size());
+      for (int idx : order) {
+        relocated.emplace_back(new T(std::move(typed_child_at(idx))));
+      }
+      this->children = std::move(relocated);
+    }
+  };
+
+  std::vector<std::unique_ptr<partition>> partitions;
+
+  // An address unique to T, used to find T's partition without RTTI.
+  template<typename T>
+  static void const* type_key_of() {
+    static char const key = 0;
+    return &key;
+  }
+
+  template<typename T>
+  typed_partition<T>& partition_of() {
+    void const* key = type_key_of<T>();
+    for (std::unique_ptr<partition>& p : partitions) {
+      if (p->type_key == key) {
+        return static_cast<typed_partition<T>&>(*p);
+      }
+    }
+    partitions.emplace_back(new typed_partition<T>());
+    return static_cast<typed_partition<T>&>(*(partitions.back()));
+  }
+
+public:
+  partitioned_parent() {};
+  virtual ~partitioned_parent() {} // this is a base class
+  partitioned_parent(partitioned_parent&) = delete; // do not copy
+
+  /*
+  Takes ownership of the raw pointer child adding it to the partition of child_sub_type.
+  child_sub_type must be final, the partition treats every child in it as exactly that type.
+  O(types)
+  */
+  template<typename child_sub_type>
+  child_sub_type* add_orphan(child_sub_type* child) {
+    static_assert(std::is_final_v<child_sub_type>, "children are partitioned by their exact type");
+    partition_of<child_sub_type>().children.emplace_back(child);
+    return child;
+  }
+
+  /*
+  Calls func(child) with every child as a base_type&.
+  O(n)
+  */
+  template<typename F>
+  void for_each_child(F func) {
+    for (std::unique_ptr<partition>& p : partitions) {
+      for (std::unique_ptr<base_type>& child : p->children) {
+        if (child) { // children finishing mid update leave an empty slot until their partition compacts
+          func(*child);
+        }
+      }
+    }
+  }
+
+  int child_count() {
+    size_t count = 0;
+    for (std::unique_ptr<partition>& p : partitions) {
+      count += p->children.size();
+    }
+    return static_cast<int>(count);
+  }
+
+  /*
+  Removes all children.
+  O(n)
+  */
+  void remove_all_children() {
+    for (std::unique_ptr<partition>& p : partitions) {
+      p->children.clear();
+    }
+  }
+
+  /*
+  Sorts the children of each partition by key(child), keeping the order of children with equal keys.
+  Each child is moved into a new allocation in the sorted order, see renderable_parent::reorder_children.
+  O(n log n)
+  */
+  template<typename key_func_type>
+  void reorder_children(key_func_type key) {
+    using key_type = decltype(key(std::declval<base_type&>()));
+    std::vector<std::pair<key_type, int>> keyed;
+    std::vector<int> order;
+    for (std::unique_ptr<partition>& p : partitions) {
+      keyed.clear();
+      for (size_t i = 0; i < p->children.size(); i++) {
+        keyed.push_back({ key(*(p->children[i])), static_cast<int>(i) });
+      }
+      std::stable_sort(keyed.begin(), keyed.end(), [](std::pair<key_type, int> const& left, std::pair<key_type, int> const& right) {
+        return (left.first < right.first);
+      });
+      order.clear();
+      for (auto const& entry : keyed) {
+        order.push_back(entry.second);
+      }
+      p->reorder_children(order);
+    }
+  }
+
+  virtual void render(matrix_3f const& parent_trans) {
+    if (!visible) {
+      return;
+    }
+    matrix_3f trans = parent_trans * local_trans;
+    for (std::unique_ptr<partition>& p : partitions) {
+      p->render_children(trans);
+    }
+  }
+
+  virtual bool update() {
+    for (size_t i = partitions.size(); i-- > 0;) {
+      partitions[i]->update_children();
+    }
+    return false;
+  }
+};
+
+// A parent holding its children by value in a sparse_container or chunked_sparse_container.
+template<typename container_type>
+class basic_sparse_parent : public renderable {
 private:
-  sparse_container<T, N> children;
+  using T = typename container_type::value_type;
+
+  container_type children;
 public:
 
   T& push(T const& value) {
@@ -145,7 +382,7 @@ public:
 
   template<typename... Args>
   T& emplace(Args&&... args) {
-    return children.emplace(args);
+    return children.emplace(std::forward<Args>(args)...);
   }
 
   int child_count() {
@@ -157,21 +394,27 @@ public:
       return;
     }
     matrix_3f trans = parent_trans * local_trans;
-    for (T& child: children) {
+    children.for_each_occupied([&trans](T& child) {
       child.render(trans);
-    }
+    });
   }
 
   virtual bool update() {
-    for (auto it = children.begin(); it != children.end(); ++it) {
-      if (it->update()) {
-        children.erase(it);
-      }
-    }
+    children.erase_if([](T& child) {
+      return child.update();
+    });
     return false;
   }
 };
 
+// Fixed capacity, pushing past N asserts.
+template<typename T, size_t N>
+using sparse_parent = basic_sparse_parent<sparse_container<T, N>>;
+
+// Grows B children at a time, empty until the first push.
+template<typename T, size_t B>
+using chunked_sparse_parent = basic_sparse_parent<chunked_sparse_container<T, B>>;
+
 using ordered_parent = renderable_parent<renderable, true>;
 using unordered_parent = renderable_parent<renderable, false>;
 
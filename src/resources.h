@@ -1,16 +1,21 @@
 #pragma once
 #include "utils.h"
 #include "texture.h"
+#include "texture_atlas.h"
 #include "shader.h"
+#include "program_cache.h"
 #include "vertex_array.h"
 #include "text/bitmap_font.h"
 #include "sized_vector.h"
+#include "asset_pack.h"
+#include "worker_pool.h"
 
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <memory>
 #include <cassert>
+#include <array>
 
 enum class static_texture_id {
   face,
@@ -51,49 +56,258 @@ enum class static_prop_font_id {
 };
 
 
+/*
+The CPU side of a set of assets, decoded images, shader sources and font metrics.
+Assets are added by name then decode reads them all, in parallel when given a worker_pool,
+taking each from the pack when it is there and from the loose file in ./assets otherwise.
+Decoding does not touch GL, only create_texture does so it must be called on the thread owning the GL context.
+*/
+class asset_batch {
+private:
+  struct stbi_deleter {
+    void operator()(unsigned char* pixels) const {
+      stbi_image_free(pixels);
+    }
+  };
+
+  struct image {
+    char const* name;
+    int width = 0;
+    int height = 0;
+    unsigned char const* rgba = nullptr; // into the pack or owned
+    std::unique_ptr<unsigned char, stbi_deleter> owned;
+
+    explicit image(char const* n) : name(n) {}
+  };
+
+  struct text_asset {
+    char const* name;
+    std::string_view text; // into the pack or the mapped loose file
+    mapped_file owned;
+
+    explicit text_asset(char const* n) : name(n) {}
+  };
+
+  struct font_metrics_asset {
+    char const* name;
+    prop_font_metrics metrics;
+
+    explicit font_metrics_asset(char const* n) : name(n) {}
+  };
+
+  asset_pack const& pack;
+  std::vector<image> images;
+  std::vector<text_asset> texts;
+  std::vector<font_metrics_asset> font_metrics;
+
+  static std::string asset_path(char const* name) {
+    return std::string("./assets/") + name;
+  }
+
+  void decode_image(image& img) {
+    asset_pack_entry const* entry = pack.find_texture(img.name);
+    if (entry != nullptr) {
+      img.width = static_cast<int>(entry->width);
+      img.height = static_cast<int>(entry->height);
+      img.rgba = pack.entry_data(*entry);
+      return;
+    }
+    std::string path = asset_path(img.name);
+    int channel_count;
+    img.owned.reset(stbi_load(path.c_str(), &img.width, &img.height, &channel_count, 4));
+    if (!img.owned) {
+      fprintf(stderr, "Could not read file %s\n", path.c_str());
+      exit(-1);
+    }
+    img.rgba = img.owned.get();
+  }
+
+  void decode_text(text_asset& txt) {
+    asset_pack_entry const* entry = pack.find(txt.name);
+    if ((entry != nullptr) && (entry->kind == asset_pack_kind::text)) {
+      txt.text = { reinterpret_cast<char const*>(pack.entry_data(*entry)), static_cast<size_t>(entry->size) };
+      return;
+    }
+    std::string path = asset_path(txt.name);
+    txt.owned = mapped_file{ path.c_str() };
+    if (!txt.owned.report(path.c_str())) {
+      exit(-1);
+    }
+    txt.text = txt.owned.view();
+  }
+
+  void decode_font_metrics(font_metrics_asset& font) {
+    prop_font_metrics const* packed = pack.find_prop_font_metrics(font.name);
+    if (packed != nullptr) {
+      font.metrics = *packed;
+    } else {
+      std::string path = asset_path(font.name);
+      mapped_file file{ path.c_str() };
+      if (!file.report(path.c_str())) {
+        exit(-1);
+      }
+      columnar_csv info{ std::move(file), false };
+      if (!info.valid()) {
+        fprintf(stderr, "Could not parse %s\n", path.c_str());
+        exit(-1);
+      }
+      font.metrics = prop_font_metrics::from_csv(info);
+    }
+  }
+
+public:
+  explicit asset_batch(asset_pack const& p) : pack(p) {}
+
+  // do not copy or assign
+  asset_batch(asset_batch&) = delete;
+  asset_batch& operator=(const asset_batch&) = delete;
+
+  // Each add returns the index to read the asset back with after decode.
+
+  size_t add_image(char const* name) {
+    images.emplace_back(name);
+    return images.size() - 1;
+  }
+
+  size_t add_text(char const* name) {
+    texts.emplace_back(name);
+    return texts.size() - 1;
+  }
+
+  size_t add_prop_font_metrics(char const* name) {
+    font_metrics.emplace_back(name);
+    return font_metrics.size() - 1;
+  }
+
+  /*
+  Decodes every added asset, on pool if it is not null.
+  Assets are handed out one at a time so one large image does not hold up a whole share of the work.
+  */
+  void decode(worker_pool* pool) {
+    size_t count = images.size() + texts.size() + font_metrics.size();
+    auto decode_one = [this](size_t idx) {
+      if (idx < images.size()) {
+        decode_image(images[idx]);
+      } else if (idx < images.size() + texts.size()) {
+        decode_text(texts[idx - images.size()]);
+      } else {
+        decode_font_metrics(font_metrics[idx - images.size() - texts.size()]);
+      }
+    };
+    if (pool == nullptr) {
+      for (size_t i = 0; i < count; i++) {
+        decode_one(i);
+      }
+    } else {
+      pool->parallel_for_each(count, decode_one);
+    }
+  }
+
+  // Uploads a decoded image, GL thread only.
+  texture create_texture(size_t idx) const {
+    image const& img = images[idx];
+    assert(img.rgba != nullptr);
+    return texture(img.width, img.height, img.rgba);
+  }
+
+  // A decoded image to pack into a texture_atlas, valid while the batch lives.
+  texture_atlas::source atlas_source(size_t idx) const {
+    image const& img = images[idx];
+    assert(img.rgba != nullptr);
+    return { img.width, img.height, img.rgba };
+  }
+
+  std::string_view text(size_t idx) const {
+    assert(texts[idx].text.data() != nullptr);
+    return texts[idx].text;
+  }
+
+  prop_font_metrics const& prop_font_metrics_at(size_t idx) const {
+    return font_metrics[idx].metrics;
+  }
+};
+
 class static_resources {
 private:
-  sized_vector<texture, static_cast<size_t>(static_texture_id::COUNT)> textures;
+  std::unique_ptr<texture_atlas> atlas; // every static texture then every font page
   sized_vector<program, static_cast<size_t>(static_program_id::COUNT)> programs;
   sized_vector<simple_vertex_array, static_cast<size_t>(static_vertex_array_id::COUNT)> vertex_arrays;
   sized_vector<mono_bitmap_font, static_cast<size_t>(static_mono_font_id::COUNT)> mono_fonts;
   sized_vector<prop_bitmap_font, static_cast<size_t>(static_prop_font_id::COUNT)> prop_fonts;
 
 public:
-  static_resources() {
-    textures.emplace_back("./assets/textures/sad.png");
-    textures.emplace_back("./assets/textures/fire.png");
-    textures.emplace_back("./assets/textures/grunt.png");
-    textures.emplace_back("./assets/textures/heavy.png");
-    textures.emplace_back("./assets/textures/ceres.png");
-    textures.emplace_back("./assets/textures/mercury_square.png");
-    textures.emplace_back("./assets/textures/shot.png");
-
+  /*
+  Loads every static resource from ./assets/assets.pack, built by PackBuilder, falling back to the loose files in ./assets.
+  The pack has to be rebuilt after changing a loose file for the change to show up.
+  Images, text and font metrics are decoded on pool when one is given, the GL objects are then made on the calling thread,
+  which must own the GL context. Programs come from the binaries in ./cache/programs when the driver accepts them.
+  Every static texture and font page is packed into one atlas so sprites and text can share a texture bind.
+  */
+  explicit static_resources(worker_pool* pool = nullptr) {
+    asset_pack pack{ "./assets/assets.pack" };
+    asset_batch batch{ pack };
+
+    std::array<size_t, static_cast<size_t>(static_texture_id::COUNT)> texture_images = {
+      batch.add_image("textures/sad.png"),
+      batch.add_image("textures/fire.png"),
+      batch.add_image("textures/grunt.png"),
+      batch.add_image("textures/heavy.png"),
+      batch.add_image("textures/ceres.png"),
+      batch.add_image("textures/mercury_square.png"),
+      batch.add_image("textures/shot.png")
+    };
+    size_t sprite_vert = batch.add_text("shaders/sprite.vert");
+    size_t sprite_frag = batch.add_text("shaders/sprite.frag");
+    size_t bitmap_text_frag = batch.add_text("shaders/bitmap_text.frag");
+    size_t polygon_vert = batch.add_text("shaders/polygon.vert");
+    size_t solid_frag = batch.add_text("shaders/solid.frag");
+    size_t line_vert = batch.add_text("shaders/line.vert");
+    size_t line_geom = batch.add_text("shaders/line.geom");
+    size_t pt_particle_vert = batch.add_text("shaders/pt_particle.vert");
+    size_t vertex_interp_frag = batch.add_text("shaders/vertex_interp.frag");
+    size_t pt_particle_comp = batch.add_text("shaders/pt_particle.comp");
+    size_t consolas_12_image = batch.add_image("fonts/consolas_12.png");
+    size_t impact_24_image = batch.add_image("fonts/impact_24.png");
+    size_t impact_24_metrics = batch.add_prop_font_metrics("fonts/impact_24.csv");
+
+    batch.decode(pool);
+
+    // GL uploads, only on this thread
+
+    size_t const consolas_12_region = texture_images.size();
+    size_t const impact_24_region = texture_images.size() + 1;
     {
-      shader vertex{ GL_VERTEX_SHADER, read_file_to_string("./assets/shaders/sprite.vert").c_str() };
-      shader sprite_frag{ GL_FRAGMENT_SHADER, read_file_to_string("./assets/shaders/sprite.frag").c_str() };
-      programs.emplace_back(vertex, sprite_frag);
-
-      shader text_frag{ GL_FRAGMENT_SHADER, read_file_to_string("./assets/shaders/bitmap_text.frag").c_str() };
-      programs.emplace_back(vertex, text_frag);
+      std::vector<texture_atlas::source> sources;
+      for (size_t image_idx : texture_images) {
+        sources.push_back(batch.atlas_source(image_idx));
+      }
+      sources.push_back(batch.atlas_source(consolas_12_image));
+      sources.push_back(batch.atlas_source(impact_24_image));
+      GLint max_texture_size = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+      atlas = std::make_unique<texture_atlas>(sources, std::min(max_texture_size, 4096));
     }
-    {
-      shader polygon_vertex{ GL_VERTEX_SHADER, read_file_to_string("./assets/shaders/polygon.vert").c_str() };
-      shader solid_frag{ GL_FRAGMENT_SHADER, read_file_to_string("./assets/shaders/solid.frag").c_str() };
-      programs.emplace_back(polygon_vertex, solid_frag);
 
-
-      shader line_vertex{ GL_VERTEX_SHADER, read_file_to_string("./assets/shaders/line.vert").c_str() };
-      shader line_geom{ GL_GEOMETRY_SHADER, read_file_to_string("./assets/shaders/line.geom").c_str() };
-      programs.emplace_back(line_vertex, line_geom, solid_frag);
-    }
     {
-      shader vertex{ GL_VERTEX_SHADER, read_file_to_string("./assets/shaders/pt_particle.vert").c_str() };
-      shader frag{ GL_FRAGMENT_SHADER, read_file_to_string("./assets/shaders/vertex_interp.frag").c_str() };
-      programs.emplace_back(vertex, frag);
-
-      shader compute{ GL_COMPUTE_SHADER, read_file_to_string("./assets/shaders/pt_particle.comp").c_str() };
-      programs.emplace_back(compute);
+      program_cache cache{ "./cache/programs" };
+      programs.emplace_back(cache.load_or_compile({
+        { GL_VERTEX_SHADER, batch.text(sprite_vert) },
+        { GL_FRAGMENT_SHADER, batch.text(sprite_frag) } }));
+      programs.emplace_back(cache.load_or_compile({
+        { GL_VERTEX_SHADER, batch.text(sprite_vert) },
+        { GL_FRAGMENT_SHADER, batch.text(bitmap_text_frag) } }));
+      programs.emplace_back(cache.load_or_compile({
+        { GL_VERTEX_SHADER, batch.text(polygon_vert) },
+        { GL_FRAGMENT_SHADER, batch.text(solid_frag) } }));
+      programs.emplace_back(cache.load_or_compile({
+        { GL_VERTEX_SHADER, batch.text(line_vert) },
+        { GL_GEOMETRY_SHADER, batch.text(line_geom) },
+        { GL_FRAGMENT_SHADER, batch.text(solid_frag) } }));
+      programs.emplace_back(cache.load_or_compile({
+        { GL_VERTEX_SHADER, batch.text(pt_particle_vert) },
+        { GL_FRAGMENT_SHADER, batch.text(vertex_interp_frag) } }));
+      programs.emplace_back(cache.load_or_compile({
+        { GL_COMPUTE_SHADER, batch.text(pt_particle_comp) } }));
     }
 
     {
@@ -107,16 +321,13 @@ public:
     }
 
     {
-      texture tex{ "./assets/fonts/consolas_12.png" };
-      mono_fonts.emplace_back(std::move(tex), 8, 16);
+      mono_fonts.emplace_back(atlas->region(consolas_12_region), 8, 16);
     }
 
     {
-      texture tex{ "./assets/fonts/impact_24.png" };
-      prop_fonts.emplace_back(std::move(tex), read_csv_no_header("./assets/fonts/impact_24.csv"));
+      prop_fonts.emplace_back(atlas->region(impact_24_region), batch.prop_font_metrics_at(impact_24_metrics));
     }
 
-    assert(textures.capacity() == textures.size());
     assert(programs.capacity() == programs.size());
     assert(vertex_arrays.capacity() == vertex_arrays.size());
     assert(mono_fonts.capacity() == mono_fonts.size());
@@ -125,11 +336,11 @@ public:
   }
 
   /*
-  Return the statically mapped texture associated with the id.
+  Return where the statically mapped texture associated with the id is in the atlas.
   O(1)
   */
-  texture& get_texture(static_texture_id id) {
-    return textures[static_cast<int>(id)];
+  atlas_region const& get_region(static_texture_id id) const {
+    return atlas->region(static_cast<size_t>(id));
   }
 
   /*
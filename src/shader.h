@@ -2,7 +2,9 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <string_view>
 #include "gl_includes.h"
+#include "mapped_file.h"
 
 class shader {
 private:
@@ -41,6 +43,18 @@ public:
     compile_and_check(shader_idx_);
   }
 
+  // The source does not need a 0 suffix.
+  shader(int type, std::string_view shader_src) {
+    shader_idx_ = glCreateShader(static_cast<GLenum>(type));
+    GLchar const* src = shader_src.data();
+    GLint length = static_cast<GLint>(shader_src.size());
+    glShaderSource(shader_idx_, 1, &src, &length);
+    compile_and_check(shader_idx_);
+  }
+
+  // Compiles the mapped source in place, the file can be unmapped once the shader is made.
+  shader(int type, mapped_file const& shader_file) : shader(type, shader_file.view()) {}
+
   ~shader() {
     glDeleteShader(shader_idx_);
     shader_idx_ = 0;
@@ -94,16 +108,75 @@ private:
 
   GLuint prog;
 
+  struct adopt_tag {};
+
+  program(adopt_tag, GLuint linked_prog) : prog(linked_prog) {}
+
 public:
 
   template<typename... Args>
   program(Args&... programs) {
     prog = glCreateProgram();
+    glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); // lets program_cache save it
     attach_shaders(programs...);  
     link_and_check(prog);
     detach_shaders(programs...);
   }
 
+  /*
+  Links the shaders, however many there are.
+  O(shaders)
+  */
+  static program link(std::vector<shader> const& shaders) {
+    GLuint linked_prog = glCreateProgram();
+    glProgramParameteri(linked_prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (shader const& s : shaders) {
+      glAttachShader(linked_prog, s.shader_idx());
+    }
+    link_and_check(linked_prog);
+    for (shader const& s : shaders) {
+      glDetachShader(linked_prog, s.shader_idx());
+    }
+    return program(adopt_tag{}, linked_prog);
+  }
+
+  /*
+  Loads a program from a binary returned by get_binary, skipping compilation.
+  The program is not valid() if the driver rejects the binary, which it may do after any driver update.
+  */
+  static program from_binary(GLenum binary_format, void const* binary, GLsizei length) {
+    GLuint loaded_prog = glCreateProgram();
+    glProgramBinary(loaded_prog, binary_format, binary, length);
+    GLint success = 0;
+    glGetProgramiv(loaded_prog, GL_LINK_STATUS, &success);
+    if (!success) {
+      glDeleteProgram(loaded_prog);
+      loaded_prog = 0;
+    }
+    return program(adopt_tag{}, loaded_prog);
+  }
+
+  bool valid() const {
+    return (prog != 0);
+  }
+
+  /*
+  Returns the driver's binary of the linked program and sets binary_format, the binary is empty if the driver has none.
+  O(binary size)
+  */
+  std::vector<unsigned char> get_binary(GLenum& binary_format) const {
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    std::vector<unsigned char> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    binary_format = 0;
+    if (length > 0) {
+      glGetProgramBinary(prog, length, &written, &binary_format, binary.data());
+    }
+    binary.resize(static_cast<size_t>(written));
+    return binary;
+  }
+
   GLint get_uniform_location(char const* name) {
     return glGetUniformLocation(prog, name);
   }
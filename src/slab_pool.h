@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// slab_pool hands out fixed size slots for objects of type T from slabs of slab_size slots.
+// Freed slots go on an intrusive free list and are handed out again before the slabs grow,
+// so allocating and freeing are both O(1) and never touch the general heap once the pool has warmed up.
+// Slabs are only released when the pool is destroyed.
+// Not thread safe.
+template<typename T, size_t slab_size = 256>
+class slab_pool {
+private:
+  // A free slot holds the next free slot, a used slot holds a T.
+  union slot {
+    slot* next_free;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+private: // private varriables
+  std::vector<std::unique_ptr<slot[]>> slabs;
+  slot* free_list = nullptr;
+  size_t slab_used = slab_size; // slots handed out from the newest slab, starts full so the first allocation adds a slab
+  size_t live_count = 0;
+
+public: // public methods
+  slab_pool() {}
+
+  // do not copy or assign
+  slab_pool(slab_pool&) = delete;
+  slab_pool& operator=(slab_pool const&) = delete;
+
+  /*
+  Returns uninitialized memory for one T.
+  O(1)
+  */
+  void* allocate() {
+    live_count++;
+    if (free_list != nullptr) {
+      slot* s = free_list;
+      free_list = s->next_free;
+      return s->storage;
+    }
+    if (slab_used == slab_size) {
+      slabs.emplace_back(new slot[slab_size]);
+      slab_used = 0;
+    }
+    slot* s = &(slabs.back()[slab_used]);
+    slab_used++;
+    return s->storage;
+  }
+
+  /*
+  Returns memory from allocate() to the pool, the T in it must already be destroyed.
+  O(1)
+  */
+  void deallocate(void* ptr) {
+    assert(ptr != nullptr);
+    assert(live_count > 0);
+    live_count--;
+    slot* s = static_cast<slot*>(ptr);
+    s->next_free = free_list;
+    free_list = s;
+  }
+
+  // The number of slots currently handed out.
+  size_t size() const {
+    return live_count;
+  }
+
+  // The number of slots in all slabs.
+  size_t capacity() const {
+    return slabs.size() * slab_size;
+  }
+};
+
+/*
+Deriving T from pooled<T> makes new T and delete allocate from a slab_pool shared by every T.
+Deleting through a base pointer still reaches the pool as long as the base has a virtual destructor.
+Classes deriving from T are bigger than a slot so they fall back to the global heap.
+*/
+template<typename T>
+class pooled {
+public:
+  static slab_pool<T>& pool() {
+    static slab_pool<T> instance;
+    return instance;
+  }
+
+  static void* operator new(size_t size) {
+    if (size != sizeof(T)) {
+      return ::operator new(size);
+    }
+    return pool().allocate();
+  }
+
+  static void operator delete(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+      return;
+    }
+    if (size != sizeof(T)) {
+      ::operator delete(ptr);
+      return;
+    }
+    pool().deallocate(ptr);
+  }
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+// small_vector is a std::vector which keeps its first N elements inside itself.
+// Until it holds more than N elements it never allocates, after that the elements move to the heap
+// and it grows like a std::vector. Clearing keeps the heap storage so a spilled small_vector
+// does not allocate again when it refills.
+// Unlike sized_vector the capacity is not a hard limit.
+template<typename T, size_t N>
+class small_vector final {
+  static_assert(N > 0, "use std::vector when nothing is stored inline");
+private:
+  // used so that complex types can avoid being default initialized
+  alignas(T) char _inline_data[sizeof(T) * N];
+
+  T* _data; // _inline_data until the first spill, then the heap
+  size_t _size;
+  size_t _capacity;
+
+  T* _inline() {
+    return reinterpret_cast<T*>(_inline_data);
+  }
+
+  bool _is_inline() const {
+    return (_data == reinterpret_cast<T const*>(_inline_data));
+  }
+
+  void _free_heap() {
+    if (!_is_inline()) {
+      std::allocator<T>().deallocate(_data, _capacity);
+    }
+  }
+
+  // moves the elements to a heap allocation of new_capacity
+  void _grow(size_t new_capacity) {
+    assert(new_capacity > _capacity);
+    T* new_data = std::allocator<T>().allocate(new_capacity);
+    std::uninitialized_move(_data, _data + _size, new_data);
+    std::destroy_n(_data, _size);
+    _free_heap();
+    _data = new_data;
+    _capacity = new_capacity;
+  }
+
+  // takes other's elements, this must be empty and not own heap storage
+  void _steal(small_vector<T, N>& other) {
+    if (other._is_inline()) {
+      std::uninitialized_move(other._data, other._data + other._size, _data);
+      _size = other._size;
+      other.clear();
+    } else {
+      _data = other._data;
+      _size = other._size;
+      _capacity = other._capacity;
+      other._data = other._inline();
+      other._size = 0;
+      other._capacity = N;
+    }
+  }
+
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = T const*;
+  using reference = T&;
+  using const_reference = T const&;
+  using pointer = T*;
+  using const_pointer = T const*;
+  using size_type = size_t;
+
+  small_vector() : _data(_inline()), _size(0), _capacity(N) {}
+
+  // copy constructor
+  small_vector(small_vector<T, N> const& other) : small_vector() {
+    reserve(other._size);
+    std::uninitialized_copy(other.cbegin(), other.cend(), _data);
+    _size = other._size;
+  }
+
+  // move constructor
+  small_vector(small_vector<T, N>&& other) : small_vector() {
+    _steal(other);
+  }
+
+  // copy assignment operator
+  small_vector<T, N>& operator= (small_vector<T, N> const& other) {
+    if (this != (&other)) {
+      clear();
+      reserve(other._size);
+      std::uninitialized_copy(other.cbegin(), other.cend(), _data);
+      _size = other._size;
+    }
+    return *this;
+  }
+
+  // move assignment operator
+  small_vector<T, N>& operator= (small_vector<T, N>&& other) {
+    if (this != (&other)) {
+      clear();
+      _free_heap();
+      _data = _inline();
+      _capacity = N;
+      _steal(other);
+    }
+    return *this;
+  }
+
+  ~small_vector() {
+    clear();
+    _free_heap();
+  }
+
+  iterator erase(const_iterator pos) {
+    return erase(pos, pos + 1);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    assert(first <= last);
+    assert(last <= cend());
+    iterator ifirst = const_cast<iterator>(first);
+    iterator new_end = std::move(const_cast<iterator>(last), end(), ifirst);
+    std::destroy(new_end, end());
+    _size -= std::distance(first, last);
+    return ifirst;
+  }
+
+  void pop_back() {
+    assert(_size > 0);
+    _size--;
+    std::destroy_at(_data + _size);
+  }
+
+  // keeps the capacity
+  void clear() noexcept {
+    std::destroy_n(_data, _size);
+    _size = 0;
+  }
+
+  bool empty() const noexcept {
+    return (_size == 0);
+  }
+
+  /*
+  Makes room for count elements without further allocation.
+  O(n) if it has to grow
+  */
+  void reserve(size_type count) {
+    if (count > _capacity) {
+      _grow(count);
+    }
+  }
+
+  // Whether the elements are still stored inside the small_vector.
+  bool is_inline() const {
+    return _is_inline();
+  }
+
+  pointer data() noexcept {
+    return _data;
+  }
+
+  const_pointer data() const noexcept {
+    return _data;
+  }
+
+  reference operator[](size_type pos) {
+    assert(pos < _size);
+    return _data[pos];
+  }
+
+  const_reference operator[](size_type pos) const {
+    assert(pos < _size);
+    return _data[pos];
+  }
+
+  reference front() {
+    assert(_size > 0);
+    return _data[0];
+  }
+
+  const_reference front() const {
+    assert(_size > 0);
+    return _data[0];
+  }
+
+  reference back() {
+    assert(_size > 0);
+    return _data[_size - 1];
+  }
+
+  const_reference back() const {
+    assert(_size > 0);
+    return _data[_size - 1];
+  }
+
+  size_t size() const {
+    return _size;
+  }
+
+  size_t capacity() const {
+    return _capacity;
+  }
+
+  static constexpr size_t inline_capacity() {
+    return N;
+  }
+
+  /*
+  Amortized O(1), the first push past N moves the elements to the heap.
+  */
+  template<typename... Args>
+  reference emplace_back(Args&&... args) {
+    if (_size == _capacity) {
+      // construct first in case args refer to an element which is about to move
+      T value(std::forward<Args>(args)...);
+      _grow(std::max<size_t>(2 * _capacity, 1));
+      T* placed = new (_data + _size) T(std::move(value));
+      _size++;
+      return *placed;
+    }
+    T* placed = new (_data + _size) T(std::forward<Args>(args)...);
+    _size++;
+    return *placed;
+  }
+
+  void push_back(T const& value) {
+    emplace_back(value);
+  }
+
+  void push_back(T&& value) {
+    emplace_back(std::move(value));
+  }
+
+  const_iterator cbegin() const {
+    return _data;
+  }
+
+  const_iterator cend() const {
+    return _data + _size;
+  }
+
+  const_iterator begin() const {
+    return _data;
+  }
+
+  const_iterator end() const {
+    return _data + _size;
+  }
+
+  iterator begin() {
+    return _data;
+  }
+
+  iterator end() {
+    return _data + _size;
+  }
+};
@@ -7,13 +7,17 @@
 
 #include "2d_math.h"
 #include "sized_vector.h"
+#include "small_vector.h"
 
 #include "grid_map.h"
+#include "morton.h"
 
-template <typename T, size_t C, size_t R>
+// Each of the C x R cells keeps its first I entries inline,
+// so filling a cell only allocates once it holds more than I entries.
+template <typename T, size_t C, size_t R, size_t I = 8>
 class space_buckets {
 public:
-  using bucket = std::vector<T>;
+  using bucket = small_vector<T, I>;
   using bucket_ptr = bucket*;
   using bucket_const_ptr = bucket const*;
 private:
@@ -26,7 +30,7 @@ public:
   space_buckets(bounds b) : cell_map_(std::move(b)) {}
 
   bool location_contains(vector_2f const& pos, T const& entry) {
-    bucket& vec cell_map_(pos);
+    bucket& vec = cell_map_(pos);
     return (std::find(vec.begin(), vec.end(), entry) != vec.end());
   }
 
@@ -57,6 +61,15 @@ public:
     return nearby;
   }
 
+  /*
+  The Morton code of the cell containing pos.
+  Sorting by it keeps things in the same or nearby cells close together.
+  */
+  uint32_t curve_key(vector_2f const& pos) {
+    vector_2i idx = cell_map_.getIdx(pos);
+    return morton::encode(static_cast<uint32_t>(idx.x), static_cast<uint32_t>(idx.y));
+  }
+
   void remove_entry(vector_2f const& pos, T const& entry) {
     bucket& vec = cell_map_(pos);
     auto vec_it = std::find(vec.begin(), vec.end(), entry);
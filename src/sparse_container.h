@@ -8,6 +8,7 @@
 #include <type_traits>
 
 #include "fast_bitset.h"
+#include "summary_bitset.h"
 
 #define USE_FAST_BITSET
 
@@ -24,7 +25,10 @@ private:
 
   size_t _size;
 #ifdef USE_FAST_BITSET
-  fast_bitset<N> _occupied;
+  // Above this capacity finding a free or occupied slot goes through a summary of which chunks are full or empty.
+  static constexpr size_t summary_capacity = 4096;
+  using occupied_bitset = std::conditional_t<(N > summary_capacity), summary_bitset<N>, fast_bitset<N>>;
+  occupied_bitset _occupied;
 #else
   std::bitset<N> _occupied;
 #endif
@@ -75,17 +79,26 @@ public:
     using iterator_category = std::input_iterator_tag;
     using container_pointer = std::conditional_t<C, sparse_container<T,N> const*, sparse_container<T, N>*>;
 
+    // a singular iterator which must be assigned before use
+    base_iterator() : _con(nullptr), _idx(0) {}
+
     template<bool B>
     base_iterator(base_iterator<B> other) : _con(other.container()), _idx(other.index()) {}
 
     base_iterator& operator++() { // pre-increment
       assert(_idx != _con->capacity());
 
+#ifdef USE_FAST_BITSET
+      // skip whole empty chunks rather than testing every bit
+      size_t next = (_idx + 1 < _con->capacity()) ? _con->_occupied.first_true(_idx + 1) : fast_bitset_utils::npos();
+      _idx = (next == fast_bitset_utils::npos()) ? _con->capacity() : next;
+#else
       for (_idx++; _idx < _con->capacity(); _idx++) {
         if (_con->_occupied[_idx]) {
           break;
         }
       }
+#endif
 
       return *this;
     }
@@ -200,6 +213,7 @@ public:
     if (this != (&other)) {
       clear();
       _size = other._size;
+      _occupied = other._occupied;
 
       for (size_t i = 0; i < capacity(); i++) {
         if (_occupied[i]) {
@@ -340,11 +354,70 @@ public:
     return _size;
   }
 
+#ifdef USE_FAST_BITSET
+  /*
+  Calls func(value) for every element, a chunk of the occupied bitset at a time.
+  Empty chunks are skipped and only set bits are visited, so the cost is proportional to size() plus the chunk scan.
+  func may erase the element it is given, elements pushed during the visit may or may not be visited.
+  */
+  template<typename F>
+  void for_each_occupied(F func) {
+    size_t constexpr chunk_bits = occupied_bitset::bits_per_chunk;
+    for (size_t chunk_idx = _occupied.first_non_empty_chunk(0); chunk_idx < _occupied.chunk_count(); chunk_idx = _occupied.first_non_empty_chunk(chunk_idx + 1)) {
+      auto bits = _occupied.chunk_at(chunk_idx);
+      T* chunk_data = _typed_data() + chunk_idx * chunk_bits;
+      while (bits != 0) {
+        func(chunk_data[fast_bitset_utils::word_least_significant_bit(bits)]);
+        bits &= bits - 1; // clear the lowest set bit
+      }
+    }
+  }
+
+  template<typename F>
+  void for_each_occupied(F func) const {
+    size_t constexpr chunk_bits = occupied_bitset::bits_per_chunk;
+    for (size_t chunk_idx = _occupied.first_non_empty_chunk(0); chunk_idx < _occupied.chunk_count(); chunk_idx = _occupied.first_non_empty_chunk(chunk_idx + 1)) {
+      auto bits = _occupied.chunk_at(chunk_idx);
+      T const* chunk_data = _typed_data() + chunk_idx * chunk_bits;
+      while (bits != 0) {
+        func(chunk_data[fast_bitset_utils::word_least_significant_bit(bits)]);
+        bits &= bits - 1; // clear the lowest set bit
+      }
+    }
+  }
+
+  /*
+  Erases every element for which pred(value) is true, a chunk of the occupied bitset at a time.
+  Returns the number of elements erased.
+  O(size() + N / 64), O(size() + N / 4096) above summary_capacity
+  */
+  template<typename F>
+  size_t erase_if(F pred) {
+    size_t constexpr chunk_bits = occupied_bitset::bits_per_chunk;
+    size_t num_deleted = 0;
+    for (size_t chunk_idx = _occupied.first_non_empty_chunk(0); chunk_idx < _occupied.chunk_count(); chunk_idx = _occupied.first_non_empty_chunk(chunk_idx + 1)) {
+      auto bits = _occupied.chunk_at(chunk_idx);
+      while (bits != 0) {
+        size_t idx = chunk_idx * chunk_bits + fast_bitset_utils::word_least_significant_bit(bits);
+        bits &= bits - 1; // clear the lowest set bit
+        T& value = _typed_data()[idx];
+        if (pred(value)) {
+          std::destroy_at(&value);
+          _occupied.reset(idx);
+          num_deleted++;
+        }
+      }
+    }
+    _size -= num_deleted;
+    return num_deleted;
+  }
+#endif
+
   void erase(const_iterator pos) {
     assert(pos.index() < capacity());
     assert(_occupied[pos.index()]);
     std::destroy_at(&(*pos));
-    _occupied[pos.index()] = false;
+    _occupied.reset(pos.index());
     _size--;
   }
 
@@ -357,7 +430,7 @@ public:
     while (pos != last) {
       assert(_occupied[pos.index()]);
       std::destroy_at(&(*pos));
-      _occupied[pos.index()] = false;
+      _occupied.reset(pos.index());
       num_deleted++;
       ++pos;
     }
@@ -2,6 +2,7 @@
 
 #include "renderable.h"
 #include "texture.h"
+#include "texture_atlas.h"
 #include "shader.h"
 #include "vertex_array.h"
 #include "color.h"
@@ -16,8 +17,7 @@ public:
   simple_vertex_array* sprite_vertex_array;
   GLint trans_mat_idx;
   GLint proj_mat_idx;
-  GLint frames_idx;
-  GLint current_frame_idx;
+  GLint uv_rect_idx;
   GLint mask_color;
 
 
@@ -25,38 +25,43 @@ public:
     sprite_program = s_shader;
     sprite_vertex_array = s_vertex_array;
     trans_mat_idx = sprite_program->get_uniform_location("trans_mat");
-    frames_idx = sprite_program->get_uniform_location("frames");
-    current_frame_idx = sprite_program->get_uniform_location("current_frame");
+    uv_rect_idx = sprite_program->get_uniform_location("uv_rect");
     mask_color = sprite_program->get_uniform_location("mask_color");
   }
 
-  sprite* create_orphan(texture* t);
-  sprite create(texture* t);
+  sprite* create_orphan(atlas_region const* r);
+  sprite create(atlas_region const* r);
 };
 
 class sprite : public renderable {
 public:
 
   sprite_context* context;
-  texture* tex;
-
-
-  vector_2i frames{ 1, 1 };
-  vector_2i current_frame{ 0, 0 };
+  atlas_region const* region; // the image, usually packed into the static atlas
+  uv_rect uv; // the part of the atlas drawn, all of region unless a frame is selected
 
   color_rgba mask_color;
 
   sprite() {
     context = nullptr;
-    tex = nullptr;
+    region = nullptr;
   }
-  sprite(sprite_context* ctx, texture* t) {
-    init(ctx, t);
+  sprite(sprite_context* ctx, atlas_region const* r) {
+    init(ctx, r);
   }
 
-  void init(sprite_context* ctx, texture* t) {
+  void init(sprite_context* ctx, atlas_region const* r) {
     context = ctx;
-    tex = t;
+    region = r;
+    uv = region->uv;
+  }
+
+  /*
+  Draws the cell at current_frame of the region cut into frames.x by frames.y equal cells.
+  */
+  void set_frame(vector_2i frames, vector_2i current_frame) {
+    assert(region != nullptr);
+    uv = region->uv.frame(frames, current_frame);
   }
 
 
@@ -67,12 +72,11 @@ public:
     assert(context != nullptr);
     context->sprite_program->use();
 
-    assert(tex != nullptr);
-    tex->activate_bind(GL_TEXTURE0);
+    assert(region != nullptr);
+    region->tex->activate_bind(GL_TEXTURE0);
     matrix_3f full_trans = parent_trans * local_trans;
     glUniformMatrix3fv(context->trans_mat_idx, 1, GL_TRUE, full_trans.values.data());
-    glUniform2i(context->frames_idx, frames.x, frames.y);
-    glUniform2i(context->current_frame_idx, current_frame.x, current_frame.y);
+    glUniform4f(context->uv_rect_idx, uv.origin.x, uv.origin.y, uv.size.x, uv.size.y);
     glUniform4fv(context->mask_color, 1, mask_color.values.data());
 
     context->sprite_vertex_array->draw(GL_TRIANGLES);
@@ -82,10 +86,10 @@ public:
 
 };
 
-inline sprite* sprite_context::create_orphan(texture* t) {
-    return new sprite(this, t);
+inline sprite* sprite_context::create_orphan(atlas_region const* r) {
+    return new sprite(this, r);
 }
 
-inline sprite sprite_context::create(texture * t) {
-  return sprite(this, t);
+inline sprite sprite_context::create(atlas_region const* r) {
+  return sprite(this, r);
 }
@@ -0,0 +1,550 @@
+#pragma once
+
+#include "2d_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// A state stream ships the units of a world to viewers every tick as small packets.
+// Each packet is a delta against the last frame the viewer acknowledged: only units that spawned, died
+// or changed are sent, and of those only the changed fields. Positions and angles are quantized and
+// everything is bit-packed, so a unit that only moved costs a few bytes and a still one costs nothing.
+// Encoder and decoder compare quantized values, so the viewer's frames are exactly the encoder's.
+//
+// Packet layout, the header in the encoder's native byte order, then a bit stream written least significant bit first:
+//   state_packet_header
+//   varbits removed count, then each removed unit's id as a varbits gap from the previous id
+//   varbits changed count, then for each changed unit in id order:
+//     varbits id gap, 1 spawn bit
+//     spawn: varbits generation, archetype, team, zigzag x, zigzag y, angle, health, living bit
+//     otherwise: 4 bit state_field mask followed by the fields it names,
+//       zigzag varbits deltas for position and angle, health and living as they are now
+// Varbits are groups of 4 bits each followed by a bit saying whether another group follows,
+// small because most of what is sent is id gaps and deltas of a few steps.
+
+constexpr uint32_t state_stream_no_base = 0xffffffff; // a packet holding every unit rather than a delta
+constexpr float state_stream_position_step = 1.0f / 16.0f; // world units per quantization step
+constexpr int state_stream_angle_bits = 16;
+constexpr int state_stream_health_bits = 8; // health is clamped to 0 to 255
+constexpr size_t state_stream_history = 64; // frames kept waiting for an ack, or as bases to decode against
+
+// A unit as the world hands it to the encoder and the decoder hands it back.
+struct streamed_unit {
+  uint32_t id; // handle slot index, unique among the units in the world
+  uint32_t generation; // tells apart units which reuse an id
+  uint32_t archetype;
+  uint32_t team;
+  float x;
+  float y;
+  float angle;
+  int health;
+  bool living;
+};
+
+// A streamed_unit at the precision it is sent with.
+struct quantized_unit {
+  uint32_t id;
+  uint32_t generation;
+  uint32_t archetype;
+  uint32_t team;
+  int32_t x;
+  int32_t y;
+  uint32_t angle; // state_stream_angle_bits of a turn
+  uint32_t health;
+  bool living;
+
+  static quantized_unit from(streamed_unit const& u) {
+    constexpr float angle_steps = static_cast<float>(1u << state_stream_angle_bits);
+    float turns = u.angle / math_consts::tau();
+    turns -= std::floor(turns);
+    quantized_unit q;
+    q.id = u.id;
+    q.generation = u.generation;
+    q.archetype = u.archetype;
+    q.team = u.team;
+    q.x = static_cast<int32_t>(std::lround(u.x / state_stream_position_step));
+    q.y = static_cast<int32_t>(std::lround(u.y / state_stream_position_step));
+    q.angle = static_cast<uint32_t>(std::lround(turns * angle_steps)) & ((1u << state_stream_angle_bits) - 1);
+    q.health = static_cast<uint32_t>(std::clamp(u.health, 0, (1 << state_stream_health_bits) - 1));
+    q.living = u.living;
+    return q;
+  }
+
+  streamed_unit dequantized() const {
+    constexpr float angle_steps = static_cast<float>(1u << state_stream_angle_bits);
+    return { id, generation, archetype, team,
+      x * state_stream_position_step, y * state_stream_position_step,
+      (angle / angle_steps) * math_consts::tau(), static_cast<int>(health), living };
+  }
+
+  bool operator==(quantized_unit const& other) const {
+    return (id == other.id) && (generation == other.generation) && (archetype == other.archetype) && (team == other.team) &&
+      (x == other.x) && (y == other.y) && (angle == other.angle) && (health == other.health) && (living == other.living);
+  }
+};
+
+// The fields of a unit that changed since the base frame, a mask in each delta.
+enum state_field : uint32_t {
+  STATE_POSITION = 1,
+  STATE_ANGLE = 2,
+  STATE_HEALTH = 4,
+  STATE_LIVING = 8
+};
+
+struct state_packet_header {
+  uint32_t sequence;
+  uint32_t base_sequence; // or state_stream_no_base
+  uint64_t tick;
+};
+
+// Units sorted by id.
+using state_frame = std::vector<quantized_unit>;
+
+class state_bit_writer {
+private:
+  std::vector<unsigned char>& bytes;
+  uint64_t pending = 0;
+  int pending_bits = 0;
+
+public:
+  explicit state_bit_writer(std::vector<unsigned char>& out) : bytes(out) {}
+
+  void write(uint32_t value, int bits) {
+    assert((bits <= 32) && ((bits == 32) || (value < (uint64_t{ 1 } << bits))));
+    pending |= uint64_t{ value } << pending_bits;
+    pending_bits += bits;
+    while (pending_bits >= 8) {
+      bytes.push_back(static_cast<unsigned char>(pending));
+      pending >>= 8;
+      pending_bits -= 8;
+    }
+  }
+
+  void write_varbits(uint32_t value) {
+    while (value >= 0x10) {
+      write((value & 0xf) | 0x10, 5);
+      value >>= 4;
+    }
+    write(value, 5);
+  }
+
+  void write_zigzag(int32_t value) {
+    write_varbits((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+  }
+
+  // Writes out the last partial byte.
+  void flush() {
+    if (pending_bits > 0) {
+      bytes.push_back(static_cast<unsigned char>(pending));
+      pending = 0;
+      pending_bits = 0;
+    }
+  }
+};
+
+class state_bit_reader {
+private:
+  unsigned char const* at;
+  unsigned char const* end;
+  uint64_t pending = 0;
+  int pending_bits = 0;
+
+public:
+  state_bit_reader(unsigned char const* begin, unsigned char const* finish) : at(begin), end(finish) {}
+
+  bool read(int bits, uint32_t& value) {
+    assert(bits <= 32);
+    while (pending_bits < bits) {
+      if (at == end) {
+        return false;
+      }
+      pending |= uint64_t{ *(at++) } << pending_bits;
+      pending_bits += 8;
+    }
+    value = static_cast<uint32_t>(pending & ((uint64_t{ 1 } << bits) - 1));
+    pending >>= bits;
+    pending_bits -= bits;
+    return true;
+  }
+
+  bool read_varbits(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 32; shift += 4) {
+      uint32_t group;
+      if (!read(5, group)) {
+        return false;
+      }
+      value |= (group & 0xf) << shift;
+      if ((group & 0x10) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool read_zigzag(int32_t& value) {
+    uint32_t raw;
+    if (!read_varbits(raw)) {
+      return false;
+    }
+    value = static_cast<int32_t>(raw >> 1) ^ -static_cast<int32_t>(raw & 1);
+    return true;
+  }
+};
+
+// Turns the world's units into packets against the last frame the viewer acknowledged.
+class state_stream_encoder {
+private:
+  struct sent_frame {
+    uint32_t sequence;
+    state_frame frame;
+  };
+
+  std::deque<sent_frame> unacked;
+  state_frame base;
+  uint32_t base_sequence = state_stream_no_base;
+  uint32_t next_sequence = 0;
+
+  static void write_spawn(state_bit_writer& bits, quantized_unit const& u) {
+    bits.write_varbits(u.generation);
+    bits.write_varbits(u.archetype);
+    bits.write_varbits(u.team);
+    bits.write_zigzag(u.x);
+    bits.write_zigzag(u.y);
+    bits.write(u.angle, state_stream_angle_bits);
+    bits.write(u.health, state_stream_health_bits);
+    bits.write(u.living ? 1 : 0, 1);
+  }
+
+  static uint32_t changed_fields(quantized_unit const& was, quantized_unit const& now) {
+    return (((was.x != now.x) || (was.y != now.y)) ? uint32_t{ STATE_POSITION } : 0) |
+      ((was.angle != now.angle) ? uint32_t{ STATE_ANGLE } : 0) |
+      ((was.health != now.health) ? uint32_t{ STATE_HEALTH } : 0) |
+      ((was.living != now.living) ? uint32_t{ STATE_LIVING } : 0);
+  }
+
+  static void write_delta(state_bit_writer& bits, quantized_unit const& was, quantized_unit const& now, uint32_t fields) {
+    bits.write(fields, 4);
+    if (fields & STATE_POSITION) {
+      bits.write_zigzag(now.x - was.x);
+      bits.write_zigzag(now.y - was.y);
+    }
+    if (fields & STATE_ANGLE) {
+      // the shortest way round, the decoder wraps it back into range
+      int32_t turn = static_cast<int32_t>((now.angle - was.angle) << (32 - state_stream_angle_bits)) >> (32 - state_stream_angle_bits);
+      bits.write_zigzag(turn);
+    }
+    if (fields & STATE_HEALTH) {
+      bits.write(now.health, state_stream_health_bits);
+    }
+    if (fields & STATE_LIVING) {
+      bits.write(now.living ? 1 : 0, 1);
+    }
+  }
+
+public:
+  state_stream_encoder() {}
+
+  // do not copy or assign
+  state_stream_encoder(state_stream_encoder&) = delete;
+  state_stream_encoder& operator=(const state_stream_encoder&) = delete;
+
+  /*
+  Encodes the units as they are at tick into a packet appended to out, returning the packet's sequence.
+  units may be in any order.
+  O(n log n)
+  */
+  uint32_t encode(uint64_t tick, std::vector<streamed_unit> const& units, std::vector<unsigned char>& out) {
+    state_frame frame;
+    frame.reserve(units.size());
+    for (streamed_unit const& u : units) {
+      frame.push_back(quantized_unit::from(u));
+    }
+    std::sort(frame.begin(), frame.end(), [](quantized_unit const& left, quantized_unit const& right) {
+      return left.id < right.id;
+    });
+
+    // Walk the base and the frame together, both are sorted by id.
+    std::vector<uint32_t> removed;
+    std::vector<std::pair<size_t, uint32_t>> changed; // frame index and changed fields, 0 for a spawn
+    size_t b = 0;
+    for (size_t f = 0; f < frame.size(); f++) {
+      while ((b < base.size()) && (base[b].id < frame[f].id)) {
+        removed.push_back(base[b++].id);
+      }
+      if ((b < base.size()) && (base[b].id == frame[f].id)) {
+        quantized_unit const& was = base[b++];
+        if ((was.generation != frame[f].generation) || (was.archetype != frame[f].archetype) || (was.team != frame[f].team)) {
+          changed.push_back({ f, 0 });
+        } else if (uint32_t fields = changed_fields(was, frame[f])) {
+          changed.push_back({ f, fields });
+        }
+      } else {
+        changed.push_back({ f, 0 });
+      }
+    }
+    while (b < base.size()) {
+      removed.push_back(base[b++].id);
+    }
+
+    state_packet_header header{ next_sequence, base_sequence, tick };
+    size_t header_at = out.size();
+    out.resize(header_at + sizeof(header));
+    std::memcpy(out.data() + header_at, &header, sizeof(header));
+
+    state_bit_writer bits{ out };
+    bits.write_varbits(static_cast<uint32_t>(removed.size()));
+    uint32_t previous_id = 0;
+    for (uint32_t id : removed) {
+      bits.write_varbits(id - previous_id);
+      previous_id = id;
+    }
+    bits.write_varbits(static_cast<uint32_t>(changed.size()));
+    previous_id = 0;
+    b = 0;
+    for (std::pair<size_t, uint32_t> const& change : changed) {
+      quantized_unit const& now = frame[change.first];
+      bits.write_varbits(now.id - previous_id);
+      previous_id = now.id;
+      bits.write((change.second == 0) ? 1 : 0, 1);
+      if (change.second == 0) {
+        write_spawn(bits, now);
+      } else {
+        while (base[b].id != now.id) {
+          b++;
+        }
+        write_delta(bits, base[b], now, change.second);
+      }
+    }
+    bits.flush();
+
+    if (unacked.size() == state_stream_history) {
+      unacked.pop_front();
+    }
+    unacked.push_back({ next_sequence, std::move(frame) });
+    return next_sequence++;
+  }
+
+  /*
+  The viewer has the frame of sequence, later packets are encoded against it.
+  Acks of frames older than the current base or no longer kept are ignored.
+  O(history)
+  */
+  void acknowledge(uint32_t sequence) {
+    while (!unacked.empty() && (unacked.front().sequence < sequence)) {
+      unacked.pop_front();
+    }
+    if (!unacked.empty() && (unacked.front().sequence == sequence)) {
+      base = std::move(unacked.front().frame);
+      base_sequence = sequence;
+      unacked.pop_front();
+    }
+  }
+
+  uint32_t acknowledged_sequence() const {
+    return base_sequence;
+  }
+};
+
+// Rebuilds the encoder's frames from its packets, keeping recent frames as bases for the packets after.
+class state_stream_decoder {
+private:
+  struct received_frame {
+    uint32_t sequence;
+    uint64_t tick;
+    state_frame frame;
+  };
+
+  std::deque<received_frame> received;
+
+  static bool read_spawn(state_bit_reader& bits, quantized_unit& u) {
+    uint32_t living;
+    if (!bits.read_varbits(u.generation) || !bits.read_varbits(u.archetype) || !bits.read_varbits(u.team) ||
+        !bits.read_zigzag(u.x) || !bits.read_zigzag(u.y) || !bits.read(state_stream_angle_bits, u.angle) ||
+        !bits.read(state_stream_health_bits, u.health) || !bits.read(1, living)) {
+      return false;
+    }
+    u.living = (living != 0);
+    return true;
+  }
+
+  static bool read_delta(state_bit_reader& bits, quantized_unit& u) {
+    uint32_t fields;
+    if (!bits.read(4, fields)) {
+      return false;
+    }
+    if (fields & STATE_POSITION) {
+      int32_t dx, dy;
+      if (!bits.read_zigzag(dx) || !bits.read_zigzag(dy)) {
+        return false;
+      }
+      u.x += dx;
+      u.y += dy;
+    }
+    if (fields & STATE_ANGLE) {
+      int32_t turn;
+      if (!bits.read_zigzag(turn)) {
+        return false;
+      }
+      u.angle = (u.angle + static_cast<uint32_t>(turn)) & ((1u << state_stream_angle_bits) - 1);
+    }
+    if ((fields & STATE_HEALTH) && !bits.read(state_stream_health_bits, u.health)) {
+      return false;
+    }
+    if (fields & STATE_LIVING) {
+      uint32_t living;
+      if (!bits.read(1, living)) {
+        return false;
+      }
+      u.living = (living != 0);
+    }
+    return true;
+  }
+
+  bool decode_body(state_bit_reader& bits, state_frame const& base, state_frame& frame) {
+    uint32_t removed_count;
+    if (!bits.read_varbits(removed_count) || (removed_count > base.size())) {
+      return false;
+    }
+    std::vector<uint32_t> removed(removed_count);
+    uint32_t id = 0;
+    for (uint32_t& r : removed) {
+      uint32_t gap;
+      if (!bits.read_varbits(gap)) {
+        return false;
+      }
+      id += gap;
+      r = id;
+    }
+
+    uint32_t changed_count;
+    if (!bits.read_varbits(changed_count)) {
+      return false;
+    }
+    frame.reserve(base.size() + std::min<size_t>(changed_count, 1 << 20));
+    size_t b = 0;
+    size_t r = 0;
+    // Copies base units before id which were not removed.
+    auto keep_base_before = [&](uint64_t id_limit) {
+      while ((b < base.size()) && (base[b].id < id_limit)) {
+        if ((r < removed.size()) && (removed[r] == base[b].id)) {
+          r++;
+        } else {
+          frame.push_back(base[b]);
+        }
+        b++;
+      }
+    };
+    id = 0;
+    for (uint32_t i = 0; i < changed_count; i++) {
+      uint32_t gap, spawn;
+      if (!bits.read_varbits(gap) || ((i > 0) && (gap == 0)) || !bits.read(1, spawn)) {
+        return false;
+      }
+      id += gap;
+      keep_base_before(id);
+      bool in_base = (b < base.size()) && (base[b].id == id);
+      quantized_unit u;
+      if (spawn) {
+        u.id = id;
+        if (!read_spawn(bits, u)) {
+          return false;
+        }
+      } else {
+        if (!in_base) {
+          return false;
+        }
+        u = base[b];
+        if (!read_delta(bits, u)) {
+          return false;
+        }
+      }
+      if (in_base) {
+        b++;
+      }
+      frame.push_back(u);
+    }
+    keep_base_before(uint64_t{ 1 } << 32);
+    return (r == removed.size());
+  }
+
+public:
+  state_stream_decoder() {}
+
+  // do not copy or assign
+  state_stream_decoder(state_stream_decoder&) = delete;
+  state_stream_decoder& operator=(const state_stream_decoder&) = delete;
+
+  /*
+  Decodes a packet, returning false if it is malformed or its base frame is no longer kept.
+  On success the packet's frame is the latest and its sequence should be acknowledged to the encoder.
+  O(n)
+  */
+  bool decode(unsigned char const* packet, size_t size) {
+    state_packet_header header;
+    if (size < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, packet, sizeof(header));
+    state_frame empty;
+    state_frame const* base = &empty;
+    if (header.base_sequence != state_stream_no_base) {
+      auto it = std::find_if(received.begin(), received.end(), [&header](received_frame const& f) {
+        return f.sequence == header.base_sequence;
+      });
+      if (it == received.end()) {
+        return false;
+      }
+      base = &(it->frame);
+    }
+
+    state_bit_reader bits{ packet + sizeof(header), packet + size };
+    state_frame frame;
+    if (!decode_body(bits, *base, frame)) {
+      return false;
+    }
+    if (received.size() == state_stream_history) {
+      received.pop_front();
+    }
+    received.push_back({ header.sequence, header.tick, std::move(frame) });
+    return true;
+  }
+
+  bool empty() const {
+    return received.empty();
+  }
+
+  uint32_t latest_sequence() const {
+    assert(!empty());
+    return received.back().sequence;
+  }
+
+  uint64_t latest_tick() const {
+    assert(!empty());
+    return received.back().tick;
+  }
+
+  // The latest frame at the precision it was sent with, sorted by id.
+  state_frame const& latest_frame() const {
+    assert(!empty());
+    return received.back().frame;
+  }
+
+  /*
+  The units of the latest frame.
+  O(n)
+  */
+  std::vector<streamed_unit> latest_units() const {
+    std::vector<streamed_unit> units;
+    units.reserve(latest_frame().size());
+    for (quantized_unit const& u : latest_frame()) {
+      units.push_back(u.dequantized());
+    }
+    return units;
+  }
+};
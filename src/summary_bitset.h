@@ -0,0 +1,203 @@
+#pragma once
+
+#include "fast_bitset.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+// summary_bitset is a fixed size bitset for large N with a second level index over its 64 bit chunks.
+// One summary bit per chunk records whether the chunk has any set bit and another whether it has any clear bit,
+// so searches read the summary to jump straight to the right chunk instead of scanning every chunk.
+// A search reads at most N / 4096 summary words plus one chunk.
+// Bits are changed through set and reset so the summary stays in step, there is no writable operator[].
+template<size_t N>
+class summary_bitset {
+public:
+  using chunk_type = uint64_t;
+
+  // The bits are stored in chunks of this many bits, bit i is bit (i % bits_per_chunk) of chunk (i / bits_per_chunk).
+  static constexpr size_t bits_per_chunk = 64;
+
+  static constexpr size_t chunk_count() {
+    return (N + 63) / 64;
+  }
+
+  // The chunk holding bits [chunk_idx * bits_per_chunk, (chunk_idx + 1) * bits_per_chunk).
+  chunk_type chunk_at(size_t chunk_idx) const {
+    assert(chunk_idx < chunk_count());
+    return _chunks[chunk_idx];
+  }
+
+private:
+  static constexpr chunk_type all_ones = std::numeric_limits<chunk_type>::max();
+
+  // The bits of the chunk which are inside the bitset.
+  static constexpr chunk_type chunk_mask(size_t chunk_idx) {
+    return ((chunk_idx == chunk_count() - 1) && ((N % 64) != 0)) ? ((chunk_type{ 1 } << (N % 64)) - 1) : all_ones;
+  }
+
+  std::array<chunk_type, (N + 63) / 64> _chunks;
+  fast_bitset<(N + 63) / 64> _non_empty_chunks;
+  fast_bitset<(N + 63) / 64> _non_full_chunks;
+  size_t _count;
+
+  void update_summary(size_t chunk_idx) {
+    chunk_type chunk = _chunks[chunk_idx];
+    _non_empty_chunks.set(chunk_idx, chunk != 0);
+    _non_full_chunks.set(chunk_idx, chunk != chunk_mask(chunk_idx));
+  }
+
+  size_t first_true_from_chunk(size_t chunk_idx) const {
+    if (chunk_idx >= chunk_count()) {
+      return fast_bitset_utils::npos();
+    }
+    chunk_idx = _non_empty_chunks.first_true(chunk_idx);
+    if (chunk_idx == fast_bitset_utils::npos()) {
+      return fast_bitset_utils::npos();
+    }
+    return fast_bitset_utils::word_least_significant_bit(_chunks[chunk_idx]) + 64 * chunk_idx;
+  }
+
+  size_t first_false_from_chunk(size_t chunk_idx) const {
+    if (chunk_idx >= chunk_count()) {
+      return fast_bitset_utils::npos();
+    }
+    chunk_idx = _non_full_chunks.first_true(chunk_idx);
+    if (chunk_idx == fast_bitset_utils::npos()) {
+      return fast_bitset_utils::npos();
+    }
+    chunk_type free_bits = ~_chunks[chunk_idx] & chunk_mask(chunk_idx);
+    return fast_bitset_utils::word_least_significant_bit(free_bits) + 64 * chunk_idx;
+  }
+
+public:
+  summary_bitset() {
+    reset();
+  }
+
+  constexpr size_t size() const noexcept {
+    return N;
+  }
+
+  // O(1)
+  size_t count() const {
+    return _count;
+  }
+
+  // O(1)
+  bool any() const {
+    return (_count != 0);
+  }
+
+  // O(1)
+  bool none() const {
+    return (_count == 0);
+  }
+
+  bool test(size_t pos) const {
+    assert(pos < size());
+    return (_chunks[pos / 64] >> (pos % 64)) & 1;
+  }
+
+  bool operator[](size_t pos) const {
+    return test(pos);
+  }
+
+  // O(1)
+  summary_bitset<N>& set(size_t pos, bool value = true) {
+    assert(pos < size());
+    chunk_type& chunk = _chunks[pos / 64];
+    chunk_type bit = chunk_type{ 1 } << (pos % 64);
+    bool was_set = (chunk & bit) != 0;
+    if (was_set == value) {
+      return *this;
+    }
+    if (value) {
+      chunk |= bit;
+      _count++;
+    } else {
+      chunk &= ~bit;
+      _count--;
+    }
+    update_summary(pos / 64);
+    return *this;
+  }
+
+  // O(1)
+  summary_bitset<N>& reset(size_t pos) {
+    return set(pos, false);
+  }
+
+  // O(N/64)
+  summary_bitset<N>& set() {
+    for (size_t i = 0; i < chunk_count(); i++) {
+      _chunks[i] = chunk_mask(i);
+    }
+    _non_empty_chunks.set();
+    _non_full_chunks.reset();
+    _count = N;
+    return *this;
+  }
+
+  // O(N/64)
+  summary_bitset<N>& reset() {
+    _chunks.fill(0);
+    _non_empty_chunks.reset();
+    _non_full_chunks.set();
+    _count = 0;
+    return *this;
+  }
+
+  // O(N/4096)
+  size_t first_true() const {
+    return first_true_from_chunk(0);
+  }
+
+  // O(N/4096)
+  size_t first_true(size_t start) const {
+    assert(start < size());
+    size_t chunk_idx = start / 64;
+    chunk_type chunk = _chunks[chunk_idx] & (all_ones << (start % 64));
+    if (chunk != 0) {
+      return fast_bitset_utils::word_least_significant_bit(chunk) + 64 * chunk_idx;
+    }
+    return first_true_from_chunk(chunk_idx + 1);
+  }
+
+  // O(N/4096)
+  size_t first_false() const {
+    return first_false_from_chunk(0);
+  }
+
+  // O(N/4096)
+  size_t first_false(size_t start) const {
+    assert(start < size());
+    size_t chunk_idx = start / 64;
+    chunk_type chunk = ~_chunks[chunk_idx] & chunk_mask(chunk_idx) & (all_ones << (start % 64));
+    if (chunk != 0) {
+      return fast_bitset_utils::word_least_significant_bit(chunk) + 64 * chunk_idx;
+    }
+    return first_false_from_chunk(chunk_idx + 1);
+  }
+
+  /*
+  Returns the index of the first chunk at or after chunk_idx with any bit set, or chunk_count().
+  O(N/4096)
+  */
+  size_t first_non_empty_chunk(size_t chunk_idx) const {
+    if (chunk_idx >= chunk_count()) {
+      return chunk_count();
+    }
+    size_t found = _non_empty_chunks.first_true(chunk_idx);
+    return (found == fast_bitset_utils::npos()) ? chunk_count() : found;
+  }
+
+  bool operator==(summary_bitset<N> const& other) const {
+    return (_chunks == other._chunks);
+  }
+
+  bool operator!=(summary_bitset<N> const& other) const {
+    return !(*this == other);
+  }
+};
@@ -20,17 +20,22 @@ inline vector_2f command::get_potential_force(vector_2f location) {
 }
 
 inline void legion::add_unit(unit* member) {
+  member->legion_idx = units.size();
   units.push_back(member);
 }
 
 inline void legion::remove_unit(unit* member) {
-  auto it = std::find_if(units.begin(), units.end(), [member](unit* child) {
-    return (member == child);
-  });
-  if (it != units.end()) {
-    std::swap(units.back(), *it);
-    units.pop_back();
-  }
+  assert((member->legion_idx < units.size()) && (units[member->legion_idx] == member));
+  unit* last = units.back();
+  units[member->legion_idx] = last;
+  last->legion_idx = member->legion_idx;
+  units.pop_back();
+}
+
+inline void legion::replace_unit(unit* member, unit* replacement) {
+  assert((member->legion_idx < units.size()) && (units[member->legion_idx] == member));
+  units[member->legion_idx] = replacement;
+  replacement->legion_idx = member->legion_idx;
 }
 
 inline legion::~legion() {
@@ -5,6 +5,7 @@
 #include "geom.h"
 #include "sprite.h"
 #include<string>
+#include <cassert>
 
 class unit;
 
@@ -22,16 +23,20 @@ private:
 public:
   command order;
 
+  // Units know their index in units so removing and replacing them is O(1).
   void add_unit(unit* member);
 
   void remove_unit(unit* member);
 
+  void replace_unit(unit* member, unit* replacement);
+
   ~legion();
 };
 
-class team : public renderable_parent<unit, true> {
+// Units are partitioned by their concrete type, which must be final.
+class team : public partitioned_parent<unit> {
 private:
-  using super = renderable_parent<unit, true>;
+  using super = partitioned_parent<unit>;
   std::vector<std::unique_ptr<legion>> legions;
   std::vector<team*> enemy_teams;
 public:
@@ -48,6 +53,15 @@ public:
 
   legion& create_legion();
 
+  size_t legion_count() const {
+    return legions.size();
+  }
+
+  legion& legion_at(size_t idx) {
+    assert(idx < legions.size());
+    return *(legions[idx]);
+  }
+
   ~team();
 };
 
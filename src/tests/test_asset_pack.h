@@ -0,0 +1,97 @@
+#pragma once
+#include "../asset_pack.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+TEST_CASE("Tests asset_pack", "[asset_pack]") {
+  char const* filename = "test_asset_pack.pack";
+
+  std::vector<unsigned char> pixels(3 * 2 * 4);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    pixels[i] = static_cast<unsigned char>(i * 7);
+  }
+  prop_font_metrics metrics;
+  metrics.char_height = 24;
+  metrics.char_max_width = 20;
+  for (size_t i = 0; i < metrics.char_widths.size(); i++) {
+    metrics.char_widths[i] = static_cast<int32_t>(i % 13);
+  }
+
+  {
+    asset_pack_writer writer;
+    REQUIRE(writer.add_text("shaders/sprite.vert", "void main() {}"));
+    REQUIRE(writer.add_texture("textures/small.png", 3, 2, pixels.data()));
+    REQUIRE(writer.add_prop_font_metrics("fonts/impact_24.csv", metrics));
+    REQUIRE(writer.add_text("a/odd_size.txt", "xyz"));
+    REQUIRE(!writer.add_text(std::string(asset_pack_max_name, 'n'), "too long"));
+    REQUIRE(writer.write(filename));
+  }
+
+  SECTION("reads back every entry") {
+    asset_pack pack{ filename };
+    REQUIRE(pack.valid());
+    REQUIRE(pack.size() == 4);
+
+    char const* text = pack.find_text("shaders/sprite.vert");
+    REQUIRE(text != nullptr);
+    REQUIRE(std::string(text) == "void main() {}");
+    REQUIRE(std::string(pack.find_text("a/odd_size.txt")) == "xyz");
+
+    asset_pack_entry const* tex = pack.find_texture("textures/small.png");
+    REQUIRE(tex != nullptr);
+    REQUIRE(tex->width == 3);
+    REQUIRE(tex->height == 2);
+    REQUIRE(std::equal(pixels.begin(), pixels.end(), pack.entry_data(*tex)));
+
+    prop_font_metrics const* found_metrics = pack.find_prop_font_metrics("fonts/impact_24.csv");
+    REQUIRE(found_metrics != nullptr);
+    REQUIRE(found_metrics->char_height == 24);
+    REQUIRE(found_metrics->char_max_width == 20);
+    REQUIRE(found_metrics->char_widths == metrics.char_widths);
+
+    for (size_t i = 0; i < pack.size(); i++) {
+      REQUIRE(pack.entry_at(i).offset % asset_pack_alignment == 0);
+    }
+  }
+
+  SECTION("missing names and wrong kinds are not found") {
+    asset_pack pack{ filename };
+    REQUIRE(pack.find("shaders/missing.vert") == nullptr);
+    REQUIRE(pack.find_texture("shaders/sprite.vert") == nullptr);
+    REQUIRE(pack.find_text("textures/small.png") == nullptr);
+    REQUIRE(pack.find_prop_font_metrics("a/odd_size.txt") == nullptr);
+  }
+
+  SECTION("missing and corrupt files are invalid") {
+    asset_pack missing{ "test_asset_pack_missing.pack" };
+    REQUIRE(!missing.valid());
+    REQUIRE(missing.find_text("shaders/sprite.vert") == nullptr);
+
+    FILE* corrupt = fopen(filename, "r+b");
+    REQUIRE(corrupt != nullptr);
+    fputc('X', corrupt);
+    fclose(corrupt);
+    asset_pack bad_magic{ filename };
+    REQUIRE(!bad_magic.valid());
+  }
+
+  SECTION("duplicate names are rejected") {
+    asset_pack_writer writer;
+    REQUIRE(writer.add_text("same", "a"));
+    REQUIRE(writer.add_text("same", "b"));
+    REQUIRE(!writer.write("test_asset_pack_duplicate.pack"));
+  }
+
+  SECTION("font metrics parse from csv") {
+    csv info = parse_csv_no_header("Cell Height,24\nCell Width,20\nChar 65 Base Width,14\n");
+    prop_font_metrics parsed = prop_font_metrics::from_csv(info);
+    REQUIRE(parsed.char_height == 24);
+    REQUIRE(parsed.char_max_width == 20);
+    REQUIRE(parsed.char_widths['A' - prop_font_metrics::first_char] == 14);
+    REQUIRE(parsed.char_widths['B' - prop_font_metrics::first_char] == 0);
+  }
+
+  std::remove(filename);
+}
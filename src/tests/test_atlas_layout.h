@@ -0,0 +1,96 @@
+#pragma once
+#include "../atlas_layout.h"
+#include <catch.hpp>
+#include <random>
+#include <vector>
+
+namespace {
+  bool placements_overlap(atlas_layout const& layout, std::vector<vector_2i> const& sizes, size_t a, size_t b, int padding) {
+    atlas_layout::placement const& pa = layout.placements[a];
+    atlas_layout::placement const& pb = layout.placements[b];
+    if (pa.page != pb.page) {
+      return false;
+    }
+    return (pa.origin.x - padding < pb.origin.x + sizes[b].x + padding) && (pb.origin.x - padding < pa.origin.x + sizes[a].x + padding) &&
+      (pa.origin.y - padding < pb.origin.y + sizes[b].y + padding) && (pb.origin.y - padding < pa.origin.y + sizes[a].y + padding);
+  }
+}
+
+TEST_CASE("Tests layout_atlas", "[atlas_layout]") {
+  SECTION("empty") {
+    atlas_layout layout = layout_atlas({}, 1024);
+    REQUIRE(layout.page_sizes.empty());
+    REQUIRE(layout.placements.empty());
+  }
+
+  SECTION("random sprites fit without overlapping") {
+    std::minstd_rand gen(3);
+    std::vector<vector_2i> sizes;
+    for (int i = 0; i < 60; i++) {
+      sizes.push_back({ static_cast<int>(8 + gen() % 120), static_cast<int>(8 + gen() % 120) });
+    }
+    int const max_page_size = 512;
+    atlas_layout layout = layout_atlas(sizes, max_page_size, 1);
+    REQUIRE(layout.placements.size() == sizes.size());
+    REQUIRE(layout.page_sizes.size() >= 1);
+
+    bool in_bounds = true;
+    for (size_t i = 0; i < sizes.size(); i++) {
+      atlas_layout::placement const& place = layout.placements[i];
+      REQUIRE(place.page < layout.page_sizes.size());
+      vector_2i page_size = layout.page_sizes[place.page];
+      in_bounds = in_bounds && (page_size.x <= max_page_size) && (page_size.y <= max_page_size) &&
+        (place.origin.x >= 1) && (place.origin.y >= 1) &&
+        (place.origin.x + sizes[i].x + 1 <= page_size.x) && (place.origin.y + sizes[i].y + 1 <= page_size.y);
+    }
+    REQUIRE(in_bounds);
+
+    bool overlap = false;
+    for (size_t a = 0; a < sizes.size(); a++) {
+      for (size_t b = a + 1; b < sizes.size(); b++) {
+        overlap = overlap || placements_overlap(layout, sizes, a, b, 1);
+      }
+    }
+    REQUIRE(!overlap);
+  }
+
+  SECTION("a few small images share one page") {
+    std::vector<vector_2i> sizes{ { 64, 64 }, { 32, 32 }, { 128, 64 }, { 16, 16 } };
+    atlas_layout layout = layout_atlas(sizes, 4096);
+    REQUIRE(layout.page_sizes.size() == 1);
+    REQUIRE(layout.page_sizes[0].x <= 256);
+  }
+}
+
+TEST_CASE("Tests compose_atlas_pages", "[atlas_layout]") {
+  std::vector<vector_2i> sizes{ { 3, 2 }, { 1, 4 } };
+  std::vector<unsigned char> first(3 * 2 * 4);
+  std::vector<unsigned char> second(1 * 4 * 4);
+  for (size_t i = 0; i < first.size(); i++) {
+    first[i] = static_cast<unsigned char>(i + 1);
+  }
+  for (size_t i = 0; i < second.size(); i++) {
+    second[i] = static_cast<unsigned char>(100 + i);
+  }
+  atlas_layout layout = layout_atlas(sizes, 64);
+  std::vector<std::vector<unsigned char>> pages = compose_atlas_pages(layout, sizes, { first.data(), second.data() });
+  REQUIRE(pages.size() == layout.page_sizes.size());
+
+  auto pixel = [&](size_t image, int x, int y, int channel) {
+    atlas_layout::placement const& place = layout.placements[image];
+    vector_2i page_size = layout.page_sizes[place.page];
+    return pages[place.page][((place.origin.y + y) * page_size.x + place.origin.x + x) * 4 + channel];
+  };
+  REQUIRE(pixel(0, 0, 0, 0) == 1);
+  REQUIRE(pixel(0, 2, 1, 3) == first.back());
+  REQUIRE(pixel(1, 0, 3, 3) == second.back());
+
+  SECTION("uv frames") {
+    uv_rect whole{ { 0.5f, 0.25f }, { 0.25f, 0.5f } };
+    uv_rect cell = whole.frame({ 2, 2 }, { 1, 0 });
+    REQUIRE(cell.origin.x == Approx(0.625f));
+    REQUIRE(cell.origin.y == Approx(0.25f));
+    REQUIRE(cell.size.x == Approx(0.125f));
+    REQUIRE(cell.size.y == Approx(0.25f));
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "../bucketed_parent.h"
+#include <catch.hpp>
+
+namespace {
+  // Stands in for a threat, GL free
+  class test_shot : public renderable {
+  public:
+    trans_state trans;
+    int damage;
+
+    test_shot(vector_2f pos, int dp) : damage(dp) {
+      trans.set_position(pos);
+    }
+
+    void render(matrix_3f const&) override {}
+
+    test_shot* relocate() {
+      return new test_shot(*this);
+    }
+  };
+
+  class test_shot_parent : public bucketed_parent<test_shot> {
+  public:
+    test_shot_parent() : bucketed_parent({ { -500, -500 }, { 500, 500 } }) {}
+
+    bool update() override {
+      buckets.clear();
+      for (int i = 0; i < child_count(); i++) {
+        buckets.add_entry(child_at(i).trans.get_position(), &child_at(i));
+      }
+      return false;
+    }
+  };
+
+  // What unit::take_threats does, the damage of every shot near pos
+  int damage_near(test_shot_parent& shots, vector_2f pos) {
+    int damage = 0;
+    for (auto&& bucket : shots.get_nearby(pos)) {
+      for (test_shot* shot : *bucket) {
+        if ((shot->trans.get_position() - pos).magnitude() < 1.0f) {
+          damage += shot->damage;
+        }
+      }
+    }
+    return damage;
+  }
+}
+
+TEST_CASE("bucketed_parent keeps its buckets filled across a storage sort", "[bucketed_parent]") {
+  test_shot_parent shots;
+  for (int i = 0; i < 200; i++) {
+    // added in an order far from the curve order so sorting moves them
+    shots.add_orphan(new test_shot({ static_cast<float>((i * 137) % 900 - 450), static_cast<float>((i * 61) % 900 - 450) }, 1));
+  }
+  vector_2f target{ 12.5f, -40.0f };
+  shots.add_orphan(new test_shot(target, 5));
+  shots.update();
+  REQUIRE(damage_near(shots, target) == 5);
+
+  SECTION("a unit sitting on a shot is hit on a sort tick") {
+    // the world sorts storage before the teams update, so units read the buckets straight after the sort
+    shots.sort_storage();
+    REQUIRE(damage_near(shots, target) == 5);
+  }
+
+  SECTION("the buckets point at the moved children") {
+    shots.sort_storage();
+    int found = 0;
+    for (int i = 0; i < shots.child_count(); i++) {
+      test_shot& shot = shots.child_at(i);
+      for (auto&& bucket : shots.get_nearby(shot.trans.get_position())) {
+        found += static_cast<int>(std::count(bucket->begin(), bucket->end(), &shot));
+      }
+    }
+    REQUIRE(found == shots.child_count());
+  }
+}
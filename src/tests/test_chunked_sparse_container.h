@@ -0,0 +1,168 @@
+#include "../chunked_sparse_container.h"
+#include <catch.hpp>
+#include <memory>
+#include <vector>
+
+
+TEST_CASE("Tests chunked_sparse_container", "[chunked_sparse_container]") {
+  SECTION("empty") {
+    chunked_sparse_container<int, 4> con;
+    REQUIRE(con.size() == 0);
+    REQUIRE(con.capacity() == 0);
+    REQUIRE(con.begin() == con.end());
+    REQUIRE(con.cbegin() == con.cend());
+  }
+
+  SECTION("grows past one block with stable references") {
+    chunked_sparse_container<int, 4> con;
+    std::vector<int*> refs;
+    for (int i = 0; i < 10; i++) {
+      refs.push_back(&con.push(i));
+    }
+    REQUIRE(con.size() == 10);
+    REQUIRE(con.capacity() == 12);
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(*refs[i] == i);
+    }
+
+    std::vector<int> copy_vector;
+    for (int value : con) {
+      copy_vector.push_back(value);
+    }
+    REQUIRE(copy_vector == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+  }
+
+  SECTION("erased slots are reused before allocating") {
+    chunked_sparse_container<int, 4> con;
+    for (int i = 0; i < 8; i++) {
+      con.push(i);
+    }
+    int* kept = &(*(con.begin() + 6));
+    con.erase(con.begin() + 1);
+    con.erase(con.begin() + 4); // 5
+    REQUIRE(con.size() == 6);
+
+    int& first_reused = con.push(100);
+    int& second_reused = con.push(101);
+    REQUIRE(con.capacity() == 8);
+    REQUIRE(*kept == 6);
+    REQUIRE(&first_reused == &(*(con.begin() + 1)));
+    REQUIRE(&second_reused == &(*(con.begin() + 5)));
+
+    con.push(102);
+    REQUIRE(con.capacity() == 12);
+    REQUIRE(con.size() == 9);
+  }
+
+  SECTION("erase while iterating") {
+    chunked_sparse_container<int, 4> con;
+    for (int i = 0; i < 10; i++) {
+      con.push(i);
+    }
+    for (auto it = con.begin(); it != con.end(); ++it) {
+      if (*it % 2 == 0) {
+        con.erase(it);
+      }
+    }
+    std::vector<int> copy_vector(con.begin(), con.end());
+    REQUIRE(copy_vector == std::vector<int>{ 1, 3, 5, 7, 9 });
+  }
+
+  SECTION("iteration skips empty blocks") {
+    chunked_sparse_container<int, 4> con;
+    for (int i = 0; i < 12; i++) {
+      con.push(i);
+    }
+    con.erase_if([](int value) {
+      return value < 8;
+    });
+    REQUIRE(con.size() == 4);
+    REQUIRE(*con.begin() == 8);
+
+    std::vector<int> copy_vector(con.cbegin(), con.cend());
+    REQUIRE(copy_vector == std::vector<int>{ 8, 9, 10, 11 });
+  }
+
+  SECTION("end stays valid as blocks are added") {
+    chunked_sparse_container<int, 4> con;
+    con.push(0);
+    auto end = con.end();
+    auto it = con.begin();
+    for (int i = 1; i < 9; i++) {
+      con.push(i);
+    }
+    REQUIRE(end == con.end());
+    int count = 0;
+    for (; it != end; ++it) {
+      count++;
+    }
+    REQUIRE(count == 9);
+  }
+
+  SECTION("for_each_occupied and erase_if") {
+    chunked_sparse_container<int, 16> con;
+    for (int i = 0; i < 100; i++) {
+      con.push(i);
+    }
+    int sum = 0;
+    con.for_each_occupied([&sum](int value) {
+      sum += value;
+    });
+    REQUIRE(sum == 99 * 100 / 2);
+
+    size_t erased = con.erase_if([](int value) {
+      return value % 3 != 0;
+    });
+    REQUIRE(erased == 66);
+    REQUIRE(con.size() == 34);
+
+    // one func is shared by every block, so its state carries across them
+    int calls = 0;
+    con.for_each_occupied([&calls](int value) {
+      REQUIRE(value == calls * 3);
+      calls++;
+    });
+    REQUIRE(calls == 34);
+
+    // freed slots in early blocks are refilled first
+    int& refilled = con.push(-1);
+    REQUIRE(&refilled == &(*(con.begin() + 1)));
+  }
+
+  SECTION("clear and shrink_to_fit") {
+    chunked_sparse_container<int, 4> con;
+    for (int i = 0; i < 10; i++) {
+      con.push(i);
+    }
+    con.erase_if([](int value) {
+      return value >= 4;
+    });
+    REQUIRE(con.capacity() == 12);
+    con.shrink_to_fit();
+    REQUIRE(con.capacity() == 4);
+    REQUIRE(con.size() == 4);
+
+    con.push(4);
+    REQUIRE(con.capacity() == 8);
+
+    con.clear();
+    REQUIRE(con.size() == 0);
+    REQUIRE(con.begin() == con.end());
+    con.shrink_to_fit();
+    REQUIRE(con.capacity() == 0);
+  }
+
+  SECTION("more elements than one sparse_container") {
+    chunked_sparse_container<std::unique_ptr<int>, 256> con;
+    for (int i = 0; i < 3000; i++) {
+      con.emplace(new int(i));
+    }
+    REQUIRE(con.size() == 3000);
+    int expected = 0;
+    for (auto const& value : con) {
+      REQUIRE(*value == expected);
+      expected++;
+    }
+    REQUIRE(expected == 3000);
+  }
+}
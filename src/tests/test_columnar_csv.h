@@ -0,0 +1,139 @@
+#pragma once
+#include "../columnar_csv.h"
+#include "../csv.h"
+#include "../text/font_metrics.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST_CASE("Tests csv_scan", "[columnar_csv]") {
+  std::string text = "a,b\nlonger cell than sixteen bytes,,x\n\n,";
+  std::vector<size_t> expected;
+  std::vector<bool> expected_newline;
+  for (size_t i = 0; i < text.size(); i++) {
+    if ((text[i] == ',') || (text[i] == '\n')) {
+      expected.push_back(i);
+      expected_newline.push_back(text[i] == '\n');
+    }
+  }
+
+  std::vector<size_t> found;
+  std::vector<bool> found_newline;
+  csv_scan::for_each_delimiter(text, [&](size_t offset, bool is_newline) {
+    found.push_back(offset);
+    found_newline.push_back(is_newline);
+  });
+  REQUIRE(found == expected);
+  REQUIRE(found_newline == expected_newline);
+  REQUIRE(csv_scan::count_newlines(text) == 3);
+}
+
+TEST_CASE("Tests columnar_csv", "[columnar_csv]") {
+  SECTION("header and typed columns") {
+    columnar_csv table{ "name,health,speed\r\ngrunt,10,10.5\r\n\r\nheavy,80,2\r\n" };
+    REQUIRE(table.valid());
+    REQUIRE(table.has_header());
+    REQUIRE(table.rows() == 2);
+    REQUIRE(table.cols() == 3);
+    REQUIRE(table.header(2) == "speed");
+    REQUIRE(table.find_col("health") == 1);
+    REQUIRE(table.find_col("missing") == 3);
+
+    REQUIRE(table.column_type(0) == csv_column_type::text);
+    REQUIRE(table.column_type(1) == csv_column_type::integer);
+    REQUIRE(table.column_type(2) == csv_column_type::real);
+    REQUIRE(table.cell(1, 0) == "heavy");
+    REQUIRE(table.int_column(1) == std::vector<int32_t>{ 10, 80 });
+    REQUIRE(table.float_at(1, 1) == 80.0f);
+    REQUIRE(table.float_at(0, 2) == 10.5f);
+    REQUIRE(table(1, 2) == "2");
+  }
+
+  SECTION("no header and no trailing newline") {
+    columnar_csv table{ "1,2\n3,4", false };
+    REQUIRE(table.valid());
+    REQUIRE(!table.has_header());
+    REQUIRE(table.rows() == 2);
+    REQUIRE(table.int_at(1, 1) == 4);
+  }
+
+  SECTION("empty cells are text") {
+    columnar_csv table{ "a,b\n1,\n2,3\n" };
+    REQUIRE(table.valid());
+    REQUIRE(table.column_type(0) == csv_column_type::integer);
+    REQUIRE(table.column_type(1) == csv_column_type::text);
+    REQUIRE(table.cell(0, 1).empty());
+  }
+
+  SECTION("ragged rows are invalid") {
+    columnar_csv table{ "a,b\n1,2,3\n" };
+    REQUIRE(!table.valid());
+  }
+
+  SECTION("empty") {
+    columnar_csv table{ "" };
+    REQUIRE(table.valid());
+    REQUIRE(table.rows() == 0);
+    REQUIRE(table.cols() == 0);
+  }
+
+  SECTION("cells survive moving short text") {
+    columnar_csv table{ "a,b\nc,d" };
+    columnar_csv moved{ std::move(table) };
+    REQUIRE(moved.cell(0, 1) == "d");
+    REQUIRE(moved.header(0) == "a");
+  }
+
+  SECTION("matches parse_csv") {
+    std::minstd_rand gen(7);
+    std::string text = "c0,c1,c2,c3\n";
+    for (int row = 0; row < 500; row++) {
+      for (int col = 0; col < 4; col++) {
+        if (col != 0) {
+          text += ',';
+        }
+        int length = static_cast<int>(gen() % 24);
+        for (int i = 0; i < length; i++) {
+          text += static_cast<char>('a' + gen() % 26);
+        }
+      }
+      text += '\n';
+    }
+    csv expected = parse_csv(text);
+    columnar_csv table{ text };
+    REQUIRE(table.valid());
+    REQUIRE(table.rows() == static_cast<size_t>(expected.rows()));
+    REQUIRE(table.cols() == static_cast<size_t>(expected.cols()));
+    bool all_equal = true;
+    for (size_t row = 0; row < table.rows(); row++) {
+      for (size_t col = 0; col < table.cols(); col++) {
+        all_equal = all_equal && (table.cell(row, col) == expected.cell(static_cast<int>(row), static_cast<int>(col)));
+      }
+    }
+    REQUIRE(all_equal);
+  }
+
+  SECTION("from a mapped file") {
+    char const* filename = "test_columnar_csv.csv";
+    FILE* out = fopen(filename, "wb");
+    REQUIRE(out != nullptr);
+    fputs("Cell Height,24\nCell Width,20\nChar 65 Base Width,14\nChar 300 Base Width,9\nFont Name,Impact\n", out);
+    fclose(out);
+    {
+      columnar_csv info{ mapped_file{ filename }, false };
+      REQUIRE(info.valid());
+      REQUIRE(info.rows() == 5);
+      prop_font_metrics metrics = prop_font_metrics::from_csv(info);
+      REQUIRE(metrics.char_height == 24);
+      REQUIRE(metrics.char_max_width == 20);
+      REQUIRE(metrics.char_widths['A' - prop_font_metrics::first_char] == 14);
+      REQUIRE(metrics.char_widths['B' - prop_font_metrics::first_char] == 0);
+    }
+    std::remove(filename);
+
+    columnar_csv missing{ mapped_file{ filename } };
+    REQUIRE(!missing.valid());
+  }
+}
@@ -2,6 +2,8 @@
 
 #include "../fast_bitset.h"
 #include <catch.hpp>
+#include <bitset>
+#include <random>
 
 
 TEST_CASE("Tests fast_bitset", "[fast_bitset]") {
@@ -144,4 +146,74 @@ TEST_CASE("Tests fast_bitset", "[fast_bitset]") {
     medium.set(78);
     REQUIRE(medium.first_false(14) == fast_bitset_utils::npos());
   }
-}
\ No newline at end of file
+
+  SECTION("scans across many chunks") {
+    fast_bitset<1000> big;
+    REQUIRE(big.none());
+    REQUIRE(big.first_false() == 0);
+    big.set(999);
+    REQUIRE(big.any());
+    REQUIRE(big.first_true() == 999);
+    REQUIRE(big.first_true(700) == 999);
+
+    big.set();
+    REQUIRE(big.count() == 1000);
+    REQUIRE(big.first_false() == fast_bitset_utils::npos());
+    big.reset(640);
+    REQUIRE(big.first_false() == 640);
+    REQUIRE(big.first_false(641) == fast_bitset_utils::npos());
+
+    fast_bitset<128> exact;
+    exact.set();
+    REQUIRE(exact.count() == 128);
+    REQUIRE(exact.first_false() == fast_bitset_utils::npos());
+    exact.flip();
+    REQUIRE(exact.none());
+    exact.set(127);
+    REQUIRE(exact.first_true(64) == 127);
+  }
+
+  SECTION("count and bulk operations match std::bitset") {
+    size_t constexpr size = 333;
+    std::minstd_rand gen{ 3 };
+    fast_bitset<size> left;
+    fast_bitset<size> right;
+    std::bitset<size> expected_left;
+    std::bitset<size> expected_right;
+    for (size_t i = 0; i < size; i++) {
+      bool l = (gen() % 3) == 0;
+      bool r = (gen() % 2) == 0;
+      left.set(i, l);
+      right.set(i, r);
+      expected_left.set(i, l);
+      expected_right.set(i, r);
+    }
+    REQUIRE(left.count() == expected_left.count());
+    REQUIRE(right.count() == expected_right.count());
+
+    auto require_same = [](fast_bitset<size> const& actual, std::bitset<size> const& expected) {
+      REQUIRE(actual.count() == expected.count());
+      bool same = true;
+      for (size_t i = 0; i < size; i++) {
+        same = same && (actual[i] == expected[i]);
+      }
+      REQUIRE(same);
+    };
+
+    fast_bitset<size> anded = left;
+    anded &= right;
+    require_same(anded, expected_left & expected_right);
+
+    fast_bitset<size> ored = left;
+    ored |= right;
+    require_same(ored, expected_left | expected_right);
+
+    fast_bitset<size> and_notted = left;
+    and_notted.and_not(right);
+    require_same(and_notted, expected_left & ~expected_right);
+
+    REQUIRE(anded != ored);
+    and_notted |= anded;
+    REQUIRE(and_notted == left);
+  }
+}
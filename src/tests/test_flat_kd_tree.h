@@ -0,0 +1,187 @@
+#pragma once
+#include <catch.hpp>
+#include "../flat_kd_tree.h"
+#include <cmath>
+#include <random>
+
+TEST_CASE("flat_kd_tree can be built and searched", "[flat_kd_tree]") {
+  flat_kd_tree<char, 4> kd{ {
+    { { 2, 3 }, 'a' },
+    { { 5, 4 }, 'b' },
+    { { 9, 6 }, 'c' },
+    { { 4, 7 }, 'd' },
+    { { 8, 1 }, 'e' },
+    { { 7, 2 }, 'f' },
+  } };
+  REQUIRE(kd.size() == 6);
+
+  SECTION("find_closest find the closest node") {
+    flat_kd_dist<char> close = kd.find_closest({ 6, 1 });
+    REQUIRE(close.ptr != nullptr);
+    REQUIRE(*close.ptr == 'f');
+    REQUIRE(close.dist == Approx(std::sqrt(2.0f)));
+  }
+  SECTION("find_count_closest find the closest nodes") {
+    std::vector<flat_kd_dist<char>> closest = kd.find_count_closest({ 6, 2 }, 3);
+    REQUIRE(closest.size() == 3);
+    REQUIRE(*closest[0].ptr == 'f');
+    REQUIRE(closest[0].dist == Approx(1.0f));
+    REQUIRE(closest[1].dist == Approx(std::sqrt(5.0f)));
+    REQUIRE(closest[2].dist == Approx(std::sqrt(5.0f)));
+    REQUIRE(*closest[1].ptr + *closest[2].ptr == 'b' + 'e');
+  }
+  SECTION("find_within find the nodes within") {
+    std::vector<flat_kd_dist<char>> within = kd.find_within({ 3, 4 }, 4.0f);
+    REQUIRE(within.size() == 3);
+    REQUIRE(*within[0].ptr == 'a');
+    REQUIRE(within[0].dist == Approx(std::sqrt(2.0f)));
+    REQUIRE(*within[1].ptr == 'b');
+    REQUIRE(within[1].dist == Approx(2.0f));
+    REQUIRE(*within[2].ptr == 'd');
+    REQUIRE(within[2].dist == Approx(std::sqrt(10.0f)));
+  }
+  SECTION("an empty tree finds nothing") {
+    flat_kd_tree<char> empty;
+    REQUIRE(empty.find_closest({ 0, 0 }).ptr == nullptr);
+    REQUIRE(empty.find_count_closest({ 0, 0 }, 3).empty());
+    REQUIRE(empty.find_within({ 0, 0 }, 3.0f).empty());
+  }
+}
+
+TEST_CASE("flat_kd_tree agrees with kd_tree brute force search", "[flat_kd_tree]") {
+  std::minstd_rand gen{ 7 };
+  std::uniform_real_distribution<float> coord{ 0.0f, 100.0f };
+  std::vector<kd_node<int>> points;
+  for (int n = 0; n < 1000; n++) {
+    points.push_back({ { coord(gen), coord(gen) }, n });
+  }
+  kd_tree<int> brute{ points };
+  flat_kd_tree<int> flat{ points };
+  REQUIRE(flat.size() == points.size());
+
+  for (int q = 0; q < 200; q++) {
+    vector_2f pos{ coord(gen) * 1.2f - 10.0f, coord(gen) * 1.2f - 10.0f };
+
+    kd_node<int>* expected = brute.find_closest_brute(pos);
+    flat_kd_dist<int> found = flat.find_closest(pos);
+    REQUIRE(found.ptr != nullptr);
+    REQUIRE(found.dist == Approx((expected->pos - pos).magnitude()));
+
+    std::vector<kd_node_dist<int>> expected_closests = brute.find_count_closest_brute(pos, 5);
+    std::vector<flat_kd_dist<int>> found_closests = flat.find_count_closest(pos, 5);
+    REQUIRE(found_closests.size() == expected_closests.size());
+    for (size_t i = 0; i < found_closests.size(); i++) {
+      REQUIRE(found_closests[i].dist == Approx(expected_closests[i].dist));
+    }
+
+    std::vector<kd_node_dist<int>> expected_within = brute.find_within_brute(pos, 8.0f);
+    std::vector<flat_kd_dist<int>> found_within = flat.find_within(pos, 8.0f);
+    REQUIRE(found_within.size() == expected_within.size());
+    for (size_t i = 0; i < found_within.size(); i++) {
+      REQUIRE(found_within[i].dist == Approx(expected_within[i].dist));
+    }
+  }
+}
+
+TEST_CASE("flat_kd_tree stays correct as points move, spawn and die", "[flat_kd_tree]") {
+  std::minstd_rand gen{ 13 };
+  std::uniform_real_distribution<float> coord{ 0.0f, 100.0f };
+  std::uniform_real_distribution<float> step{ -2.0f, 2.0f };
+
+  std::vector<kd_node<int>> points;
+  for (int n = 0; n < 400; n++) {
+    points.push_back({ { coord(gen), coord(gen) }, n });
+  }
+  flat_kd_tree<int, 8> flat{ points };
+
+  // the live points indexed by handle, a value of -1 marks a removed handle
+  std::vector<kd_node<int>> live = points;
+
+  auto check = [&]() {
+    std::vector<kd_node<int>> remaining;
+    for (kd_node<int> const& node : live) {
+      if (node.value >= 0) {
+        remaining.push_back(node);
+      }
+    }
+    REQUIRE(flat.size() == remaining.size());
+    kd_tree<int> brute{ remaining };
+    for (int q = 0; q < 50; q++) {
+      vector_2f pos{ coord(gen), coord(gen) };
+      flat_kd_dist<int> found = flat.find_closest(pos);
+      REQUIRE(found.ptr != nullptr);
+      REQUIRE(found.dist == Approx((brute.find_closest_brute(pos)->pos - pos).magnitude()));
+      REQUIRE(flat.find_within(pos, 10.0f).size() == brute.find_within_brute(pos, 10.0f).size());
+    }
+  };
+
+  for (int tick = 0; tick < 20; tick++) {
+    for (flat_kd_tree<int, 8>::handle_type h = 0; h < live.size(); h++) {
+      if (live[h].value < 0) {
+        continue;
+      }
+      // drift everything to one side so the tree degrades
+      live[h].pos = live[h].pos + vector_2f{ step(gen) + 1.0f, step(gen) };
+      flat.move(h, live[h].pos);
+      REQUIRE(flat.position(h) == live[h].pos);
+      REQUIRE(flat.value(h) == live[h].value);
+    }
+    check();
+
+    for (int k = 0; k < 10; k++) {
+      flat_kd_tree<int, 8>::handle_type h = static_cast<flat_kd_tree<int, 8>::handle_type>(gen() % live.size());
+      if (live[h].value >= 0) {
+        flat.remove(h);
+        live[h].value = -1;
+      }
+    }
+    for (int k = 0; k < 15; k++) {
+      vector_2f pos{ coord(gen), coord(gen) };
+      int value = static_cast<int>(1000 + tick * 100 + k);
+      flat_kd_tree<int, 8>::handle_type h = flat.insert(pos, value);
+      if (h >= live.size()) {
+        live.resize(h + 1, { { 0, 0 }, -1 });
+      }
+      REQUIRE(live[h].value < 0);
+      live[h] = { pos, value };
+    }
+    check();
+
+    flat.refit();
+    check();
+  }
+
+  SECTION("removing everything leaves an empty tree") {
+    for (flat_kd_tree<int, 8>::handle_type h = 0; h < live.size(); h++) {
+      if (live[h].value >= 0) {
+        flat.remove(h);
+      }
+    }
+    flat.refit();
+    REQUIRE(flat.empty());
+    REQUIRE(flat.find_closest({ 50, 50 }).ptr == nullptr);
+    flat_kd_tree<int, 8>::handle_type h = flat.insert({ 1, 2 }, 7);
+    REQUIRE(*flat.find_closest({ 50, 50 }).ptr == 7);
+    REQUIRE(flat.position(h) == vector_2f{ 1, 2 });
+  }
+}
+
+TEST_CASE("flat_kd_tree stays shallow as points are inserted in order", "[flat_kd_tree]") {
+  // every insert lands in the rightmost leaf, without rebalancing each one would add a level
+  flat_kd_tree<int> flat;
+  std::vector<kd_node<int>> points;
+  for (int n = 0; n < 20000; n++) {
+    vector_2f pos{ static_cast<float>(n), static_cast<float>(n % 7) };
+    flat.insert(pos, n);
+    points.push_back({ pos, n });
+  }
+  REQUIRE(flat.size() == points.size());
+
+  kd_tree<int> brute{ points };
+  for (vector_2f pos : { vector_2f{ -5.0f, 0.0f }, vector_2f{ 0.0f, 3.0f }, vector_2f{ 9999.4f, 2.0f }, vector_2f{ 19999.0f, 6.0f }, vector_2f{ 30000.0f, 1.0f } }) {
+    flat_kd_dist<int> found = flat.find_closest(pos);
+    REQUIRE(found.ptr != nullptr);
+    REQUIRE(found.dist == Approx((brute.find_closest_brute(pos)->pos - pos).magnitude()));
+    REQUIRE(flat.find_within(pos, 20.0f).size() == brute.find_within_brute(pos, 20.0f).size());
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "../frame_arena.h"
+#include <catch.hpp>
+#include <cstdint>
+
+TEST_CASE("Tests frame_arena", "[frame_arena]") {
+  frame_arena arena{ 256 };
+
+  SECTION("allocations are aligned and do not overlap") {
+    char* c = arena.allocate_array<char>(3);
+    double* d = arena.allocate_array<double>(4);
+    REQUIRE(reinterpret_cast<uintptr_t>(d) % alignof(double) == 0);
+    REQUIRE(reinterpret_cast<char*>(d) >= c + 3);
+    void* wide = arena.allocate(16, 64);
+    REQUIRE(reinterpret_cast<uintptr_t>(wide) % 64 == 0);
+    REQUIRE(static_cast<char*>(wide) >= reinterpret_cast<char*>(d + 4));
+  }
+
+  SECTION("reset reuses the same memory") {
+    void* first = arena.allocate(32);
+    arena.allocate(32);
+    REQUIRE(arena.bytes_used() >= 64);
+    arena.reset();
+    REQUIRE(arena.bytes_used() == 0);
+    REQUIRE(arena.allocate(32) == first);
+  }
+
+  SECTION("overflowing grows the block on reset") {
+    for (int i = 0; i < 10; i++) {
+      int* ints = arena.allocate_array<int>(16);
+      for (int n = 0; n < 16; n++) {
+        ints[n] = n; // overflow allocations must be usable
+      }
+    }
+    size_t used = arena.bytes_used();
+    REQUIRE(used > 256);
+    arena.reset();
+    REQUIRE(arena.capacity() >= used);
+
+    // the same frame now fits in the block
+    for (int i = 0; i < 10; i++) {
+      arena.allocate_array<int>(16);
+    }
+    REQUIRE(arena.bytes_used() <= arena.capacity());
+  }
+
+  SECTION("arena_vector") {
+    arena_vector<int> vec{ arena };
+    for (int i = 0; i < 100; i++) {
+      vec.push_back(i);
+    }
+    REQUIRE(vec.size() == 100);
+    REQUIRE(vec[0] == 0);
+    REQUIRE(vec[99] == 99);
+    arena_vector<int> other{ arena };
+    REQUIRE(vec.get_allocator() == other.get_allocator());
+  }
+}
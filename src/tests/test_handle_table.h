@@ -0,0 +1,52 @@
+#pragma once
+#include "../handle_table.h"
+#include <catch.hpp>
+
+TEST_CASE("Tests handle_table", "[handle_table]") {
+  handle_table<int> table;
+  int a = 1;
+  int b = 2;
+  handle_table<int>::slot* slot_a = table.acquire(&a);
+  handle_table<int>::slot* slot_b = table.acquire(&b);
+  handle_table<int>::handle handle_a{ slot_a };
+  handle_table<int>::handle handle_b{ slot_b };
+
+  SECTION("handles resolve to their targets") {
+    REQUIRE(table.size() == 2);
+    REQUIRE(handle_a.get() == &a);
+    REQUIRE(handle_b.get() == &b);
+    REQUIRE(handle_a != handle_b);
+    REQUIRE(handle_a == handle_table<int>::handle{ slot_a });
+    REQUIRE(handle_table<int>::handle{}.get() == nullptr);
+  }
+
+  SECTION("retargeting follows a moved object") {
+    int moved = a;
+    handle_table<int>::retarget(slot_a, &moved);
+    REQUIRE(handle_a.get() == &moved);
+    REQUIRE(handle_b.get() == &b);
+  }
+
+  SECTION("released slots are reused without reviving old handles") {
+    table.release(slot_a);
+    REQUIRE(table.size() == 1);
+    REQUIRE(handle_a.get() == nullptr);
+
+    int c = 3;
+    handle_table<int>::slot* slot_c = table.acquire(&c);
+    REQUIRE(slot_c == slot_a);
+    handle_table<int>::handle handle_c{ slot_c };
+    REQUIRE(handle_c.get() == &c);
+    REQUIRE(handle_a.get() == nullptr);
+    REQUIRE(handle_a != handle_c);
+  }
+
+  SECTION("slots keep their address as the table grows") {
+    std::vector<int> values(1000);
+    for (int& v : values) {
+      table.acquire(&v);
+    }
+    REQUIRE(handle_a.get() == &a);
+    REQUIRE(handle_b.get() == &b);
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "../hash.h"
+#include <catch.hpp>
+
+TEST_CASE("Tests fnv1a_hasher", "[hash]") {
+  SECTION("known values") {
+    REQUIRE(fnv1a_hasher{}.value() == 0xcbf29ce484222325ull);
+
+    fnv1a_hasher a;
+    a.add("a");
+    REQUIRE(a.value() == 0xaf63dc4c8601ec8cull);
+
+    fnv1a_hasher foobar;
+    foobar.add("foobar");
+    REQUIRE(foobar.value() == 0x85944171f73967e8ull);
+  }
+
+  SECTION("incremental matches whole") {
+    fnv1a_hasher whole;
+    whole.add("foobar");
+    fnv1a_hasher parts;
+    parts.add("foo");
+    parts.add("");
+    parts.add("bar");
+    REQUIRE(parts.value() == whole.value());
+  }
+
+  SECTION("values") {
+    fnv1a_hasher left;
+    left.add_value(uint32_t{ 1 });
+    fnv1a_hasher right;
+    right.add_value(uint32_t{ 2 });
+    REQUIRE(left.value() != right.value());
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "../input_recording.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+  // Stands in for a stage, logging the callbacks it is given.
+  struct input_log {
+    uint64_t tick = 0;
+    std::vector<std::string> lines;
+
+    void key_callback(int key, int scancode, int action, int mods) {
+      lines.push_back(std::to_string(tick) + " key " + std::to_string(key) + " " + std::to_string(scancode) + " " + std::to_string(action) + " " + std::to_string(mods));
+    }
+
+    void cursor_position_callback(double xpos, double ypos) {
+      lines.push_back(std::to_string(tick) + " cursor " + std::to_string(xpos) + " " + std::to_string(ypos));
+    }
+
+    void mouse_button_callback(int button, int action, int mods) {
+      lines.push_back(std::to_string(tick) + " button " + std::to_string(button) + " " + std::to_string(action) + " " + std::to_string(mods));
+    }
+  };
+}
+
+TEST_CASE("Tests input_recording", "[input_recording]") {
+  char const* filename = "test_input_recording.rec";
+
+  SECTION("round trip") {
+    input_recorder recorder{ { 1, 2, 3, 4 } };
+    input_log expected;
+
+    recorder.set_tick(0);
+    recorder.cursor(10.5, 20.25);
+    expected.cursor_position_callback(10.5, 20.25);
+    recorder.key(256, 9, 1, 0);
+    expected.key_callback(256, 9, 1, 0);
+
+    recorder.set_tick(3);
+    expected.tick = 3;
+    recorder.mouse_button(0, 1, 2);
+    expected.mouse_button_callback(0, 1, 2);
+
+    recorder.set_tick(1000); // a gap wider than one varint byte
+    expected.tick = 1000;
+    recorder.key(-1, 300000, 0, 4);
+    expected.key_callback(-1, 300000, 0, 4);
+    recorder.cursor(-1.0, 719.0);
+    expected.cursor_position_callback(-1.0, 719.0);
+
+    REQUIRE(recorder.write(filename, 1200));
+
+    input_recording recording{ filename };
+    REQUIRE(recording.valid());
+    REQUIRE(recording.seed() == std::array<uint32_t, 4>{ 1, 2, 3, 4 });
+    REQUIRE(recording.tick_count() == 1200);
+    REQUIRE(recording.all_events().size() == 5);
+
+    input_log found;
+    for (uint64_t tick = 0; tick < recording.tick_count(); tick++) {
+      found.tick = tick;
+      recording.deliver(tick, found);
+    }
+    REQUIRE(found.lines == expected.lines);
+    std::remove(filename);
+  }
+
+  SECTION("truncated file is invalid") {
+    input_recorder recorder{ { 0, 0, 0, 0 } };
+    recorder.cursor(1, 2);
+    REQUIRE(recorder.write(filename, 1));
+
+    FILE* in = fopen(filename, "rb");
+    REQUIRE(in != nullptr);
+    std::vector<unsigned char> bytes(recorder.size_bytes());
+    REQUIRE(fread(bytes.data(), 1, bytes.size(), in) == bytes.size());
+    fclose(in);
+    FILE* out = fopen(filename, "wb");
+    REQUIRE(out != nullptr);
+    fwrite(bytes.data(), 1, bytes.size() - 1, out);
+    fclose(out);
+
+    input_recording recording{ filename };
+    REQUIRE(!recording.valid());
+    std::remove(filename);
+  }
+
+  SECTION("missing file is invalid") {
+    std::remove(filename);
+    input_recording recording{ filename };
+    REQUIRE(!recording.valid());
+  }
+}
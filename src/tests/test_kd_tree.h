@@ -1,7 +1,9 @@
 #pragma once
 #include <catch.hpp>
 #include "../kd_tree.h"
+#include <algorithm>
 #include <cmath>
+#include <random>
 // TODO integrate a unit testing framework
 
 
@@ -73,6 +75,134 @@ TEST_CASE("kd_tree can be built and searched", "[kd_tree]") {
   SECTION("find_within_iterative find the nodes within") {
     kd_tree_find_within_check(kd.find_within_iterative({ 3, 4 }, 4.0f));
   }
+  SECTION("the arena searches find the same nodes") {
+    frame_arena arena{ 64 };
+    kd_tree_find_closest_check(kd.find_closest_iterative({ 6, 1 }, arena));
+    arena_vector<kd_node_dist<char>> closests = kd.find_count_closest_iterative({ 6, 2 }, 3, arena);
+    kd_tree_find_closest_count_check({ closests.begin(), closests.end() });
+    arena_vector<kd_node_dist<char>> within = kd.find_within_iterative({ 3, 4 }, 4.0f, arena);
+    kd_tree_find_within_check({ within.begin(), within.end() });
+  }
+}
+
+TEST_CASE("kd_tree batched queries match single queries", "[kd_tree]") {
+  std::minstd_rand gen{ 11 };
+  std::uniform_real_distribution<float> coord{ 0.0f, 100.0f };
+  std::vector<kd_node<int>> points;
+  for (int n = 0; n < 500; n++) {
+    points.push_back({ { coord(gen), coord(gen) }, n });
+  }
+  kd_tree<int> kd{ std::move(points) };
+
+  std::vector<vector_2f> queries;
+  for (int q = 0; q < 300; q++) {
+    queries.push_back({ coord(gen), coord(gen) });
+  }
+
+  worker_pool pool{ 3 };
+  worker_pool* pools[] = { nullptr, &pool };
+  for (worker_pool* p : pools) {
+    std::vector<kd_node<int>*> closest(queries.size());
+    kd.find_closest_batch(queries.data(), queries.size(), closest.data(), p);
+
+    size_t const count = 4;
+    std::vector<kd_node_dist<int>> closests(queries.size() * count);
+    kd.find_count_closest_batch(queries.data(), queries.size(), count, closests.data(), p);
+
+    std::vector<std::vector<kd_node_dist<int>>> within;
+    kd.find_within_batch(queries.data(), queries.size(), 6.0f, within, p);
+    REQUIRE(within.size() == queries.size());
+
+    for (size_t q = 0; q < queries.size(); q++) {
+      REQUIRE(closest[q] == kd.find_closest_iterative(queries[q]));
+
+      std::vector<kd_node_dist<int>> expected_closests = kd.find_count_closest_iterative(queries[q], count);
+      for (size_t i = 0; i < count; i++) {
+        REQUIRE(closests[q * count + i].dist == expected_closests[i].dist);
+      }
+
+      std::vector<kd_node_dist<int>> expected_within = kd.find_within_iterative(queries[q], 6.0f);
+      REQUIRE(within[q].size() == expected_within.size());
+      for (size_t i = 0; i < expected_within.size(); i++) {
+        REQUIRE(within[q][i].dist == expected_within[i].dist);
+      }
+    }
+
+    // a smaller count reuses the scratch heaps of the larger one but still only writes count results per query
+    size_t const fewer = 2;
+    std::vector<kd_node_dist<int>> fewer_closests(queries.size() * fewer + 1);
+    fewer_closests.back().dist = -1.0f;
+    kd.find_count_closest_batch(queries.data(), queries.size(), fewer, fewer_closests.data(), p);
+    REQUIRE(fewer_closests.back().dist == -1.0f);
+    for (size_t q = 0; q < queries.size(); q++) {
+      for (size_t i = 0; i < fewer; i++) {
+        REQUIRE(fewer_closests[q * fewer + i].dist == closests[q * count + i].dist);
+      }
+    }
+  }
+}
+
+TEST_CASE("kd_tree parallel builds match the serial build", "[kd_tree]") {
+  // distinct coordinates on both axes so the layout is fully determined
+  size_t const count = 20000;
+  std::vector<int> xs(count);
+  std::vector<int> ys(count);
+  for (size_t i = 0; i < count; i++) {
+    xs[i] = static_cast<int>(i);
+    ys[i] = static_cast<int>(i);
+  }
+  std::minstd_rand gen{ 5 };
+  std::shuffle(xs.begin(), xs.end(), gen);
+  std::shuffle(ys.begin(), ys.end(), gen);
+  std::vector<kd_node<int>> points;
+  for (size_t i = 0; i < count; i++) {
+    points.push_back({ { static_cast<float>(xs[i]), static_cast<float>(ys[i]) }, static_cast<int>(i) });
+  }
+
+  kd_tree<int> serial;
+  serial.build_iterative(points);
+
+  worker_pool pool{ 4 };
+  auto require_same_layout = [&serial](kd_tree<int> const& other) {
+    std::vector<kd_node<int>> const& expected = serial.get_nodes();
+    std::vector<kd_node<int>> const& actual = other.get_nodes();
+    REQUIRE(actual.size() == expected.size());
+    bool same = true;
+    for (size_t i = 0; i < expected.size(); i++) {
+      same = same && (actual[i].value == expected[i].value);
+    }
+    REQUIRE(same);
+  };
+
+  SECTION("build_parallel matches build_iterative") {
+    kd_tree<int> kd;
+    kd.build_parallel(points, pool);
+    require_same_layout(kd);
+  }
+  SECTION("build_presorted without a pool matches build_iterative") {
+    kd_tree<int> kd;
+    kd.build_presorted(points);
+    require_same_layout(kd);
+  }
+  SECTION("build_presorted with a pool matches build_iterative") {
+    kd_tree<int> kd;
+    kd.build_presorted(points, &pool);
+    require_same_layout(kd);
+  }
+  SECTION("the small tree is searched the same after a parallel build") {
+    kd_tree<char> kd;
+    kd.build_parallel({
+      { { 2, 3 }, 'a' },
+      { { 5, 4 }, 'b' },
+      { { 9, 6 }, 'c' },
+      { { 4, 7 }, 'd' },
+      { { 8, 1 }, 'e' },
+      { { 7, 2 }, 'f' },
+    }, pool);
+    kd_tree_find_closest_check(kd.find_closest_iterative({ 6, 1 }));
+    kd_tree_find_closest_count_check(kd.find_count_closest_iterative({ 6, 2 }, 3));
+    kd_tree_find_within_check(kd.find_within_iterative({ 3, 4 }, 4.0f));
+  }
 }
 
 /*inline void test_kd_tree() {
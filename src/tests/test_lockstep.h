@@ -0,0 +1,109 @@
+#pragma once
+#include "../lockstep.h"
+#include "../hash.h"
+#include <catch.hpp>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+  // A deterministic stand in for the world, particles drifting about and pushed by commands.
+  struct drifting_particles {
+    std::minstd_rand gen{ 11 };
+    std::vector<float> positions = std::vector<float>(256, 0.0f);
+
+    void apply(std::vector<unsigned char> const& commands) {
+      for (size_t at = 0; at + sizeof(uint32_t) <= commands.size(); at += sizeof(uint32_t)) {
+        uint32_t pushed;
+        std::memcpy(&pushed, commands.data() + at, sizeof(pushed));
+        positions[pushed % positions.size()] += 1.0f;
+      }
+    }
+
+    void step() {
+      for (float& p : positions) {
+        p += static_cast<float>(gen() % 1000) / 1000.0f - 0.5f;
+      }
+    }
+
+    uint64_t state_hash() const {
+      fnv1a_hasher hasher;
+      hasher.add_value(gen);
+      hasher.add_bytes(positions.data(), positions.size() * sizeof(float));
+      return hasher.value();
+    }
+  };
+
+  // Runs peer_count peers on their own threads, peer fault_peer nudging its state after stepping fault_tick.
+  std::vector<uint64_t> run_session(uint32_t peer_count, uint64_t tick_count, uint32_t fault_peer, uint64_t fault_tick) {
+    lockstep_network network{ peer_count };
+    std::vector<uint64_t> desync_ticks(peer_count);
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < peer_count; p++) {
+      threads.emplace_back([&, p]() {
+        lockstep_peer peer{ network, p, 2 };
+        drifting_particles sim;
+        std::minstd_rand local_input{ p + 100 }; // what only this peer knows
+        for (uint64_t tick = 0; tick < tick_count; tick++) {
+          uint32_t pushed = static_cast<uint32_t>(local_input());
+          std::vector<unsigned char> commands(sizeof(pushed));
+          std::memcpy(commands.data(), &pushed, sizeof(pushed));
+          for (std::vector<unsigned char> const& c : peer.exchange(std::move(commands))) {
+            sim.apply(c);
+          }
+          sim.step();
+          if ((p == fault_peer) && (tick == fault_tick)) {
+            sim.positions[17] += 0.001f;
+          }
+          peer.finish_tick(sim.state_hash());
+        }
+        peer.leave();
+        peer.wait_for_peers();
+        desync_ticks[p] = peer.desync_tick();
+      });
+    }
+    for (std::thread& t : threads) {
+      t.join();
+    }
+    return desync_ticks;
+  }
+}
+
+TEST_CASE("Tests lockstep_peer", "[lockstep]") {
+  SECTION("peers stay in step") {
+    std::vector<uint64_t> desync_ticks = run_session(3, 300, 3, 0);
+    REQUIRE(desync_ticks == std::vector<uint64_t>(3, lockstep_no_tick));
+  }
+
+  SECTION("a desync is caught on its tick") {
+    std::vector<uint64_t> desync_ticks = run_session(3, 300, 1, 123);
+    REQUIRE(desync_ticks == std::vector<uint64_t>(3, 123));
+  }
+
+  SECTION("a desync on the last tick is caught") {
+    std::vector<uint64_t> desync_ticks = run_session(2, 50, 0, 49);
+    REQUIRE(desync_ticks == std::vector<uint64_t>(2, 49));
+  }
+
+  SECTION("peers stepped in turn on one thread") {
+    lockstep_network network{ 2 };
+    lockstep_peer first{ network, 0, 1 };
+    lockstep_peer second{ network, 1, 1 };
+    std::vector<std::vector<unsigned char>> seen;
+    for (uint64_t tick = 0; tick < 10; tick++) {
+      seen = first.exchange({ static_cast<unsigned char>(tick) });
+      first.finish_tick(tick);
+      REQUIRE(second.exchange({ static_cast<unsigned char>(tick + 100) }) == seen);
+      second.finish_tick(tick);
+    }
+    // commands arrive input_delay ticks after they are sent
+    REQUIRE(seen == std::vector<std::vector<unsigned char>>{ { 8 }, { 108 } });
+    first.leave();
+    second.leave();
+    first.wait_for_peers();
+    second.wait_for_peers();
+    REQUIRE(!first.desynced());
+    REQUIRE(!second.desynced());
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "../mapped_file.h"
+#include "../csv.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <string>
+
+TEST_CASE("Tests mapped_file", "[mapped_file]") {
+  char const* filename = "test_mapped_file.csv";
+
+  SECTION("missing file") {
+    std::remove(filename);
+    mapped_file file{ filename };
+    REQUIRE(!file.valid());
+    REQUIRE(file.error_message().find("could not open") == 0);
+    REQUIRE(file.error_message().size() > std::string("could not open").size()); // has the reason
+  }
+
+  SECTION("empty file") {
+    FILE* out = fopen(filename, "wb");
+    REQUIRE(out != nullptr);
+    fclose(out);
+    {
+      mapped_file file{ filename };
+      REQUIRE(file.valid());
+      REQUIRE(file.size() == 0);
+      REQUIRE(file.view().empty());
+      REQUIRE(file.error_message().empty());
+    }
+    std::remove(filename);
+  }
+
+  SECTION("contents, moving and parse_csv") {
+    FILE* out = fopen(filename, "wb");
+    REQUIRE(out != nullptr);
+    fputs("a,b\n1,2\n", out);
+    fclose(out);
+    {
+      mapped_file file{ filename };
+      REQUIRE(file.valid());
+      REQUIRE(file.view() == "a,b\n1,2\n");
+
+      mapped_file moved{ std::move(file) };
+      REQUIRE(!file.valid());
+      REQUIRE(moved.valid());
+
+      csv parsed = parse_csv(std::move(moved));
+      REQUIRE(parsed.rows() == 1);
+      REQUIRE(parsed.cols() == 2);
+      REQUIRE(parsed.header[1] == "b");
+      REQUIRE(parsed.get_cell_int(0, 1) == 2);
+    }
+    std::remove(filename);
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "../slab_pool.h"
+#include <catch.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct slab_pool_test_base {
+  virtual ~slab_pool_test_base() {} // this is a base class
+};
+
+struct slab_pool_test_pooled : public slab_pool_test_base, public pooled<slab_pool_test_pooled> {
+  double values[5];
+};
+
+struct slab_pool_test_derived : public slab_pool_test_pooled {
+  double more_values[8];
+};
+
+TEST_CASE("Tests slab_pool", "[slab_pool]") {
+  slab_pool<double, 4> pool;
+
+  SECTION("allocations are distinct and aligned") {
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 10; i++) {
+      ptrs.push_back(pool.allocate());
+      REQUIRE(reinterpret_cast<uintptr_t>(ptrs.back()) % alignof(double) == 0);
+    }
+    REQUIRE(pool.size() == 10);
+    REQUIRE(pool.capacity() == 12);
+    std::sort(ptrs.begin(), ptrs.end());
+    REQUIRE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+  }
+
+  SECTION("slots in a slab are contiguous") {
+    char* first = static_cast<char*>(pool.allocate());
+    char* second = static_cast<char*>(pool.allocate());
+    REQUIRE(second - first == sizeof(double));
+  }
+
+  SECTION("freed slots are reused before the pool grows") {
+    void* a = pool.allocate();
+    void* b = pool.allocate();
+    pool.deallocate(a);
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.allocate() == a);
+    pool.deallocate(b);
+    REQUIRE(pool.allocate() == b);
+    REQUIRE(pool.capacity() == 4);
+  }
+}
+
+TEST_CASE("Tests pooled", "[slab_pool]") {
+  slab_pool<slab_pool_test_pooled>& pool = pooled<slab_pool_test_pooled>::pool();
+  size_t live = pool.size();
+
+  SECTION("new and delete through a base pointer use the pool") {
+    std::unique_ptr<slab_pool_test_base> ptr{ new slab_pool_test_pooled() };
+    REQUIRE(pool.size() == live + 1);
+    ptr.reset();
+    REQUIRE(pool.size() == live);
+  }
+
+  SECTION("bigger derived classes use the heap") {
+    std::unique_ptr<slab_pool_test_base> ptr{ new slab_pool_test_derived() };
+    REQUIRE(pool.size() == live);
+    ptr.reset();
+    REQUIRE(pool.size() == live);
+  }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "../small_vector.h"
+#include <catch.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+TEST_CASE("Tests small_vector", "[small_vector]") {
+  small_vector<int, 4> s;
+  REQUIRE(s.capacity() == 4);
+  REQUIRE(s.is_inline());
+  s.emplace_back(1);
+  s.emplace_back(2);
+  s.emplace_back(4);
+
+  SECTION("basic") {
+    REQUIRE(s.size() == 3);
+    REQUIRE(s[0] == 1);
+    REQUIRE(s[1] == 2);
+    REQUIRE(s[2] == 4);
+    REQUIRE(s.front() == 1);
+    REQUIRE(s.back() == 4);
+    REQUIRE(s.is_inline());
+  }
+
+  SECTION("spills to the heap past N") {
+    s.push_back(8);
+    REQUIRE(s.is_inline());
+    s.push_back(16);
+    REQUIRE(!s.is_inline());
+    REQUIRE(s.capacity() >= 5);
+    REQUIRE(std::vector<int>(s.begin(), s.end()) == std::vector<int>{ 1, 2, 4, 8, 16 });
+
+    for (int i = 0; i < 100; i++) {
+      s.push_back(i);
+    }
+    REQUIRE(s.size() == 105);
+    REQUIRE(s[104] == 99);
+  }
+
+  SECTION("clear keeps the heap storage") {
+    for (int i = 0; i < 10; i++) {
+      s.push_back(i);
+    }
+    size_t spilled_capacity = s.capacity();
+    int* spilled_data = s.data();
+    s.clear();
+    REQUIRE(s.empty());
+    for (int i = 0; i < 10; i++) {
+      s.push_back(i);
+    }
+    REQUIRE(s.capacity() == spilled_capacity);
+    REQUIRE(s.data() == spilled_data);
+  }
+
+  SECTION("pushing an element of itself while spilling") {
+    s.push_back(8);
+    s.push_back(s[0]);
+    REQUIRE(s.size() == 5);
+    REQUIRE(s[4] == 1);
+  }
+
+  SECTION("erase") {
+    int* it = s.erase(s.cbegin());
+    REQUIRE((*it) == 2);
+    REQUIRE(s.size() == 2);
+
+    s.push_back(5);
+    s.push_back(6);
+    s.push_back(7);
+    it = s.erase(s.cbegin() + 1, s.cbegin() + 3);
+    REQUIRE((*it) == 6);
+    REQUIRE(std::vector<int>(s.begin(), s.end()) == std::vector<int>{ 2, 6, 7 });
+
+    s.pop_back();
+    REQUIRE(s.size() == 2);
+  }
+
+  SECTION("copy and move while inline") {
+    small_vector<int, 4> copy = s;
+    REQUIRE(copy.is_inline());
+    REQUIRE(std::vector<int>(copy.begin(), copy.end()) == std::vector<int>{ 1, 2, 4 });
+
+    small_vector<int, 4> moved = std::move(copy);
+    REQUIRE(moved.size() == 3);
+    REQUIRE(copy.empty());
+    REQUIRE(moved[2] == 4);
+  }
+
+  SECTION("copy and move after spilling") {
+    for (int i = 0; i < 10; i++) {
+      s.push_back(i);
+    }
+    small_vector<int, 4> copy = s;
+    REQUIRE(copy.size() == 13);
+    REQUIRE(copy.data() != s.data());
+
+    int* spilled_data = copy.data();
+    small_vector<int, 4> moved;
+    moved.push_back(-1);
+    moved = std::move(copy);
+    REQUIRE(moved.data() == spilled_data);
+    REQUIRE(moved.size() == 13);
+    REQUIRE(copy.empty());
+    REQUIRE(copy.is_inline());
+
+    copy = moved;
+    REQUIRE(std::vector<int>(copy.begin(), copy.end()) == std::vector<int>(moved.begin(), moved.end()));
+  }
+
+  SECTION("non trivial elements") {
+    small_vector<std::unique_ptr<std::string>, 2> strings;
+    for (int i = 0; i < 5; i++) {
+      strings.emplace_back(new std::string(std::to_string(i)));
+    }
+    strings.erase(strings.cbegin() + 1);
+    REQUIRE(strings.size() == 4);
+    REQUIRE(*strings[0] == "0");
+    REQUIRE(*strings[1] == "2");
+
+    small_vector<std::unique_ptr<std::string>, 2> moved = std::move(strings);
+    REQUIRE(*moved.back() == "4");
+  }
+}
@@ -5,7 +5,8 @@
 #include <algorithm>
 
 TEST_CASE("space_buckets can be built and searched", "[space_buckets]") {
-  space_buckets<int, 10, 10> buckets{ {{0, 0}, {1000, 1000}} };
+  using int_buckets = space_buckets<int, 10, 10>;
+  int_buckets buckets{ {{0, 0}, {1000, 1000}} };
   buckets.add_entry({ 0, 0 }, 0);
   buckets.add_entry({ 10, 10 }, 1);
   buckets.add_entry({ 50, 110 }, 2);
@@ -15,22 +16,22 @@ TEST_CASE("space_buckets can be built and searched", "[space_buckets]") {
   vector_2f second_loc{ 800.0f, 900.0f };
 
   SECTION("find_local_bucket finds the values in the local bucket") {
-    std::vector<int>* bucket = buckets.find_bucket(search_loc);
+    int_buckets::bucket_ptr bucket = buckets.find_bucket(search_loc);
     REQUIRE(bucket != nullptr);
-    std::vector<int>& bucket_ref = *bucket;
+    int_buckets::bucket& bucket_ref = *bucket;
     REQUIRE(bucket_ref.size() == 2);
     REQUIRE(bucket_ref[0] == 0);
     REQUIRE(bucket_ref[1] == 1);
 
-    std::vector<int>* before_bucket = buckets.find_bucket(second_loc);
+    int_buckets::bucket_ptr before_bucket = buckets.find_bucket(second_loc);
     REQUIRE(before_bucket != nullptr);
-    std::vector<int>& before_ref = *before_bucket;
+    int_buckets::bucket& before_ref = *before_bucket;
     REQUIRE(before_ref.size() == 1);
     REQUIRE(before_ref[0] == 3);
   }
 
   SECTION("find_nearby_buckets finds the values in the nearby buckets") {
-    sized_vector<std::vector<int>*, 9> found = buckets.find_adj_buckets(search_loc);
+    sized_vector<int_buckets::bucket_ptr, 9> found = buckets.find_adj_buckets(search_loc);
     REQUIRE(std::distance(found.begin(), found.end()) == 2);
 
     std::vector<int> found_vec;
@@ -48,14 +49,14 @@ TEST_CASE("space_buckets can be built and searched", "[space_buckets]") {
   SECTION("move_entry properly moves an entry") {
     buckets.move_entry({ 0, 0 }, { 820, 910 }, 0);
 
-    std::vector<int>* after_bucket = buckets.find_bucket(second_loc);
+    int_buckets::bucket_ptr after_bucket = buckets.find_bucket(second_loc);
     REQUIRE(after_bucket != nullptr);
-    std::vector<int>& after_ref = *after_bucket;
+    int_buckets::bucket& after_ref = *after_bucket;
     REQUIRE(after_ref.size() == 2);
     REQUIRE(after_ref[0] == 3);
     REQUIRE(after_ref[1] == 0);
 
-    sized_vector<std::vector<int>*, 9> found = buckets.find_adj_buckets(search_loc);
+    sized_vector<int_buckets::bucket_ptr, 9> found = buckets.find_adj_buckets(search_loc);
     REQUIRE(std::distance(found.begin(), found.end()) == 2);
 
     std::vector<int> found_vec;
@@ -68,4 +69,24 @@ TEST_CASE("space_buckets can be built and searched", "[space_buckets]") {
     REQUIRE(found_vec[0] == 1);
     REQUIRE(found_vec[1] == 2);
   }
-}
\ No newline at end of file
+
+  SECTION("a bucket spills past its inline entries") {
+    for (int i = 0; i < 20; i++) {
+      buckets.add_entry({ 820, 910 }, 100 + i);
+    }
+    int_buckets::bucket& spilled = *buckets.find_bucket(second_loc);
+    REQUIRE(!spilled.is_inline());
+    REQUIRE(spilled.size() == 21);
+    REQUIRE(spilled[0] == 3);
+    REQUIRE(spilled[20] == 119);
+
+    buckets.remove_entry(second_loc, 110);
+    REQUIRE(spilled.size() == 20);
+    REQUIRE(buckets.location_contains(second_loc, 119));
+    REQUIRE(!buckets.location_contains(second_loc, 110));
+
+    buckets.clear();
+    REQUIRE(spilled.empty());
+    REQUIRE(buckets.find_bucket(search_loc)->empty());
+  }
+}
@@ -1,5 +1,6 @@
 #include "../sparse_container.h"
 #include <catch.hpp>
+#include <memory>
 
 
 void profile_sparse_container() {
@@ -154,6 +155,86 @@ TEST_CASE("Tests sparse_container", "[sparse_container]") {
     }
   }
 
+  SECTION("iteration skips empty chunks") {
+    sparse_container<int, 200> con;
+    for (int i = 0; i < 200; i++) {
+      con.push(i);
+    }
+    for (auto it = con.begin(); it != con.end(); ++it) {
+      if ((*it != 3) && (*it != 64) && (*it != 65) && (*it != 199)) {
+        con.erase(it);
+      }
+    }
+    std::vector<int> copy_vector;
+    std::copy(con.begin(), con.end(), std::back_inserter(copy_vector));
+    REQUIRE(copy_vector == std::vector<int>{ 3, 64, 65, 199 });
+
+    con.erase(std::find(con.begin(), con.end(), 199));
+    copy_vector.clear();
+    std::copy(con.cbegin(), con.cend(), std::back_inserter(copy_vector));
+    REQUIRE(copy_vector == std::vector<int>{ 3, 64, 65 });
+  }
+
+  SECTION("for_each_occupied and erase_if") {
+    sparse_container<int, 100> con;
+    for (int i = 0; i < 100; i++) {
+      con.push(i);
+    }
+
+    size_t erased = con.erase_if([](int value) {
+      return (value % 3) != 0;
+    });
+    REQUIRE(erased == 66);
+    REQUIRE(con.size() == 34);
+
+    std::vector<int> visited;
+    con.for_each_occupied([&visited](int& value) {
+      visited.push_back(value);
+    });
+    REQUIRE(visited.size() == 34);
+    for (size_t i = 0; i < visited.size(); i++) {
+      REQUIRE(visited[i] == static_cast<int>(i * 3));
+    }
+
+    sparse_container<int, 100> const& const_con = con;
+    int sum = 0;
+    const_con.for_each_occupied([&sum](int const& value) {
+      sum += value;
+    });
+    REQUIRE(sum == 3 * (33 * 34) / 2);
+
+    // pushes fill the erased slots again
+    con.push(-1);
+    REQUIRE(*(con.begin() + 1) == -1);
+  }
+
+  SECTION("large capacity uses the summary index") {
+    auto con = std::make_unique<sparse_container<int, 10000>>();
+    for (int i = 0; i < 10000; i++) {
+      con->push(i);
+    }
+    REQUIRE(con->size() == 10000);
+
+    // free a few scattered slots and check pushes land in them in order
+    con->erase_if([](int value) {
+      return (value == 17) || (value == 5000) || (value == 9999);
+    });
+    REQUIRE(con->size() == 9997);
+    int* pushed = &(con->push(-1));
+    REQUIRE(pushed == &(*(con->begin() + 17)));
+    REQUIRE(*pushed == -1);
+    con->push(-2);
+    con->push(-3);
+    REQUIRE(con->size() == 10000);
+
+    con->erase_if([](int value) {
+      return (value != 4242) && (value != -3);
+    });
+    std::vector<int> copy_vector;
+    std::copy(con->begin(), con->end(), std::back_inserter(copy_vector));
+    REQUIRE(copy_vector == std::vector<int>{ 4242, -3 });
+  }
+
   /*SECTION("profile") {
     profile_sparse_container();
   }*/
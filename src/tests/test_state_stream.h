@@ -0,0 +1,159 @@
+#pragma once
+#include "../state_stream.h"
+#include <catch.hpp>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+  state_frame quantized_sorted(std::vector<streamed_unit> const& units) {
+    state_frame frame;
+    for (streamed_unit const& u : units) {
+      frame.push_back(quantized_unit::from(u));
+    }
+    std::sort(frame.begin(), frame.end(), [](quantized_unit const& left, quantized_unit const& right) {
+      return left.id < right.id;
+    });
+    return frame;
+  }
+
+  // Units wandering about, dying and being replaced in their slot by new ones.
+  struct wandering_units {
+    std::minstd_rand gen{ 7 };
+    std::vector<streamed_unit> units;
+
+    explicit wandering_units(uint32_t count) {
+      for (uint32_t i = 0; i < count; i++) {
+        units.push_back({ i, 0, i % 2, i % 3, rand_coord(), rand_coord(), 0.0f, 10, true });
+      }
+    }
+
+    float rand_coord() {
+      return static_cast<float>(gen() % 1280) - 640.0f;
+    }
+
+    void step() {
+      for (streamed_unit& u : units) {
+        if (!u.living) {
+          u = { u.id, u.generation + 1, u.archetype, u.team, rand_coord(), rand_coord(), 0.0f, 10, true };
+          continue;
+        }
+        if (gen() % 4 != 0) { // most units march, jostled a little, and a few turn
+          u.x += 0.5f * (static_cast<int>(u.id % 5) - 2) + static_cast<float>(gen() % 20) / 10.0f - 1.0f;
+          u.y += 0.5f * (static_cast<int>(u.id % 3) - 1) + static_cast<float>(gen() % 20) / 10.0f - 1.0f;
+        }
+        if (gen() % 4 == 0) {
+          u.angle += static_cast<float>(gen() % 100) / 1000.0f - 0.05f;
+        }
+        if (gen() % 50 == 0) {
+          u.health -= 3;
+          u.living = (u.health > 0);
+        }
+      }
+    }
+  };
+}
+
+TEST_CASE("Tests state_stream", "[state_stream]") {
+  SECTION("bit packing") {
+    std::vector<unsigned char> bytes;
+    state_bit_writer writer{ bytes };
+    writer.write(5, 3);
+    writer.write_varbits(300);
+    writer.write_zigzag(-70000);
+    writer.write(1, 1);
+    writer.write(0xffffffff, 32);
+    writer.flush();
+
+    state_bit_reader reader{ bytes.data(), bytes.data() + bytes.size() };
+    uint32_t value;
+    int32_t signed_value;
+    REQUIRE((reader.read(3, value) && (value == 5)));
+    REQUIRE((reader.read_varbits(value) && (value == 300)));
+    REQUIRE((reader.read_zigzag(signed_value) && (signed_value == -70000)));
+    REQUIRE((reader.read(1, value) && (value == 1)));
+    REQUIRE((reader.read(32, value) && (value == 0xffffffff)));
+    REQUIRE(!reader.read(8, value));
+  }
+
+  SECTION("quantization") {
+    streamed_unit u{ 3, 1, 0, 0, 100.03f, -7.5f, -0.5f, 300, true };
+    streamed_unit back = quantized_unit::from(u).dequantized();
+    REQUIRE(back.x == Approx(100.03f).margin(state_stream_position_step / 2));
+    REQUIRE(back.y == -7.5f);
+    REQUIRE(back.angle == Approx(math_consts::tau() - 0.5f).margin(0.001f));
+    REQUIRE(back.health == 255);
+  }
+
+  SECTION("a lossy channel with late acks") {
+    wandering_units world{ 2000 };
+    state_stream_encoder encoder;
+    state_stream_decoder decoder;
+    std::deque<std::pair<uint64_t, uint32_t>> acks_in_flight; // tick the ack arrives and the sequence acked
+    size_t full_bytes = 0;
+    size_t delta_bytes = 0;
+    int decoded = 0;
+    bool all_match = true;
+
+    for (uint64_t tick = 0; tick < 200; tick++) {
+      while (!acks_in_flight.empty() && (acks_in_flight.front().first <= tick)) {
+        encoder.acknowledge(acks_in_flight.front().second);
+        acks_in_flight.pop_front();
+      }
+      world.step();
+      std::vector<unsigned char> packet;
+      encoder.encode(tick, world.units, packet);
+      if (tick == 0) {
+        full_bytes = packet.size();
+      } else {
+        delta_bytes += packet.size();
+      }
+      if (tick % 7 == 3) {
+        continue; // lost
+      }
+      REQUIRE(decoder.decode(packet.data(), packet.size()));
+      decoded++;
+      all_match = all_match && (decoder.latest_tick() == tick) && (decoder.latest_frame() == quantized_sorted(world.units));
+      acks_in_flight.push_back({ tick + 3, decoder.latest_sequence() });
+    }
+    REQUIRE(all_match);
+    REQUIRE(decoded > 150);
+    // a delta is well under half of sending every unit, and a fraction of their trans_state and health
+    REQUIRE(delta_bytes / 199 < full_bytes / 2);
+    REQUIRE(delta_bytes / 199 < 2000 * 24 / 5);
+    REQUIRE(decoder.latest_units().size() == 2000);
+  }
+
+  SECTION("nothing changed") {
+    wandering_units world{ 500 };
+    state_stream_encoder encoder;
+    state_stream_decoder decoder;
+    std::vector<unsigned char> packet;
+    uint32_t first = encoder.encode(0, world.units, packet);
+    REQUIRE(decoder.decode(packet.data(), packet.size()));
+    encoder.acknowledge(first);
+    packet.clear();
+    encoder.encode(1, world.units, packet);
+    REQUIRE(packet.size() == sizeof(state_packet_header) + 2);
+    REQUIRE(decoder.decode(packet.data(), packet.size()));
+    REQUIRE(decoder.latest_frame() == quantized_sorted(world.units));
+  }
+
+  SECTION("bad packets") {
+    wandering_units world{ 100 };
+    state_stream_encoder encoder;
+    std::vector<unsigned char> full;
+    uint32_t first = encoder.encode(0, world.units, full);
+    encoder.acknowledge(first);
+    world.step();
+    std::vector<unsigned char> delta;
+    encoder.encode(1, world.units, delta);
+
+    state_stream_decoder decoder;
+    REQUIRE(!decoder.decode(delta.data(), delta.size())); // its base was never received
+    REQUIRE(!decoder.decode(full.data(), full.size() - 1));
+    REQUIRE(decoder.empty());
+    REQUIRE(decoder.decode(full.data(), full.size()));
+    REQUIRE(decoder.decode(delta.data(), delta.size()));
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../summary_bitset.h"
+#include <catch.hpp>
+#include <bitset>
+#include <random>
+
+template<size_t N>
+inline size_t summary_bitset_expected_first(std::bitset<N> const& expected, size_t start, bool value) {
+  for (size_t i = start; i < N; i++) {
+    if (expected[i] == value) {
+      return i;
+    }
+  }
+  return fast_bitset_utils::npos();
+}
+
+TEST_CASE("Tests summary_bitset", "[summary_bitset]") {
+  SECTION("empty and full") {
+    summary_bitset<10000> bits;
+    REQUIRE(bits.none());
+    REQUIRE(bits.first_true() == fast_bitset_utils::npos());
+    REQUIRE(bits.first_false() == 0);
+    REQUIRE(bits.first_non_empty_chunk(0) == bits.chunk_count());
+
+    bits.set();
+    REQUIRE(bits.count() == 10000);
+    REQUIRE(bits.first_false() == fast_bitset_utils::npos());
+    REQUIRE(bits.first_true() == 0);
+
+    bits.reset(9999);
+    REQUIRE(bits.first_false() == 9999);
+    REQUIRE(bits.first_false(5000) == 9999);
+    bits.reset(4097);
+    REQUIRE(bits.first_false() == 4097);
+    REQUIRE(bits.first_false(4098) == 9999);
+    bits.set(4097);
+    bits.set(9999);
+    REQUIRE(bits.first_false() == fast_bitset_utils::npos());
+  }
+
+  SECTION("matches std::bitset under random changes") {
+    size_t constexpr size = 9000;
+    summary_bitset<size> bits;
+    std::bitset<size> expected;
+    std::minstd_rand gen{ 9 };
+    for (int step = 0; step < 20000; step++) {
+      size_t pos = gen() % size;
+      bool value = (gen() % 4) != 0; // mostly full so free slots are rare
+      bits.set(pos, value);
+      expected.set(pos, value);
+
+      if (step % 97 == 0) {
+        size_t start = gen() % size;
+        REQUIRE(bits.count() == expected.count());
+        REQUIRE(bits.test(pos) == value);
+        REQUIRE(bits.first_true() == summary_bitset_expected_first(expected, 0, true));
+        REQUIRE(bits.first_false() == summary_bitset_expected_first(expected, 0, false));
+        REQUIRE(bits.first_true(start) == summary_bitset_expected_first(expected, start, true));
+        REQUIRE(bits.first_false(start) == summary_bitset_expected_first(expected, start, false));
+      }
+    }
+  }
+}
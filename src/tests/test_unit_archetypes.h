@@ -0,0 +1,37 @@
+#pragma once
+#include "../units/archetypes.h"
+#include "../potential_field.h"
+#include <catch.hpp>
+
+TEST_CASE("Tests unit_pair_kernel", "[unit_archetypes]") {
+  SECTION("ids index all_unit_archetypes") {
+    for (size_t i = 0; i < all_unit_archetypes.size(); i++) {
+      REQUIRE(all_unit_archetypes[i]->id == i);
+    }
+  }
+
+  SECTION("matches the generic potential field gradients") {
+    vector_2f center{ 100.0f, -20.0f };
+    for (unit_archetype const* other : all_unit_archetypes) {
+      unit_pair_kernel const& kernel = unit_pair_kernels<heavy_archetype>[other->id];
+      float intersection_radius = heavy_archetype.potential_radius + other->potential_radius;
+      for (float dx = -80.0f; dx <= 80.0f; dx += 7.0f) {
+        for (float dy = -80.0f; dy <= 80.0f; dy += 11.0f) {
+          vector_2f pos = center + vector_2f{ dx, dy };
+          vector_2f expected = 0.8f * normalized_gaussian_gradient(center, pos, 0.5f * intersection_radius)
+            + 0.4f * normalized_fractional_obstacle_gradient(center, pos, intersection_radius);
+          vector_2f found = kernel.gradient(center, pos);
+          REQUIRE(found.x == Approx(expected.x).epsilon(0.001).margin(0.0001));
+          REQUIRE(found.y == Approx(expected.y).epsilon(0.001).margin(0.0001));
+        }
+      }
+    }
+  }
+
+  SECTION("on top of each other") {
+    vector_2f center{ 5.0f, 5.0f };
+    vector_2f found = unit_pair_kernels<grunt_archetype>[grunt_archetype.id].gradient(center, center);
+    REQUIRE(found.x == 0.0f);
+    REQUIRE(found.y == 0.0f);
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../worker_pool.h"
+#include <catch.hpp>
+#include <atomic>
+#include <vector>
+
+TEST_CASE("Tests worker_pool", "[worker_pool]") {
+  for (size_t pool_size : { 1, 2, 5 }) {
+    worker_pool pool{ pool_size };
+    REQUIRE(pool.size() == pool_size);
+
+    // run_on_all runs every worker once
+    std::vector<int> runs(pool_size, 0);
+    pool.run_on_all([&runs](size_t worker_idx) {
+      runs[worker_idx]++;
+    });
+    REQUIRE(runs == std::vector<int>(pool_size, 1));
+
+    // parallel_for covers the range once
+    std::vector<int> hits(1000, 0);
+    pool.parallel_for(hits.size(), [&hits](size_t, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        hits[i]++;
+      }
+    });
+    REQUIRE(hits == std::vector<int>(1000, 1));
+
+    // parallel_for_each runs every index once
+    for (size_t count : { 0, 1, 3, 257 }) {
+      std::vector<std::atomic<int>> index_hits(count);
+      pool.parallel_for_each(count, [&index_hits](size_t idx) {
+        index_hits[idx]++;
+      });
+      for (std::atomic<int> const& hit : index_hits) {
+        REQUIRE(hit.load() == 1);
+      }
+    }
+  }
+}
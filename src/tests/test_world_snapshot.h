@@ -0,0 +1,102 @@
+#pragma once
+#include "../world_snapshot.h"
+#include <catch.hpp>
+#include <cstdio>
+#include <vector>
+
+TEST_CASE("Tests world_snapshot", "[world_snapshot]") {
+  char const* filename = "test_world_snapshot.wmss";
+
+  world_snapshot_writer writer;
+  writer.frame_count = 1234;
+  writer.mouse_pos = { -5.0f, 7.5f };
+  writer.mouse_down = true;
+  writer.teams.push_back({ 0, 1 });
+  writer.teams.push_back({ 1, 1 });
+  std::vector<vector_2f> square{ { 1.0f, 1.0f }, { -1.0f, 1.0f }, { -1.0f, -1.0f }, { 1.0f, -1.0f } };
+  writer.legions.push_back({ { 10.0f, 20.0f }, writer.add_points(square), 4 });
+  writer.legions.push_back({ { -10.0f, 0.0f }, 0, 0 });
+  for (int i = 0; i < 1000; i++) {
+    snapshot_unit u{};
+    u.archetype = i % 2;
+    u.team = i % 2;
+    u.trans.x = static_cast<float>(i);
+    u.trans.y = -static_cast<float>(i);
+    u.old_pos = { u.trans.x, u.trans.y };
+    u.health = i;
+    writer.units.push_back(u);
+  }
+  snapshot_threat threat{};
+  threat.allegiance = -1;
+  threat.lifetime = 99;
+  threat.image.texture = 6;
+  threat.image.uv = { { 0.25f, 0.5f }, { 0.125f, 0.125f } };
+  writer.threats.push_back(threat);
+  snapshot_obstacle obstacle{};
+  obstacle.kind = snapshot_obstacle_kind::polygonal;
+  obstacle.first_point = writer.add_points(square);
+  obstacle.point_count = 4;
+  writer.obstacles.push_back(obstacle);
+  writer.rng_state = "48271";
+
+  REQUIRE(writer.write(filename));
+
+  SECTION("round trip") {
+    world_snapshot snapshot{ filename };
+    REQUIRE(snapshot.valid());
+    REQUIRE(snapshot.header().frame_count == 1234);
+    REQUIRE(snapshot.header().mouse_x == -5.0f);
+    REQUIRE(snapshot.header().mouse_down == 1);
+    REQUIRE(snapshot.teams().size() == 2);
+    REQUIRE(snapshot.teams()[1].first_legion == 1);
+    REQUIRE(snapshot.legions().size() == 2);
+    REQUIRE(snapshot.legions()[0].order_pos.y == 20.0f);
+    REQUIRE(snapshot.units().size() == 1000);
+    REQUIRE(snapshot.units()[999].trans.x == 999.0f);
+    REQUIRE(snapshot.units()[999].old_pos.y == -999.0f);
+    REQUIRE(snapshot.units()[999].health == 999);
+    REQUIRE(snapshot.threats().size() == 1);
+    REQUIRE(snapshot.threats()[0].lifetime == 99);
+    REQUIRE(snapshot.threats()[0].image.uv.origin.y == 0.5f);
+    REQUIRE(snapshot.obstacles().size() == 1);
+    REQUIRE(snapshot.points().size() == 8);
+    REQUIRE(snapshot.rng_state() == "48271");
+
+    vector_2f const* verts = snapshot.point_range(snapshot.obstacles()[0].first_point, 4);
+    REQUIRE(verts != nullptr);
+    REQUIRE(verts[1].x == -1.0f);
+    REQUIRE(snapshot.point_range(6, 2) != nullptr);
+    REQUIRE(snapshot.point_range(6, 3) == nullptr);
+    REQUIRE(snapshot.point_range(9, 0) == nullptr);
+
+    // sections are used in place in the mapping
+    REQUIRE(reinterpret_cast<uintptr_t>(snapshot.units().records) % alignof(snapshot_unit) == 0);
+  }
+
+  SECTION("truncated file is invalid") {
+    FILE* in = fopen(filename, "rb");
+    REQUIRE(in != nullptr);
+    std::vector<unsigned char> bytes(1 << 16);
+    size_t size = fread(bytes.data(), 1, bytes.size(), in);
+    fclose(in);
+    FILE* out = fopen(filename, "wb");
+    REQUIRE(out != nullptr);
+    fwrite(bytes.data(), 1, size - 1, out);
+    fclose(out);
+
+    world_snapshot snapshot{ filename };
+    REQUIRE(!snapshot.valid());
+  }
+
+  SECTION("other files are invalid") {
+    FILE* out = fopen(filename, "r+b");
+    REQUIRE(out != nullptr);
+    fwrite("WMIR", 1, 4, out);
+    fclose(out);
+
+    world_snapshot snapshot{ filename };
+    REQUIRE(!snapshot.valid());
+  }
+
+  std::remove(filename);
+}
@@ -2,11 +2,30 @@
 #include <catch.hpp>
 
 #include "test_kd_tree.h"
+#include "test_flat_kd_tree.h"
 #include "test_space_buckets.h"
+#include "test_bucketed_parent.h"
 #include "test_geom.h"
+#include "test_unit_archetypes.h"
 #include "test_sized_vector.h"
+#include "test_small_vector.h"
 #include "test_fast_bitset.h"
+#include "test_summary_bitset.h"
 #include "test_sparse_container.h"
+#include "test_chunked_sparse_container.h"
+#include "test_handle_table.h"
+#include "test_frame_arena.h"
+#include "test_slab_pool.h"
+#include "test_worker_pool.h"
+#include "test_asset_pack.h"
+#include "test_hash.h"
+#include "test_columnar_csv.h"
+#include "test_mapped_file.h"
+#include "test_atlas_layout.h"
+#include "test_input_recording.h"
+#include "test_world_snapshot.h"
+#include "test_state_stream.h"
+#include "test_lockstep.h"
 
 unsigned int Factorial( unsigned int number ) {
     return number <= 1 ? 1 : Factorial(number-1)*number;
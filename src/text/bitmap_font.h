@@ -3,11 +3,13 @@
 #include "../csv.h"
 #include "../2d_math.h"
 #include "../texture.h"
+#include "../texture_atlas.h"
+#include "font_metrics.h"
 
 #include <vector>
 #include <unordered_map>
 #include <cassert>
-#include <charconv>
+#include <algorithm>
 
 
 class prop_bitmap_font {
@@ -18,39 +20,29 @@ private:
   int row_len; // characters per row
   vector_2f char_tex_size_;
 public:
-  texture tex;
-
-  prop_bitmap_font(texture t, csv info) : tex(std::move(t)) {
-    assert(info.cols() == 2);
-    std::unordered_map<std::string_view, int> info_pairs;
-    for (std::vector<std::string_view> const& row : info.values) {
-
-      int value;
-      std::string_view value_string = row[1];
-      std::from_chars(value_string.data(), value_string.data() + value_string.size(), value);
-      info_pairs[row[0]] = value;
-    }
-    char_height_ = info_pairs["Cell Height"];
-    char_max_width_ = info_pairs["Cell Width"];
-
-    row_len = tex.width() / char_max_width_;
-
-    char_tex_size_.x = static_cast<float>(char_max_width_) / tex.width();
-    char_tex_size_.y = static_cast<float>(char_height_) / tex.height();
-
-    std::array<char, 20> base_width_name_buffer;
-    for (int i = ' '; i <= '~'; i++) {
-      size_t len = snprintf(base_width_name_buffer.data(), base_width_name_buffer.size(),
-        "Char %d Base Width", i);
-      int char_width = info_pairs[{base_width_name_buffer.data(), len}];
-      char_widths[i - ' '] = char_width;
-    }
+  atlas_region page; // the font's bitmap, usually packed into the static atlas
+
+  prop_bitmap_font(atlas_region const& p, prop_font_metrics const& metrics) : page(p) {
+    char_height_ = metrics.char_height;
+    char_max_width_ = metrics.char_max_width;
+    std::copy(metrics.char_widths.cbegin(), metrics.char_widths.cend(), char_widths.begin());
+
+    row_len = page.pixel_size.x / char_max_width_;
+
+    char_tex_size_.x = static_cast<float>(char_max_width_) / page.tex_size.x;
+    char_tex_size_.y = static_cast<float>(char_height_) / page.tex_size.y;
   }
 
+  prop_bitmap_font(atlas_region const& p, csv const& info) : prop_bitmap_font(p, prop_font_metrics::from_csv(info)) {}
+
+  // Reads the metrics straight out of a mapped font csv, which must be valid.
+  prop_bitmap_font(atlas_region const& p, mapped_file info_file) :
+    prop_bitmap_font(p, prop_font_metrics::from_csv(columnar_csv{ std::move(info_file), false })) {}
+
   vector_2f top_left_tex(char c) const {
     assert(contains_char(c));
     int idx = c - ' ';
-    return vector_2f{ (idx % row_len) * char_tex_size_.x, (idx / row_len) * char_tex_size_.y };
+    return page.uv.origin + vector_2f{ (idx % row_len) * char_tex_size_.x, (idx / row_len) * char_tex_size_.y };
   }
 
   bool contains_char(char c) const {
@@ -79,20 +71,20 @@ public:
 
 class mono_bitmap_font {
 public:
-  texture tex;
+  atlas_region const page; // the font's bitmap, usually packed into the static atlas
   int const char_width;
   int const char_height;
   int const row_length; // characters per row
   vector_2f const char_tex_size; // size of character in texture coordinates
 
-  mono_bitmap_font(texture t, int c_w, int c_h) :
-    tex(std::move(t)),
+  mono_bitmap_font(atlas_region const& p, int c_w, int c_h) :
+    page(p),
     char_width(c_w),
     char_height(c_h),
-    row_length(tex.width() / char_width),
+    row_length(page.pixel_size.x / char_width),
     char_tex_size(
-      static_cast<float>(char_width) / tex.width(),
-      static_cast<float>(char_height) / tex.height()) {}
+      static_cast<float>(char_width) / page.tex_size.x,
+      static_cast<float>(char_height) / page.tex_size.y) {}
 
   bool contains_char(char c) const {
     return ((c >= ' ') && (c <= '~'));
@@ -101,6 +93,6 @@ public:
   vector_2f top_left_tex(char c) const {
     assert(contains_char(c));
     int idx = c - ' ';
-    return vector_2f{ (idx % row_length) * char_tex_size.x, (idx / row_length) * char_tex_size.y };
+    return page.uv.origin + vector_2f{ (idx % row_length) * char_tex_size.x, (idx / row_length) * char_tex_size.y };
   }
 };
@@ -3,6 +3,7 @@
 #include "../gl_includes.h"
 #include "../renderable.h"
 #include "../color.h"
+#include "../frame_arena.h"
 #include "bitmap_font.h"
 
 #include <vector>
@@ -13,10 +14,13 @@ private:
   program* text_shader;
   GLint trans_mat_idx;
   GLint color_idx;
+  frame_arena* arena; // vertex buffers are built here each render
 
 public:
-  void init(program* t_shader) {
+  void init(program* t_shader, frame_arena* a) {
+    assert(a != nullptr);
     text_shader = t_shader;
+    arena = a;
     trans_mat_idx = text_shader->get_uniform_location("trans_mat");
     color_idx = text_shader->get_uniform_location("color");
   }
@@ -32,8 +36,13 @@ public:
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
   }
 
+  frame_arena& get_arena() {
+    return *arena;
+  }
+
+  template<typename buffer_type>
   static void create_char_triangles(
-    std::vector<textured_vertex>& buffer,
+    buffer_type& buffer,
     vector_2f const& top_left_vert, vector_2f const& bottom_right_vert,
     vector_2f const& top_left_tex, vector_2f const& bottom_right_tex) {
 
@@ -59,7 +68,7 @@ public:
   }
 
   void render_text_buffer(
-      vertex_buffer& vb, vertex_array& va, std::vector<textured_vertex> const& buffer,
+      vertex_buffer& vb, vertex_array& va, arena_vector<textured_vertex> const& buffer,
       texture& tex, matrix_3f const& parent_trans, matrix_3f const& local_trans,
       color_rgba const& text_color) {
     vb.bind();
@@ -93,9 +102,7 @@ public:
   void render(matrix_3f const& parent_trans) {
     assert(font != nullptr);
 
-    //TODO consider allocating these as part of the class
-    // they they wouldn't don't need to be reallocated each render
-    std::vector<textured_vertex> buffer;
+    arena_vector<textured_vertex> buffer{ context->get_arena() };
     buffer.reserve(text.size() * 6);
 
     vector_2f origin{ 0, 0 };
@@ -117,7 +124,7 @@ public:
       origin.x += font->char_width;
     }
 
-    context->render_text_buffer(vb, va, buffer, font->tex, parent_trans, local_trans, text_color);
+    context->render_text_buffer(vb, va, buffer, *(font->page.tex), parent_trans, local_trans, text_color);
   }
 };
 
@@ -138,9 +145,7 @@ public:
   void render(matrix_3f const& parent_trans) {
     assert(font != nullptr);
 
-    //TODO consider allocating these as part of the class
-    // they they wouldn't don't need to be reallocated each render
-    std::vector<textured_vertex> buffer;
+    arena_vector<textured_vertex> buffer{ context->get_arena() };
     buffer.reserve(text.size() * 6);
 
     vector_2f origin{ 0, 0 };
@@ -155,13 +160,13 @@ public:
       vector_2f bottom_right_vert{ top_left_vert.x + char_width, top_left_vert.y - font->char_height() };
 
       vector_2f top_left_tex = font->top_left_tex(c);
-      vector_2f bottom_right_tex{ top_left_tex.x + static_cast<float>(char_width) / font->tex.width(), top_left_tex.y + font->char_tex_size().y };
+      vector_2f bottom_right_tex{ top_left_tex.x + static_cast<float>(char_width) / font->page.tex_size.x, top_left_tex.y + font->char_tex_size().y };
 
       bitmap_text_context::create_char_triangles(buffer, top_left_vert, bottom_right_vert, top_left_tex, bottom_right_tex);
 
       // move origin for next character
       origin.x += char_width;
     }
-    context->render_text_buffer(vb, va, buffer, font->tex, parent_trans, local_trans, text_color);
+    context->render_text_buffer(vb, va, buffer, *(font->page.tex), parent_trans, local_trans, text_color);
   }
 };
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../csv.h"
+#include "../columnar_csv.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <unordered_map>
+#include <charconv>
+
+// The sizes a prop_bitmap_font needs, parsed out of the csv its bitmap font generator writes.
+// Plain data so it can be stored in an asset_pack as is.
+struct prop_font_metrics {
+  static constexpr int first_char = ' ';
+  static constexpr int last_char = '~';
+
+  int32_t char_height;
+  int32_t char_max_width;
+  std::array<int32_t, last_char - first_char + 1> char_widths;
+
+  /*
+  Reads the metrics from the name, value rows of a font csv.
+  O(n)
+  */
+  static prop_font_metrics from_csv(csv const& info) {
+    assert(info.cols() == 2);
+    std::unordered_map<std::string_view, int> info_pairs;
+    for (std::vector<std::string_view> const& row : info.values) {
+      int value = 0;
+      std::string_view value_string = row[1];
+      std::from_chars(value_string.data(), value_string.data() + value_string.size(), value);
+      info_pairs[row[0]] = value;
+    }
+
+    prop_font_metrics metrics;
+    metrics.char_height = info_pairs["Cell Height"];
+    metrics.char_max_width = info_pairs["Cell Width"];
+
+    std::array<char, 20> base_width_name_buffer;
+    for (int i = first_char; i <= last_char; i++) {
+      size_t len = snprintf(base_width_name_buffer.data(), base_width_name_buffer.size(),
+        "Char %d Base Width", i);
+      metrics.char_widths[i - first_char] = info_pairs[{base_width_name_buffer.data(), len}];
+    }
+    return metrics;
+  }
+
+  /*
+  Reads the metrics from the name, value rows of a font csv parsed without a header.
+  Matches the names directly instead of building a map, widths of characters outside the range are ignored.
+  O(n)
+  */
+  static prop_font_metrics from_csv(columnar_csv const& info) {
+    assert(info.cols() == 2);
+    prop_font_metrics metrics{};
+    constexpr std::string_view char_prefix = "Char ";
+    constexpr std::string_view base_width_suffix = " Base Width";
+    for (size_t row = 0; row < info.rows(); row++) {
+      std::string_view name = info.cell(row, 0);
+      std::string_view value_string = info.cell(row, 1);
+      int value = 0;
+      std::from_chars(value_string.data(), value_string.data() + value_string.size(), value);
+
+      if (name == "Cell Height") {
+        metrics.char_height = value;
+      } else if (name == "Cell Width") {
+        metrics.char_max_width = value;
+      } else if ((name.size() > char_prefix.size() + base_width_suffix.size()) &&
+                 (name.substr(0, char_prefix.size()) == char_prefix) &&
+                 (name.substr(name.size() - base_width_suffix.size()) == base_width_suffix)) {
+        std::string_view char_string = name.substr(char_prefix.size(), name.size() - char_prefix.size() - base_width_suffix.size());
+        int char_idx = 0;
+        std::from_chars_result result = std::from_chars(char_string.data(), char_string.data() + char_string.size(), char_idx);
+        if ((result.ptr == char_string.data() + char_string.size()) && (char_idx >= first_char) && (char_idx <= last_char)) {
+          metrics.char_widths[char_idx - first_char] = value;
+        }
+      }
+    }
+    return metrics;
+  }
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "gl_includes.h"
 #include <stb/stb_image.h>
+#include <cstdlib>
 
 class texture {
 private:
@@ -9,21 +11,12 @@ private:
   int height_;
   unsigned char* data_;
 
-public:
-
-  texture(const char* filename) {
+  void upload(unsigned char const* rgba) {
     glGenTextures(1, &tex_);
     glBindTexture(GL_TEXTURE_2D, tex_);
-    
+
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    
-    int channel_count;
-    data_ = stbi_load(filename, &width_, &height_, &channel_count, 4);
-    if (!data_) {
-      fprintf(stderr, "Could not read file %s\n", filename);
-      exit(-1);
-    }
 
     glTexImage2D(GL_TEXTURE_2D,
       0,
@@ -33,7 +26,7 @@ public:
       0,
       GL_RGBA,
       GL_UNSIGNED_BYTE,
-      data_);
+      rgba);
 
     //glGenerateMipmap(GL_TEXTURE_2D);
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
@@ -44,7 +37,26 @@ public:
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+
+public:
+
+  texture(const char* filename) {
+    int channel_count;
+    data_ = stbi_load(filename, &width_, &height_, &channel_count, 4);
+    if (!data_) {
+      fprintf(stderr, "Could not read file %s\n", filename);
+      exit(-1);
+    }
+    upload(data_);
+  }
 
+  /*
+  Uploads already decoded RGBA pixels, for example straight out of a mapped asset_pack.
+  The texture does not keep the pixels so data() returns null, whoever needs to read them back keeps them.
+  */
+  texture(int width, int height, unsigned char const* rgba) : width_(width), height_(height), data_(nullptr) {
+    upload(rgba);
   }
 
   // do not copy or assign
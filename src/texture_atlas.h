@@ -0,0 +1,95 @@
+#pragma once
+
+#include "gl_includes.h"
+#include "texture.h"
+#include "atlas_layout.h"
+
+#include <cassert>
+#include <vector>
+
+// A part of a texture that sprites and fonts draw from, either an image packed into a texture_atlas
+// or a whole texture of its own.
+struct atlas_region {
+  texture* tex = nullptr;
+  unsigned char const* pixels = nullptr; // the RGBA of all of tex if it was kept on the CPU, otherwise null
+  vector_2i tex_size{ 0, 0 };
+  vector_2i pixel_origin{ 0, 0 }; // top left pixel in tex
+  vector_2i pixel_size{ 0, 0 };
+  uv_rect uv;
+
+  static atlas_region whole(texture& t) {
+    atlas_region region;
+    region.tex = &t;
+    region.pixels = t.data();
+    region.tex_size = { t.width(), t.height() };
+    region.pixel_size = region.tex_size;
+    return region;
+  }
+};
+
+// texture_atlas packs many images into a few large textures, so everything drawn from it
+// can share one texture bind. The composed pages are kept on the CPU for effects that read pixels.
+class texture_atlas {
+public:
+  struct source {
+    int width;
+    int height;
+    unsigned char const* rgba; // tightly packed, only read during construction
+  };
+
+private:
+  std::vector<std::vector<unsigned char>> page_pixels;
+  std::vector<texture> pages;
+  std::vector<atlas_region> regions;
+
+public:
+  /*
+  Packs and uploads the sources, GL thread only. Region i is sources[i].
+  O(pixels)
+  */
+  texture_atlas(std::vector<source> const& sources, int max_page_size) {
+    std::vector<vector_2i> sizes;
+    std::vector<unsigned char const*> images;
+    sizes.reserve(sources.size());
+    images.reserve(sources.size());
+    for (source const& s : sources) {
+      sizes.push_back({ s.width, s.height });
+      images.push_back(s.rgba);
+    }
+
+    atlas_layout layout = layout_atlas(sizes, max_page_size);
+    page_pixels = compose_atlas_pages(layout, sizes, images);
+    pages.reserve(page_pixels.size()); // regions point at the pages
+    for (size_t page = 0; page < page_pixels.size(); page++) {
+      pages.emplace_back(layout.page_sizes[page].x, layout.page_sizes[page].y, page_pixels[page].data());
+    }
+
+    regions.reserve(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+      atlas_layout::placement const& place = layout.placements[i];
+      vector_2i page_size = layout.page_sizes[place.page];
+      atlas_region region;
+      region.tex = &(pages[place.page]);
+      region.pixels = page_pixels[place.page].data();
+      region.tex_size = page_size;
+      region.pixel_origin = place.origin;
+      region.pixel_size = sizes[i];
+      region.uv.origin = { static_cast<float>(place.origin.x) / page_size.x, static_cast<float>(place.origin.y) / page_size.y };
+      region.uv.size = { static_cast<float>(sizes[i].x) / page_size.x, static_cast<float>(sizes[i].y) / page_size.y };
+      regions.push_back(region);
+    }
+  }
+
+  // do not copy or assign, regions point into the atlas
+  texture_atlas(texture_atlas&) = delete;
+  texture_atlas& operator=(const texture_atlas&) = delete;
+
+  atlas_region const& region(size_t idx) const {
+    assert(idx < regions.size());
+    return regions[idx];
+  }
+
+  size_t page_count() const {
+    return pages.size();
+  }
+};
@@ -2,7 +2,7 @@
 #include "threat_face.h"
 #include "obstacle.h"
 
-threat_parent::threat_parent(world& w) : world_ref(w), buckets(w.space_bounds) {}
+threat_parent::threat_parent(world& w) : bucketed_parent(w.space_bounds), world_ref(w) {}
 
 void point_threat::hurt(unit& target) {
   if (destroyed) {
@@ -31,7 +31,7 @@ bool point_threat::update(world& world_ref) {
     vector_2f center = trans.get_position();
     matrix_3f parent_trans = trans.to_matrix();
 
-    auto ex = explosion_effect::explode_sprite(&(world_ref.pp_ctx), image, center, parent_trans, world_ref.get_generator(), 20);
+    auto ex = explosion_effect::explode_sprite(&(world_ref.pp_ctx), world_ref.arena, image, center, parent_trans, world_ref.get_generator(), 20);
     world_ref.add_explosion(std::move(ex));
   }
   return destroyed;
@@ -6,9 +6,15 @@
 #include "gl_includes.h"
 #include "unit_face.h"
 #include "team_face.h"
-#include "space_buckets.h"
+#include "bucketed_parent.h"
 #include "explosion_effect.h"
 #include "world_face.h"
+#include "slab_pool.h"
+
+// The concrete type of a threat, so a threat can be saved without RTTI.
+enum class threat_kind {
+  point
+};
 
 class threat {
 public:
@@ -23,6 +29,12 @@ public:
   virtual bool update(world& world_ref) = 0;
   virtual void render(matrix_3f const& parent_trans) = 0;
   virtual void hurt(unit& target) = 0;
+  virtual threat_kind kind() const = 0;
+
+  /*
+  Moves the threat into a newly allocated threat of the same type and returns it.
+  */
+  virtual threat* relocate() = 0;
   virtual ~threat() {} // this is a base clase
 };
 
@@ -30,10 +42,8 @@ public:
 
 //using threat_parent = renderable_parent<threat, true>;
 
-class threat_parent : public renderable_parent<threat, true> {
+class threat_parent : public bucketed_parent<threat> {
 private:
-  using parent_type = renderable_parent<threat, true>;
-  space_buckets<threat*, 20, 20> buckets;
   world& world_ref;
 public:
 
@@ -44,11 +54,12 @@ public:
     for (int i = child_count() - 1; i >= 0; i--) {
       threat& ob = child_at(i);
       if (ob.update(world_ref)) {
-        remove_child_at(i);
+        mark_child_for_removal(i);
       } else {
         buckets.add_entry(ob.trans.get_position(), &ob);
       }
     }
+    remove_marked_children();
     /*for (int i = child_count() - 1; i >= 0; i--) {
       threat& ob = child_at(i);
       buckets.remove_entry(ob.trans.get_position(), &ob);
@@ -61,13 +72,14 @@ public:
     return false;
   }
 
-  sized_vector<std::vector<threat*>*, 9> get_nearby_threats(vector_2f location) {
-    return buckets.find_adj_buckets(location);
+  sized_vector<child_buckets::bucket_ptr, 9> get_nearby_threats(vector_2f location) {
+    return get_nearby(location);
   }
 };
 
 
-class point_threat : public threat {
+class point_threat final : public threat, public pooled<point_threat> {
+  friend class world; // saves and restores point_threats in snapshots
 protected:
   sprite image;
   bool destroyed = false;
@@ -86,8 +98,15 @@ public:
   }
 
   void hurt(unit& target) override;
+  threat_kind kind() const override {
+    return threat_kind::point;
+  }
   bool update(world& world_ref) override;
   void render(matrix_3f const& parent_trans) override;
 
-  virtual ~point_threat() {} // this is a base clase
+  threat* relocate() override {
+    return new point_threat(std::move(*this));
+  }
+
+  ~point_threat() {}
 };
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Builds an asset_pack out of an assets directory so the game can start without decoding anything.
+// Usage: PackBuilder [assets directory] [pack file]
+// Defaults to ./assets and ./assets/assets.pack, which is where static_resources looks for it.
+//
+// .png files are decoded to RGBA textures, csv files under fonts/ are parsed to prop_font_metrics,
+// shaders and other csv files are stored as text. Anything else is skipped.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "../asset_pack.h"
+#include "../columnar_csv.h"
+#include "../text/font_metrics.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static bool is_shader_extension(std::string const& extension) {
+  return (extension == ".vert") || (extension == ".frag") || (extension == ".geom") || (extension == ".comp");
+}
+
+static bool add_asset(asset_pack_writer& writer, fs::path const& file, std::string const& name) {
+  std::string extension = file.extension().string();
+  std::string file_string = file.string();
+
+  if (extension == ".png") {
+    int width, height, channel_count;
+    unsigned char* rgba = stbi_load(file_string.c_str(), &width, &height, &channel_count, 4);
+    if (!rgba) {
+      fprintf(stderr, "Could not decode %s\n", file_string.c_str());
+      return false;
+    }
+    bool added = writer.add_texture(name, static_cast<uint32_t>(width), static_cast<uint32_t>(height), rgba);
+    stbi_image_free(rgba);
+    printf("texture %s %dx%d\n", name.c_str(), width, height);
+    return added;
+  }
+
+  if ((extension == ".csv") && (name.rfind("fonts/", 0) == 0)) {
+    printf("font metrics %s\n", name.c_str());
+    mapped_file file{ file_string.c_str() };
+    if (!file.report(file_string.c_str())) {
+      return false;
+    }
+    columnar_csv info{ std::move(file), false };
+    if (!info.valid()) {
+      fprintf(stderr, "Could not parse %s\n", file_string.c_str());
+      return false;
+    }
+    return writer.add_prop_font_metrics(name, prop_font_metrics::from_csv(info));
+  }
+
+  if (is_shader_extension(extension) || (extension == ".csv")) {
+    printf("text %s\n", name.c_str());
+    mapped_file file{ file_string.c_str() };
+    if (!file.report(file_string.c_str())) {
+      return false;
+    }
+    return writer.add_text(name, file.view());
+  }
+
+  printf("skipped %s\n", name.c_str());
+  return true;
+}
+
+int main(int argc, char** argv) {
+  fs::path assets_dir = (argc > 1) ? argv[1] : "./assets";
+  fs::path pack_file = (argc > 2) ? argv[2] : "./assets/assets.pack";
+
+  std::error_code error;
+  std::vector<fs::path> files;
+  for (fs::recursive_directory_iterator it(assets_dir, error), end; !error && (it != end); it.increment(error)) {
+    if (it->is_regular_file() && (it->path().extension() != ".pack")) {
+      files.push_back(it->path());
+    }
+  }
+  if (error) {
+    fprintf(stderr, "Could not read directory %s\n", assets_dir.string().c_str());
+    return -1;
+  }
+
+  asset_pack_writer writer;
+  for (fs::path const& file : files) {
+    std::string name = file.lexically_relative(assets_dir).generic_string();
+    if (!add_asset(writer, file, name)) {
+      return -1;
+    }
+  }
+
+  if (!writer.write(pack_file.string().c_str())) {
+    return -1;
+  }
+  printf("wrote %s\n", pack_file.string().c_str());
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include "2d_math.h"
 #include "team_face.h"
 #include "unit_face.h"
+#include "units/archetypes.h"
 #include <limits>
 #include <cassert>
 #include "utils.h"
@@ -27,18 +28,38 @@ inline bool unit::take_point_threat(point_threat& pt) {
 
 inline unit::unit(world& w, team& t, legion* l, unit_archetype const& ty) :
     world_ref(w), team_ref(t), legion_ptr(l), type(ty) {
+  handle_slot = world_ref.unit_handles.acquire(this);
   legion_ptr->add_unit(this);
   current_health = type.max_health;
 }
 
+inline unit::unit(unit&& other) :
+    status(other.status), old_pos(other.old_pos), handle_slot(other.handle_slot), legion_idx(other.legion_idx),
+    world_ref(other.world_ref), team_ref(other.team_ref), type(other.type), legion_ptr(other.legion_ptr),
+    trans(other.trans), visible(other.visible), current_health(other.current_health), current_reload(other.current_reload) {
+  other.handle_slot = nullptr;
+  other.legion_ptr = nullptr;
+  if (handle_slot) {
+    unit_handle_table::retarget(handle_slot, this);
+  }
+  if (legion_ptr) {
+    legion_ptr->replace_unit(&other, this);
+  }
+}
+
 inline unit::~unit() {
   //fprintf(stderr, "Unit Destructor\n");
+  if (handle_slot) {
+    world_ref.unit_handles.release(handle_slot);
+  }
   if (legion_ptr) {
     legion_ptr->remove_unit(this);
   }
 }
 
+template<unit_archetype const& A>
 inline void unit::living_update() {
+  assert(&type == &A);
   vector_2f dest = legion_ptr->order.pos;
   vector_2f position = trans.get_position();
   vector_2f diff = dest - position;
@@ -57,20 +78,16 @@ inline void unit::living_update() {
         continue;
       }
       unit& close_unit = ref.ref();
-
-      float intersection_radius = close_unit.type.potential_radius + type.potential_radius;
-      vector_2f gauss_force = 0.8f * normalized_gaussian_gradient(close_unit.trans.get_position(), position, 0.5f * intersection_radius);
-      vector_2f obs_force = 0.4f * normalized_fractional_obstacle_gradient(close_unit.trans.get_position(), position, intersection_radius);
-      grad += gauss_force + obs_force;
+      grad += unit_pair_kernels<A>[close_unit.type.id].gradient(close_unit.trans.get_position(), position);
     }
   }
 
-  vector_2f obs_force = world_ref.obstacle_layer->get_exerted_gradient(position, type.potential_radius);
+  vector_2f obs_force = world_ref.obstacle_layer->get_exerted_gradient(position, A.potential_radius);
   grad += obs_force;
 
   float mag = grad.magnitude();
   if (mag != 0) {
-    vector_2f capped_gradient = (std::min(type.max_speed, mag) / mag) * grad;
+    vector_2f capped_gradient = (std::min(A.max_speed, mag) / mag) * grad;
     trans.set_position(trans.get_position() + capped_gradient);
   }
 
@@ -85,7 +102,7 @@ inline void unit::living_update() {
     vector_2f diff = trans.translation_to(closest_enemy.trans);
     float e_angle = angle_err(trans.angle, diff.angle());
     //float angle_diff += 0.1f * e_angle;
-    float angle_diff = absolute_value_clamp(type.max_turn_speed, e_angle);
+    float angle_diff = absolute_value_clamp(A.max_turn_speed, e_angle);
     trans.angle += angle_diff;
 
 
@@ -105,8 +122,8 @@ inline void unit::living_update() {
         bullet_sprite.mask_color = team_ref.col.with_alpha(0.3f);
         bullet_sprite.local_trans = matrix_3f::transformation_matrix(16, 16, trans.angle);
         point_threat* bullet = world_ref.threat_layer->add_orphan(new point_threat(bullet_sprite, 1, dir * 5.0f, 100, &team_ref));
-        bullet->trans.set_position(trans.get_position() + dir * type.potential_radius);
-        current_reload = type.max_reload;
+        bullet->trans.set_position(trans.get_position() + dir * A.potential_radius);
+        current_reload = A.max_reload;
 
         //}
       } 
@@ -115,15 +132,17 @@ inline void unit::living_update() {
   }
 }
 
-inline bool unit::update() {
+template<typename T>
+inline bool unit::update_as() {
   assert(legion_ptr != nullptr);
+  T& self = static_cast<T&>(*this);
   switch (status) {
   case LIVING:
     world_ref.unit_buckets.remove_entry(old_pos, ref());
-    living_update();
+    self.template living_update<T::get_archetype()>();
     take_threats();
     if (current_health <= 0) {
-      death_action();
+      self.death_action();
       visible = false;
       status = unit_status::KILLED;
     } else {
@@ -148,18 +167,16 @@ inline unit_reference unit::find_closest_enemy() {
 
   float closest_dist = std::numeric_limits<float>::max();
   for (team* enemy_side : team_ref.get_enemies()) {
-    int enemy_count = enemy_side->child_count();
-    for (int n = 0; n < enemy_count; n++) {
-      unit& enemy = enemy_side->child_at(n);
+    enemy_side->for_each_child([&](unit& enemy) {
       if (!enemy.is_living()) {
-        continue;
+        return;
       }
       float enemy_dist = enemy.trans.translation_to(trans).magnitude();
       if (enemy_dist < closest_dist) {
         closest_dist = enemy_dist;
         closest_enemy = unit_reference(enemy);
       }
-    }
+    });
   }
 
   return closest_enemy;
@@ -194,27 +211,29 @@ inline unit_reference unit::ref() {
 }
 
 inline void unit_reference::update() {
-  if (target != nullptr) {
-    if (!(target->is_living())) {
-      target = nullptr;
+  unit* current = target.get();
+  if (current != nullptr) {
+    if (!(current->is_living())) {
+      target = unit_handle_table::handle();
     }
   }
 }
 
 inline bool unit_reference::valid() {
   update();
-  return (target != nullptr);
+  return (target.get() != nullptr);
 }
 
 inline unit* unit_reference::ptr() {
   update();
-  return target;
+  return target.get();
 }
 
 inline unit& unit_reference::ref() {
   update();
-  assert(target != nullptr);
-  return *target;
+  unit* current = target.get();
+  assert(current != nullptr);
+  return *current;
 }
 
 inline bool unit_reference::operator==(unit_reference const & other) const {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "2d_math.h"
+#include "handle_table.h"
+#include <cstddef>
 
 class point_threat;
 class team;
@@ -8,6 +10,7 @@ class legion;
 class world;
 
 struct unit_archetype {
+  size_t const id;
   int const max_health;
   float const potential_radius;
   float const max_speed;
@@ -22,11 +25,21 @@ enum unit_status {
 };
 
 class unit_reference;
+class unit;
+
+using unit_handle_table = handle_table<unit>;
 
 class unit {
 private:
   unit_status status = unit_status::LIVING;
-  vector_2f old_pos;
+  vector_2f old_pos{ 0.0f, 0.0f }; // where the unit was added to world::unit_buckets
+
+  // The slot in world::unit_handles which unit_references resolve through.
+  unit_handle_table::slot* handle_slot;
+  size_t legion_idx = 0; // where the unit is in legion_ptr's units, kept by legion
+  friend class unit_reference;
+  friend class legion;
+  friend class world; // saves and restores status and old_pos in snapshots, streams units by handle slot
 
   void take_threats();
 public:
@@ -43,8 +56,8 @@ public:
   int current_reload = 0;
 
   unit(world& w, team& t, legion* l, unit_archetype const& ty);
+  unit(unit&& other); // takes over the handle slot and legion membership of other
   virtual ~unit(); // base class
-  bool update();
   bool is_living();
 
   virtual void render(matrix_3f const& parent_trans) = 0;
@@ -53,9 +66,19 @@ public:
   unit_reference ref();
 protected:
   /*
-  Updates the unit.
+  Updates the unit as its final type T so the calls into T are not virtual.
+  Return true if the unit should be deleted by its team.
+  T must be a friend of unit to reach T's protected overrides, subclasses define update() as update_as<T>().
+  */
+  template<typename T>
+  bool update_as();
+
+  /*
+  Steers and fires the living unit.
+  A is the unit's archetype, its stats and the forces between it and other archetypes are folded into constants.
   */
-  virtual void living_update();
+  template<unit_archetype const& A>
+  void living_update();
   virtual void death_action() {}
 
   // Find the closest enemy of all enemies
@@ -67,15 +90,16 @@ protected:
 
 /*
 A class to represent a reference to a unit that may be null, or now refer to a dead unit.
+The reference goes through the unit's handle slot so it stays valid when the unit is relocated.
 */
 class unit_reference {
 private:
-  unit* target;
+  unit_handle_table::handle target;
 
 public:
-  unit_reference() : target(nullptr) {}
-  unit_reference(unit& t) : target(&t) {}
-  unit_reference(unit* t) : target(t) {}
+  unit_reference() {}
+  unit_reference(unit& t) : target(t.handle_slot) {}
+  unit_reference(unit* t) : target((t == nullptr) ? nullptr : t->handle_slot) {}
 
   void update();
   bool valid();
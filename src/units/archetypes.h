@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include "../2d_math.h"
+#include "../unit_face.h"
+
+// The archetype of every kind of unit, constexpr so unit kernels can take them as template parameters
+// and fold their stats into constants. id is the archetype's index in all_unit_archetypes.
+
+inline constexpr unit_archetype grunt_archetype{
+  0, // id
+  10, // max_health
+  16.0f, // potential_radius
+  10.0f, // max_speed
+  0.05f, // max_turn_speed
+  10 // max_reload
+};
+
+inline constexpr unit_archetype heavy_archetype{
+  1, // id
+  80, // max_health
+  32.0f, // potential_radius
+  10.0f, // max_speed
+  0.025f, // max_turn_speed
+  5 // max_reload
+};
+
+inline constexpr std::array<unit_archetype const*, 2> all_unit_archetypes{
+  &grunt_archetype,
+  &heavy_archetype
+};
+
+/*
+The force one unit exerts on another, with everything that depends only on their two archetypes precomputed.
+It is 0.8 * normalized_gaussian_gradient(center, pos, 0.5 * radius)
+plus 0.4 * normalized_fractional_obstacle_gradient(center, pos, radius)
+where radius is the sum of their potential radii.
+*/
+class unit_pair_kernel {
+private:
+  float radius;
+  float inv_radius;
+  float gaussian_inv_4_variance; // the gaussian's standard deviation is half the radius
+  float obstacle_scale;
+
+  // The normalization cancels the gaussian's variance leaving e / 4.
+  static constexpr float gaussian_scale = 0.8f * math_consts::e() / 4.0f;
+
+public:
+  constexpr unit_pair_kernel(unit_archetype const& self, unit_archetype const& other) :
+    radius(self.potential_radius + other.potential_radius),
+    inv_radius(1.0f / (self.potential_radius + other.potential_radius)),
+    gaussian_inv_4_variance(1.0f / ((self.potential_radius + other.potential_radius) * (self.potential_radius + other.potential_radius))),
+    obstacle_scale(-0.8f * (self.potential_radius + other.potential_radius) * (self.potential_radius + other.potential_radius) * (self.potential_radius + other.potential_radius)) {
+  }
+
+  constexpr unit_pair_kernel() : radius(0), inv_radius(0), gaussian_inv_4_variance(0), obstacle_scale(0) {}
+
+  vector_2f gradient(vector_2f center, vector_2f pos) const {
+    vector_2f diff = pos - center;
+    float distance_squared = diff.magnitude_squared();
+    vector_2f grad = (gaussian_scale * std::exp(-distance_squared * gaussian_inv_4_variance)) * diff;
+
+    float distance = std::sqrt(distance_squared);
+    if ((distance != 0) && (distance <= radius)) {
+      grad += (obstacle_scale * (inv_radius - 1.0f / distance) / (distance_squared * distance)) * diff;
+    }
+    return grad;
+  }
+};
+
+/*
+The kernels between archetype A and every archetype, indexed by the other archetype's id.
+*/
+template<unit_archetype const& A>
+constexpr std::array<unit_pair_kernel, all_unit_archetypes.size()> make_unit_pair_kernels() {
+  std::array<unit_pair_kernel, all_unit_archetypes.size()> kernels{};
+  for (size_t i = 0; i < all_unit_archetypes.size(); i++) {
+    kernels[i] = unit_pair_kernel(A, *(all_unit_archetypes[i]));
+  }
+  return kernels;
+}
+
+template<unit_archetype const& A>
+inline constexpr std::array<unit_pair_kernel, all_unit_archetypes.size()> unit_pair_kernels = make_unit_pair_kernels<A>();
@@ -6,20 +6,16 @@
 #include "../unit_face.h"
 #include "../threat_face.h"
 #include "../potential_field.h"
+#include "../slab_pool.h"
+#include "archetypes.h"
 
 
-class grunt : public unit {
+class grunt final : public unit, public pooled<grunt> {
+  friend class unit; // unit::update_as calls the protected overrides directly
 public:
-  static unit_archetype const& get_archetype() {
-    static unit_archetype const archetype{
-      10, // max_health
-      16.0f, // potential_radius
-      10.0f, // max_speed
-      0.05f, // max_turn_speed
-      10 // max_reload
-    };
-    return archetype;
-  };
+  static constexpr unit_archetype const& get_archetype() {
+    return grunt_archetype;
+  }
 
 private:
   sprite ship;
@@ -36,11 +32,10 @@ public:
 
     ship = world_ref.static_sprite(static_texture_id::grunt);
     ship.local_trans = matrix_3f::transformation_matrix(32, 32);
-    ship.frames = { 2, 2 };
-    ship.current_frame = { 1, 0 };
+    ship.set_frame({ 2, 2 }, { 1, 0 });
 
     highlights = ship;
-    highlights.current_frame = { 0, 1 };
+    highlights.set_frame({ 2, 2 }, { 0, 1 });
     highlights.mask_color = team_ref.col.with_alpha(1.0f);
 
     poly.local_trans = matrix_3f::transformation_matrix(type.potential_radius, type.potential_radius);
@@ -48,11 +43,8 @@ public:
     poly.fill_color = color_rgba::transparent_black();
   }
 
-protected:
-  void death_action() override {
-    vector_2f center = trans.get_position();
-    matrix_3f parent_trans = trans.to_matrix();
-    world_ref.add_explosion(explosion_effect::explode_sprite(&(world_ref.pp_ctx), ship, center, parent_trans, world_ref.get_generator()));
+  bool update() {
+    return update_as<grunt>();
   }
 
   void render(matrix_3f const& parent_trans) override {
@@ -61,5 +53,12 @@ protected:
       inner_variadic_render(matrix, ship, highlights, poly);
     }
   }
+
+protected:
+  void death_action() override {
+    vector_2f center = trans.get_position();
+    matrix_3f parent_trans = trans.to_matrix();
+    world_ref.add_explosion(explosion_effect::explode_sprite(&(world_ref.pp_ctx), world_ref.arena, ship, center, parent_trans, world_ref.get_generator()));
+  }
 };
 
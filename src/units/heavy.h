@@ -6,20 +6,16 @@
 #include "../unit_face.h"
 #include "../threat_face.h"
 #include "../potential_field.h"
+#include "../slab_pool.h"
+#include "archetypes.h"
 
 
-class heavy : public unit {
+class heavy final : public unit, public pooled<heavy> {
+  friend class unit; // unit::update_as calls the protected overrides directly
 public:
-  static unit_archetype const& get_archetype() {
-    static unit_archetype const archetype{
-      80, // max_health
-      32.0f, // potential_radius
-      10.0f, // max_speed
-      0.025f, // max_turn_speed
-      5 // max_reload
-    };
-    return archetype;
-  };
+  static constexpr unit_archetype const& get_archetype() {
+    return heavy_archetype;
+  }
 
 private:
   sprite ship;
@@ -34,11 +30,10 @@ public:
       &(world_ref.static_res.get_vertex_array(static_vertex_array_id::dodecagon_border))) {
     ship = world_ref.static_sprite(static_texture_id::heavy);
     ship.local_trans = matrix_3f::transformation_matrix(64, 64);
-    ship.frames = { 2, 2 };
-    ship.current_frame = { 1, 0 };
+    ship.set_frame({ 2, 2 }, { 1, 0 });
 
     highlights = ship;
-    highlights.current_frame = { 0, 1 };
+    highlights.set_frame({ 2, 2 }, { 0, 1 });
     highlights.mask_color = team_ref.col.with_alpha(1.0f);
 
     poly.local_trans = matrix_3f::transformation_matrix(type.potential_radius, type.potential_radius);
@@ -46,11 +41,8 @@ public:
     poly.fill_color = color_rgba::transparent_black();
   }
 
-protected:
-  void death_action() override {
-    vector_2f center = trans.get_position();
-    matrix_3f parent_trans = trans.to_matrix();
-    world_ref.add_explosion(explosion_effect::explode_sprite(&(world_ref.pp_ctx), ship, center, parent_trans, world_ref.get_generator()));
+  bool update() {
+    return update_as<heavy>();
   }
 
   void render(matrix_3f const& parent_trans) override {
@@ -59,5 +51,12 @@ protected:
       inner_variadic_render(matrix, ship, highlights, poly);
     }
   }
+
+protected:
+  void death_action() override {
+    vector_2f center = trans.get_position();
+    matrix_3f parent_trans = trans.to_matrix();
+    world_ref.add_explosion(explosion_effect::explode_sprite(&(world_ref.pp_ctx), world_ref.arena, ship, center, parent_trans, world_ref.get_generator()));
+  }
 };
 
@@ -1,10 +1,9 @@
 #pragma once
 #include <cmath>
 
+#include <algorithm>
 #include <cstdio>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <memory>
 #include <random>
@@ -32,16 +31,19 @@ std::string string_format(std::string const& format, Args ... args) {
   return std::string(buf.get(), buf.get() + size - 1); // remove 0 suffix
 }
 
-inline std::string read_file_to_string(char const* filename) {
-  std::ifstream in_file(filename, std::ios::in | std::ios::binary);
-  if (in_file) {
-    std::ostringstream strStream;
-    strStream << in_file.rdbuf();
-    in_file.close();
-    return strStream.str();
+/*
+Formats into out reusing its capacity, so formatting the same kind of string every frame stops allocating
+once out has grown to fit.
+*/
+template<typename ... Args>
+void string_format_to(std::string& out, char const* format, Args ... args) {
+  int size = std::snprintf(nullptr, 0, format, args ...);
+  if (size < 0) {
+    out.clear();
+    return;
   }
-  fprintf(stderr, "Could not read file %s\n", filename);
-  exit(-1);
+  out.resize(static_cast<size_t>(size));
+  std::snprintf(&out[0], static_cast<size_t>(size) + 1, format, args ...); // writes the 0 suffix into the string's own terminator
 }
 
 template<typename T>
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// worker_pool is a fixed set of threads which repeatedly run the same job in parallel.
+// The calling thread always takes part as worker 0, so a pool of size 1 has no extra threads
+// and runs everything inline.
+// Jobs are passed as a function pointer and context pointer so dispatching a job never allocates.
+class worker_pool {
+private:
+  using job_func = void(*)(void* ctx, size_t worker_idx);
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+
+  job_func job = nullptr;
+  void* job_ctx = nullptr;
+  size_t generation = 0; // incremented for every job so workers can tell a new job from a spurious wake
+  size_t remaining = 0; // workers which have not finished the current job
+  bool stopping = false;
+
+  void worker_loop(size_t worker_idx) {
+    size_t seen_generation = 0;
+    while (true) {
+      job_func current_job;
+      void* current_ctx;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [this, seen_generation]() {
+          return stopping || (generation != seen_generation);
+        });
+        if (stopping) {
+          return;
+        }
+        seen_generation = generation;
+        current_job = job;
+        current_ctx = job_ctx;
+      }
+
+      current_job(current_ctx, worker_idx);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        remaining--;
+        if (remaining == 0) {
+          done_cv.notify_one();
+        }
+      }
+    }
+  }
+
+  template<typename F>
+  static void invoke_job(void* ctx, size_t worker_idx) {
+    (*static_cast<F*>(ctx))(worker_idx);
+  }
+
+public:
+  static size_t default_size() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  explicit worker_pool(size_t worker_count = default_size()) {
+    assert(worker_count > 0);
+    for (size_t i = 1; i < worker_count; i++) {
+      threads.emplace_back(&worker_pool::worker_loop, this, i);
+    }
+  }
+
+  ~worker_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    start_cv.notify_all();
+    for (std::thread& t : threads) {
+      t.join();
+    }
+  }
+
+  // do not copy, assign, or move
+  worker_pool(worker_pool&) = delete;
+  worker_pool& operator=(worker_pool const&) = delete;
+
+  // Number of workers including the calling thread.
+  size_t size() const {
+    return threads.size() + 1;
+  }
+
+  /*
+  Runs func(worker_idx) once on every worker and waits for all of them to finish.
+  The calling thread runs worker 0.
+  */
+  template<typename F>
+  void run_on_all(F&& func) {
+    if (threads.empty()) {
+      func(size_t{ 0 });
+      return;
+    }
+    using func_type = std::remove_reference_t<F>;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = &invoke_job<func_type>;
+      job_ctx = const_cast<void*>(static_cast<void const*>(&func));
+      remaining = threads.size();
+      generation++;
+    }
+    start_cv.notify_all();
+
+    func(size_t{ 0 });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]() {
+      return (remaining == 0);
+    });
+  }
+
+  /*
+  Splits [0, count) into one contiguous range per worker and runs func(worker_idx, begin, end) on each.
+  Workers whose range is empty are not called.
+  */
+  template<typename F>
+  void parallel_for(size_t count, F&& func) {
+    size_t workers = std::min(size(), std::max<size_t>(count, 1));
+    run_on_all([&func, count, workers](size_t worker_idx) {
+      if (worker_idx >= workers) {
+        return;
+      }
+      size_t begin = (count * worker_idx) / workers;
+      size_t end = (count * (worker_idx + 1)) / workers;
+      if (begin < end) {
+        func(worker_idx, begin, end);
+      }
+    });
+  }
+
+  /*
+  Runs func(idx) for every idx in [0, count), handing indices out one at a time as workers become free.
+  Suits a few jobs of very different sizes, where parallel_for's even split could leave workers idle.
+  */
+  template<typename F>
+  void parallel_for_each(size_t count, F&& func) {
+    std::atomic<size_t> next{ 0 };
+    run_on_all([&func, &next, count](size_t) {
+      for (size_t idx = next++; idx < count; idx = next++) {
+        func(idx);
+      }
+    });
+  }
+};
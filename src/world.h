@@ -8,9 +8,14 @@
 #include "units/heavy.h"
 #include "space_buckets.h"
 #include "utils.h"
+#include "world_snapshot.h"
+#include "state_stream.h"
 
-inline world::world(GLFWwindow* win, static_resources& sr, int_keyed_resources& dr) : stage(win, sr, dr) {
-  std::array<unsigned int, 4> seed = world::get_seed();
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+inline world::world(GLFWwindow* win, static_resources& sr, int_keyed_resources& dr, std::array<unsigned int, 4> s) : stage(win, sr, dr), seed(s) {
   printf("Seeded PRNG with %08x-%08x-%08x-%08x\n", seed[0], seed[1], seed[2], seed[3]);
   std::seed_seq seed_val{ seed[0], seed[1], seed[2], seed[3] };
   gen = generator_type(seed_val);
@@ -18,7 +23,7 @@ inline world::world(GLFWwindow* win, static_resources& sr, int_keyed_resources&
   s_ctx.init(&static_res.get_program(static_program_id::sprite), &static_res.get_vertex_array(static_vertex_array_id::sprite));
   p_ctx.init(&static_res.get_program(static_program_id::polygon_fill), &static_res.get_program(static_program_id::line));
   pp_ctx.init(&static_res.get_program(static_program_id::point_particle), &static_res.get_program(static_program_id::point_particle_comp));
-  bt_ctx.init(&static_res.get_program(static_program_id::bitmap_text));
+  bt_ctx.init(&static_res.get_program(static_program_id::bitmap_text), &arena);
 
   mouse_pos = { -width / 2.0f, height / 2.0f };
 
@@ -182,17 +187,23 @@ inline world::world(GLFWwindow* win, static_resources& sr, int_keyed_resources&
 
 inline bool world::update() { 
   update_times.begin();
+  arena.reset();
   
 
   float ang = frame_count / 100.0f;
-  enemy_first_legion->order.pos = vector_2f::create_polar(ang, 100);
+  if (scripted_orders) {
+    enemy_first_legion->order.pos = vector_2f::create_polar(ang, 100);
+    player_first_legion->order.pos = mouse_pos;
+  }
   enemy_first_legion_formation->local_trans = matrix_3f::translation_matrix(enemy_first_legion->order.pos.x, enemy_first_legion->order.pos.y);
-
-  player_first_legion->order.pos = mouse_pos;
-  player_first_legion_formation->local_trans = matrix_3f::translation_matrix(mouse_pos.x, mouse_pos.y);
+  player_first_legion_formation->local_trans = matrix_3f::translation_matrix(player_first_legion->order.pos.x, player_first_legion->order.pos.y);
 
   tri->local_trans = matrix_3f::transformation_matrix(100, 100, ang + math_consts::pi());
 
+  if ((frame_count % storage_sort_interval) == 0) {
+    sort_storage();
+  }
+
   stage::update(); //update children
 
   frm.count_frame();
@@ -200,7 +211,7 @@ inline bool world::update() {
   update_times.end();
 
 
-  frame_rate_text->text = string_format(
+  string_format_to(frame_rate_text->text,
     "FPS:%3.1f\n"
     "Update:%dms\n"
     "Other:%dms",
@@ -208,12 +219,26 @@ inline bool world::update() {
     static_cast<int>(std::round(update_times.average())),
     static_cast<int>(std::round(frm.average_frame_time() - update_times.average())));
 
-  log_text->text = string_format("%d", threat_layer->child_count());
+  string_format_to(log_text->text, "%d", threat_layer->child_count());
 
   return false;
 }
 
 
+/*
+Re-sorts unit and threat storage along a Morton curve of the buckets they are in,
+so iterating a bucket's neighbours reads memory that is close together.
+unit_buckets holds unit_references which follow units through the move.
+*/
+inline void world::sort_storage() {
+  for (int i = 0; i < teams_layer->child_count(); i++) {
+    teams_layer->child_at(i).reorder_children([this](unit& u) {
+      return unit_buckets.curve_key(u.trans.get_position());
+    });
+  }
+  threat_layer->sort_storage();
+}
+
 inline void world::key_callback(int key, int scancode, int action, int mods) {
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
     glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -262,11 +287,11 @@ inline std::array<unsigned int, 4> world::get_seed() {
 }
 
 inline sprite* world::static_sprite_orphan(static_texture_id id) {
-  return s_ctx.create_orphan(&(static_res.get_texture(id)));
+  return s_ctx.create_orphan(&(static_res.get_region(id)));
 }
 
 inline sprite world::static_sprite(static_texture_id id) {
-  return s_ctx.create(&(static_res.get_texture(id)));
+  return s_ctx.create(&(static_res.get_region(id)));
 }
 
 inline generator_type& world::get_generator() {
@@ -276,3 +301,310 @@ inline generator_type& world::get_generator() {
 inline void world::add_explosion(explosion_effect e) {
   explosion_layer->push(std::move(e));
 }
+
+
+inline int world::team_index(team const* t) {
+  for (int i = 0; i < teams_layer->child_count(); i++) {
+    if (&(teams_layer->child_at(i)) == t) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+inline bool world::save_sprite(sprite const& s, snapshot_sprite& saved) {
+  for (size_t id = 0; id < static_cast<size_t>(static_texture_id::COUNT); id++) {
+    if (&(static_res.get_region(static_cast<static_texture_id>(id))) == s.region) {
+      saved.texture = static_cast<uint32_t>(id);
+      saved.uv = s.uv;
+      saved.mask_color = s.mask_color.values;
+      saved.local_trans = s.local_trans.values;
+      return true;
+    }
+  }
+  fprintf(stderr, "Only sprites of static textures can be saved in snapshots\n");
+  return false;
+}
+
+inline sprite world::load_sprite(snapshot_sprite const& saved) {
+  sprite s = static_sprite(static_cast<static_texture_id>(saved.texture));
+  s.uv = saved.uv;
+  s.mask_color.values = saved.mask_color;
+  s.local_trans.values = saved.local_trans;
+  return s;
+}
+
+inline bool world::save_snapshot(char const* filename) {
+  world_snapshot_writer out;
+  out.frame_count = frame_count;
+  out.mouse_pos = mouse_pos;
+  out.mouse_down = mouse_down;
+
+  std::unordered_map<legion const*, uint32_t> legion_indices;
+  for (int t = 0; t < teams_layer->child_count(); t++) {
+    team& side = teams_layer->child_at(t);
+    out.teams.push_back({ static_cast<uint32_t>(out.legions.size()), static_cast<uint32_t>(side.legion_count()) });
+    for (size_t l = 0; l < side.legion_count(); l++) {
+      legion& saved_legion = side.legion_at(l);
+      legion_indices[&saved_legion] = static_cast<uint32_t>(l);
+      std::vector<vector_2f> const& formation = saved_legion.order.formation.verticies;
+      out.legions.push_back({ saved_legion.order.pos, out.add_points(formation), static_cast<uint32_t>(formation.size()) });
+    }
+  }
+
+  for (int t = 0; t < teams_layer->child_count(); t++) {
+    teams_layer->child_at(t).for_each_child([&](unit& u) {
+      assert(u.legion_ptr != nullptr);
+      snapshot_unit saved{};
+      saved.archetype = static_cast<uint32_t>(u.type.id);
+      saved.team = static_cast<uint32_t>(t);
+      saved.legion = legion_indices.at(u.legion_ptr);
+      saved.status = static_cast<uint32_t>(u.status);
+      saved.trans = u.trans;
+      saved.old_pos = u.old_pos;
+      saved.health = u.current_health;
+      saved.reload = u.current_reload;
+      out.units.push_back(saved);
+    });
+  }
+
+  for (int i = 0; i < threat_layer->child_count(); i++) {
+    threat& t = threat_layer->child_at(i);
+    assert(t.kind() == threat_kind::point);
+    point_threat& pt = static_cast<point_threat&>(t);
+    snapshot_threat saved{};
+    saved.kind = snapshot_threat_kind::point;
+    saved.allegiance = team_index(pt.allegiance);
+    saved.trans = pt.trans;
+    saved.velocity = pt.velocity;
+    saved.damage = pt.damage;
+    saved.lifetime = pt.lifetime;
+    saved.destroyed = pt.destroyed ? 1 : 0;
+    if (!save_sprite(pt.image, saved.image)) {
+      return false;
+    }
+    out.threats.push_back(saved);
+  }
+
+  for (int i = 0; i < obstacle_layer->child_count(); i++) {
+    obstacle& ob = obstacle_layer->child_at(i);
+    snapshot_obstacle saved{};
+    saved.trans = ob.trans;
+    bool saved_image;
+    if (ob.shape() == obstacle_shape::circular) {
+      circular_obstacle& circle = static_cast<circular_obstacle&>(ob);
+      saved.kind = snapshot_obstacle_kind::circular;
+      saved.radius = circle.radius;
+      saved_image = save_sprite(circle.image, saved.image);
+    } else {
+      polygonal_obstacle& poly = static_cast<polygonal_obstacle&>(ob);
+      saved.kind = snapshot_obstacle_kind::polygonal;
+      saved.first_point = out.add_points(poly.precalc.verticies);
+      saved.point_count = static_cast<uint32_t>(poly.precalc.verticies.size());
+      saved_image = save_sprite(poly.image, saved.image);
+    }
+    if (!saved_image) {
+      return false;
+    }
+    out.obstacles.push_back(saved);
+  }
+
+  std::ostringstream rng_text;
+  rng_text << gen;
+  out.rng_state = rng_text.str();
+
+  return out.write(filename);
+}
+
+/*
+Checks every index in the snapshot refers to something, so loading it can not fail half way.
+O(n)
+*/
+inline bool world::check_snapshot(world_snapshot const& snapshot) {
+  auto teams = snapshot.teams();
+  auto legions = snapshot.legions();
+  uint32_t texture_count = static_cast<uint32_t>(static_texture_id::COUNT);
+  if (teams.size() != static_cast<size_t>(teams_layer->child_count())) {
+    return false;
+  }
+  for (size_t t = 0; t < teams.size(); t++) {
+    snapshot_team const& saved = teams[t];
+    if ((saved.first_legion > legions.size()) || (saved.legion_count > legions.size() - saved.first_legion) ||
+        (saved.legion_count < teams_layer->child_at(static_cast<int>(t)).legion_count())) {
+      return false;
+    }
+  }
+  for (snapshot_legion const& saved : legions) {
+    if (snapshot.point_range(saved.first_point, saved.point_count) == nullptr) {
+      return false;
+    }
+  }
+  for (snapshot_unit const& saved : snapshot.units()) {
+    if ((saved.archetype >= all_unit_archetypes.size()) || (saved.team >= teams.size()) ||
+        (saved.legion >= teams[saved.team].legion_count) || (saved.status > DYING)) {
+      return false;
+    }
+  }
+  for (snapshot_threat const& saved : snapshot.threats()) {
+    if ((saved.kind != snapshot_threat_kind::point) || (saved.allegiance < -1) ||
+        (saved.allegiance >= static_cast<int32_t>(teams.size())) || (saved.image.texture >= texture_count)) {
+      return false;
+    }
+  }
+  for (snapshot_obstacle const& saved : snapshot.obstacles()) {
+    bool shape_ok = (saved.kind == snapshot_obstacle_kind::circular) ? (saved.radius > 0.0f) :
+      ((saved.kind == snapshot_obstacle_kind::polygonal) && (snapshot.point_range(saved.first_point, saved.point_count) != nullptr));
+    if (!shape_ok || (saved.image.texture >= texture_count)) {
+      return false;
+    }
+  }
+  generator_type parsed;
+  std::istringstream rng_text(snapshot.rng_state());
+  rng_text >> parsed;
+  return !rng_text.fail();
+}
+
+inline bool world::load_snapshot(world_snapshot const& snapshot) {
+  assert(snapshot.valid());
+  if (!check_snapshot(snapshot)) {
+    fprintf(stderr, "The snapshot does not fit this world\n");
+    return false;
+  }
+  world_snapshot_header const& header = snapshot.header();
+  frame_count = static_cast<long>(header.frame_count);
+  mouse_pos = { header.mouse_x, header.mouse_y };
+  mouse_down = (header.mouse_down != 0);
+  std::istringstream rng_text(snapshot.rng_state());
+  rng_text >> gen;
+
+  auto teams = snapshot.teams();
+  auto legions = snapshot.legions();
+  for (int t = 0; t < teams_layer->child_count(); t++) {
+    team& side = teams_layer->child_at(t);
+    side.remove_all_children();
+    while (side.legion_count() < teams[t].legion_count) {
+      side.create_legion();
+    }
+    for (size_t l = 0; l < side.legion_count(); l++) {
+      snapshot_legion const& saved = legions[teams[t].first_legion + l];
+      vector_2f const* formation = snapshot.point_range(saved.first_point, saved.point_count);
+      side.legion_at(l).order.pos = saved.order_pos;
+      side.legion_at(l).order.formation = precalc_polygon(std::vector<vector_2f>(formation, formation + saved.point_count));
+    }
+  }
+  if (player_first_legion->order.formation.verticies.size() != 0) {
+    player_first_legion_formation->set_veritices(player_first_legion->order.formation.verticies, 2.0f);
+  }
+  if (enemy_first_legion->order.formation.verticies.size() != 0) {
+    enemy_first_legion_formation->set_veritices(enemy_first_legion->order.formation.verticies, 2.0f);
+  }
+
+  // Living units are in the buckets at old_pos, as they would be after their last update.
+  unit_buckets.clear();
+  for (snapshot_unit const& saved : snapshot.units()) {
+    team& side = teams_layer->child_at(static_cast<int>(saved.team));
+    legion* member_of = &(side.legion_at(saved.legion));
+    unit* u;
+    if (saved.archetype == heavy_archetype.id) {
+      u = create_unit<heavy>(*this, side, member_of);
+    } else {
+      u = create_unit<grunt>(*this, side, member_of);
+    }
+    u->status = static_cast<unit_status>(saved.status);
+    u->trans = saved.trans;
+    u->old_pos = saved.old_pos;
+    u->current_health = saved.health;
+    u->current_reload = saved.reload;
+    u->visible = u->is_living();
+    if (u->is_living()) {
+      unit_buckets.add_entry(u->old_pos, u->ref());
+    }
+  }
+
+  threat_layer->remove_all_children();
+  for (snapshot_threat const& saved : snapshot.threats()) {
+    team* allegiance = (saved.allegiance < 0) ? nullptr : &(teams_layer->child_at(saved.allegiance));
+    point_threat* pt = threat_layer->add_orphan(new point_threat(load_sprite(saved.image), saved.damage, saved.velocity, saved.lifetime, allegiance));
+    pt->trans = saved.trans;
+    pt->destroyed = (saved.destroyed != 0);
+  }
+  threat_layer->refill_buckets();
+
+  obstacle_layer->remove_all_obstacles();
+  for (snapshot_obstacle const& saved : snapshot.obstacles()) {
+    obstacle* ob;
+    if (saved.kind == snapshot_obstacle_kind::circular) {
+      ob = new circular_obstacle(saved.radius, load_sprite(saved.image),
+        sharing_polygon(&p_ctx,
+          &static_res.get_vertex_array(static_vertex_array_id::dodecagon),
+          &static_res.get_vertex_array(static_vertex_array_id::dodecagon_border)));
+    } else {
+      vector_2f const* verts = snapshot.point_range(saved.first_point, saved.point_count);
+      ob = new polygonal_obstacle(std::vector<vector_2f>(verts, verts + saved.point_count), load_sprite(saved.image), &p_ctx);
+    }
+    ob->trans = saved.trans;
+    obstacle_layer->add_placed_orphan(ob);
+  }
+  return true;
+}
+
+inline void world::stream_units(std::vector<streamed_unit>& units) {
+  units.clear();
+  for (int t = 0; t < teams_layer->child_count(); t++) {
+    teams_layer->child_at(t).for_each_child([&](unit& u) {
+      units.push_back({ u.handle_slot->index, u.handle_slot->generation, static_cast<uint32_t>(u.type.id), static_cast<uint32_t>(t),
+        u.trans.x, u.trans.y, u.trans.angle, u.current_health, u.is_living() });
+    });
+  }
+}
+
+inline bool world::apply_commands(std::vector<unsigned char> const& commands) {
+  if (commands.size() % sizeof(legion_order_command) != 0) {
+    return false;
+  }
+  for (size_t at = 0; at < commands.size(); at += sizeof(legion_order_command)) {
+    legion_order_command command;
+    std::memcpy(&command, commands.data() + at, sizeof(command));
+    if ((command.team >= static_cast<uint32_t>(teams_layer->child_count())) ||
+        (command.legion >= teams_layer->child_at(static_cast<int>(command.team)).legion_count())) {
+      return false;
+    }
+    teams_layer->child_at(static_cast<int>(command.team)).legion_at(command.legion).order.pos = command.pos;
+  }
+  return true;
+}
+
+inline uint64_t world::state_hash() {
+  static_assert(std::is_trivially_copyable_v<generator_type>, "the generator is hashed by its bytes");
+  fnv1a_hasher hasher;
+  hasher.add_value(static_cast<int64_t>(frame_count));
+  hasher.add_value(gen);
+  for (int t = 0; t < teams_layer->child_count(); t++) {
+    team& side = teams_layer->child_at(t);
+    for (size_t l = 0; l < side.legion_count(); l++) {
+      hasher.add_value(side.legion_at(l).order.pos);
+    }
+    side.for_each_child([&hasher](unit& u) {
+      hasher.add_value(u.type.id);
+      hasher.add_value(u.status);
+      hasher.add_value(u.trans);
+      hasher.add_value(u.current_health);
+      hasher.add_value(u.current_reload);
+    });
+  }
+  for (int i = 0; i < threat_layer->child_count(); i++) {
+    threat& t = threat_layer->child_at(i);
+    hasher.add_value(t.trans);
+    hasher.add_value(t.damage);
+    if (t.kind() == threat_kind::point) {
+      point_threat& pt = static_cast<point_threat&>(t);
+      hasher.add_value(pt.velocity);
+      hasher.add_value(pt.lifetime);
+      hasher.add_value(pt.destroyed);
+    }
+  }
+  for (int i = 0; i < obstacle_layer->child_count(); i++) {
+    hasher.add_value(obstacle_layer->child_at(i).trans);
+  }
+  return hasher.value();
+}
\ No newline at end of file
@@ -15,6 +15,17 @@ class world;
 #include "gl_includes.h"
 #include "space_buckets.h"
 #include "obstacle.h"
+#include "frame_arena.h"
+#include "world_snapshot.h"
+#include "state_stream.h"
+#include "hash.h"
+
+// A lockstep command, moves the order of legion of team to pos.
+struct legion_order_command {
+  uint32_t team;
+  uint32_t legion;
+  vector_2f pos;
+};
 
 class world : public stage {
 
@@ -26,6 +37,9 @@ public:
   bitmap_text_context bt_ctx;
 
 
+  // Scratch memory for anything which only lives until the next update, reset at the top of update.
+  frame_arena arena;
+
   frame_rate_meter frm;
   averaging_timer update_times;
 
@@ -33,12 +47,22 @@ public:
   vector_2f mouse_pos;
   bool mouse_down = false;
 
+  // When false legions keep the orders they are given by apply_commands,
+  // rather than the player's following the mouse and the enemy's circling.
+  bool scripted_orders = true;
+
   /*
   If buckets are too small big units potential fields do not propogate far enough.
   */
   bounds space_bounds{ {0, 0}, {1280, 720} };
   space_buckets<unit_reference, 12, 8> unit_buckets{ space_bounds };
 
+  // Stable handles for units so unit_references survive units being relocated.
+  unit_handle_table unit_handles;
+
+  // Every this many ticks units and threats are re-sorted in memory by the cell they are in.
+  static constexpr long storage_sort_interval = 60;
+
   team* player_team;
   team* enemy_team;
   legion* player_first_legion;
@@ -50,7 +74,7 @@ public:
 
   owning_polygon* tri;
 
-  using explosion_parent = sparse_parent<explosion_effect, 2048>;
+  using explosion_parent = chunked_sparse_parent<explosion_effect, 256>;
 
 
 
@@ -67,7 +91,10 @@ public:
   mono_bitmap_text* frame_rate_text;
   prop_bitmap_text* log_text;
 
-  world(GLFWwindow* win, static_resources& sr, int_keyed_resources& dr);
+  // The seed the generator was made with, all a recording needs besides the inputs to re-run the world.
+  std::array<unsigned int, 4> const seed;
+
+  world(GLFWwindow* win, static_resources& sr, int_keyed_resources& dr, std::array<unsigned int, 4> s = get_seed());
 
   bool update() override;
   
@@ -76,19 +103,65 @@ public:
   void mouse_button_callback(int button, int action, int mods) override;
 
 
-  sprite* world::static_sprite_orphan(static_texture_id id);
-  sprite world::static_sprite(static_texture_id id);
+  sprite* static_sprite_orphan(static_texture_id id);
+  sprite static_sprite(static_texture_id id);
 
   generator_type& get_generator();
 
   void add_explosion(explosion_effect e);
 
-  /*~world() {
-    fprintf(stderr, "World Destructor\n");
-  }*/
+  /*
+  Writes the teams' legions, units, threats, obstacles and the generator to a snapshot,
+  returning false if something in the world can not be saved or the file could not be written.
+  O(n)
+  */
+  bool save_snapshot(char const* filename);
+
+  /*
+  Replaces the world's units, threats and obstacles with the snapshot's and carries on from its tick.
+  The snapshot must have been saved by a world with as many teams and at least as many legions in each,
+  otherwise, or if it is inconsistent, the world is left as it was and false is returned.
+  Effects and the ui are not saved.
+  O(n)
+  */
+  bool load_snapshot(world_snapshot const& snapshot);
+
+  /*
+  Fills units with every unit as a state_stream_encoder takes them.
+  O(n)
+  */
+  void stream_units(std::vector<streamed_unit>& units);
+
+  /*
+  Applies a packet of legion_order_commands, returning false if it is malformed.
+  O(n)
+  */
+  bool apply_commands(std::vector<unsigned char> const& commands);
+
+  /*
+  A checksum of everything that decides how the simulation carries on: units, legions' orders, threats,
+  obstacles and the generator. Two worlds with the same checksum after a tick are the same as far as lockstep goes.
+  It is recomputed from scratch on every call so a change made anywhere in the update can not be missed,
+  one pass over the state costs far less than the update it follows.
+  O(n)
+  */
+  uint64_t state_hash();
+
+  // The layers are children of the stage base class which would outlive unit_handles, so units are deleted first.
+  ~world() {
+    remove_all_children();
+    //fprintf(stderr, "World Destructor\n");
+  }
 
 private:
+  void sort_storage();
+  bool check_snapshot(world_snapshot const& snapshot);
+  int team_index(team const* t);
+  bool save_sprite(sprite const& s, snapshot_sprite& saved);
+  sprite load_sprite(snapshot_sprite const& saved);
   vector_2f window_to_world(double xpos, double ypos);
   generator_type gen;
+
+public:
   static std::array<unsigned int, 4> get_seed();
 };
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "2d_math.h"
+#include "atlas_layout.h"
+#include "mapped_file.h"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// A world snapshot is everything the simulation needs to carry on from a tick: teams' legions and their orders,
+// units, threats, obstacles and the generator's state. Loading one maps the file and builds the world
+// straight from the records in the mapping, so a perf run can start at a big battle without simulating up to it.
+// Snapshots are made by world::save_snapshot and loaded by world::load_snapshot, see world.h.
+//
+// Layout, all integers and floats in the saver's native byte order:
+//   world_snapshot_header
+//   each section's records, starting at a multiple of world_snapshot_alignment, in world_snapshot_section order
+// Records refer to each other by index: legions by their index in their team, teams by their index in
+// the teams layer and formations and polygons by a range of the points section.
+
+constexpr uint32_t world_snapshot_version = 1;
+constexpr size_t world_snapshot_alignment = 16;
+
+enum class world_snapshot_section : uint32_t {
+  teams,
+  legions,
+  units,
+  threats,
+  obstacles,
+  points,
+  rng_state, // the generator written with operator<<, as text
+  COUNT
+};
+
+struct world_snapshot_range {
+  uint64_t offset; // from the start of the file
+  uint64_t count; // records, or bytes for rng_state
+};
+
+struct world_snapshot_header {
+  char magic[4]; // "WMSS"
+  uint32_t version;
+  int64_t frame_count;
+  float mouse_x;
+  float mouse_y;
+  uint32_t mouse_down;
+  uint32_t reserved;
+  std::array<world_snapshot_range, static_cast<size_t>(world_snapshot_section::COUNT)> sections;
+};
+
+struct snapshot_team {
+  uint32_t first_legion; // into the legions section
+  uint32_t legion_count;
+};
+
+struct snapshot_legion {
+  vector_2f order_pos;
+  uint32_t first_point; // the order's formation, into the points section
+  uint32_t point_count;
+};
+
+struct snapshot_unit {
+  uint32_t archetype; // unit_archetype::id
+  uint32_t team;
+  uint32_t legion; // index in the unit's team
+  uint32_t status; // a unit_status
+  trans_state trans;
+  vector_2f old_pos; // where the unit is in world::unit_buckets while living
+  int32_t health;
+  int32_t reload;
+};
+
+struct snapshot_sprite {
+  uint32_t texture; // a static_texture_id, snapshots only hold sprites drawn from the static atlas
+  uv_rect uv;
+  std::array<float, 4> mask_color;
+  std::array<float, 9> local_trans;
+};
+
+enum class snapshot_threat_kind : uint32_t {
+  point
+};
+
+struct snapshot_threat {
+  snapshot_threat_kind kind;
+  int32_t allegiance; // a team index or -1 for none
+  trans_state trans;
+  vector_2f velocity;
+  int32_t damage;
+  int32_t lifetime;
+  uint32_t destroyed;
+  snapshot_sprite image;
+};
+
+enum class snapshot_obstacle_kind : uint32_t {
+  circular,
+  polygonal
+};
+
+struct snapshot_obstacle {
+  snapshot_obstacle_kind kind;
+  float radius; // circular only
+  uint32_t first_point; // polygonal only, into the points section
+  uint32_t point_count; // polygonal only
+  trans_state trans;
+  snapshot_sprite image;
+};
+
+static_assert(sizeof(world_snapshot_header) % world_snapshot_alignment == 0, "sections must stay aligned");
+static_assert(std::is_trivially_copyable_v<trans_state> && std::is_trivially_copyable_v<vector_2f> && std::is_trivially_copyable_v<uv_rect>, "records are copied as bytes");
+static_assert(std::is_trivially_copyable_v<snapshot_unit> && std::is_trivially_copyable_v<snapshot_threat> &&
+  std::is_trivially_copyable_v<snapshot_obstacle>, "records are copied as bytes");
+
+// A section of a mapped snapshot, valid as long as the world_snapshot is.
+template<typename T>
+struct snapshot_records {
+  T const* records = nullptr;
+  size_t count = 0;
+
+  T const* begin() const {
+    return records;
+  }
+
+  T const* end() const {
+    return records + count;
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  T const& operator[](size_t idx) const {
+    assert(idx < count);
+    return records[idx];
+  }
+};
+
+// A snapshot being built up in memory, see world::save_snapshot.
+class world_snapshot_writer {
+public:
+  int64_t frame_count = 0;
+  vector_2f mouse_pos{ 0.0f, 0.0f };
+  bool mouse_down = false;
+  std::vector<snapshot_team> teams;
+  std::vector<snapshot_legion> legions;
+  std::vector<snapshot_unit> units;
+  std::vector<snapshot_threat> threats;
+  std::vector<snapshot_obstacle> obstacles;
+  std::vector<vector_2f> points;
+  std::string rng_state;
+
+  /*
+  Appends points to the points section returning the index of the first.
+  O(n)
+  */
+  uint32_t add_points(std::vector<vector_2f> const& added) {
+    uint32_t first = static_cast<uint32_t>(points.size());
+    points.insert(points.end(), added.begin(), added.end());
+    return first;
+  }
+
+  /*
+  Writes the snapshot, returning false if the file could not be written.
+  O(n)
+  */
+  bool write(char const* filename) const {
+    std::array<std::pair<void const*, uint64_t>, static_cast<size_t>(world_snapshot_section::COUNT)> data{ {
+      { teams.data(), teams.size() * sizeof(snapshot_team) },
+      { legions.data(), legions.size() * sizeof(snapshot_legion) },
+      { units.data(), units.size() * sizeof(snapshot_unit) },
+      { threats.data(), threats.size() * sizeof(snapshot_threat) },
+      { obstacles.data(), obstacles.size() * sizeof(snapshot_obstacle) },
+      { points.data(), points.size() * sizeof(vector_2f) },
+      { rng_state.data(), rng_state.size() }
+    } };
+    std::array<uint64_t, static_cast<size_t>(world_snapshot_section::COUNT)> counts{ {
+      teams.size(), legions.size(), units.size(), threats.size(), obstacles.size(), points.size(), rng_state.size()
+    } };
+
+    world_snapshot_header header{};
+    std::memcpy(header.magic, "WMSS", 4);
+    header.version = world_snapshot_version;
+    header.frame_count = frame_count;
+    header.mouse_x = mouse_pos.x;
+    header.mouse_y = mouse_pos.y;
+    header.mouse_down = mouse_down ? 1 : 0;
+    uint64_t offset = sizeof(world_snapshot_header);
+    for (size_t i = 0; i < data.size(); i++) {
+      offset = align_up(offset);
+      header.sections[i] = { offset, counts[i] };
+      offset += data[i].second;
+    }
+
+    FILE* out = fopen(filename, "wb");
+    if (out == nullptr) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+      return false;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    uint64_t written = sizeof(world_snapshot_header);
+    unsigned char const zeros[world_snapshot_alignment] = {};
+    for (size_t i = 0; i < data.size(); i++) {
+      uint64_t padding = header.sections[i].offset - written;
+      ok = ok && (fwrite(zeros, 1, padding, out) == padding);
+      ok = ok && (fwrite(data[i].first, 1, data[i].second, out) == data[i].second);
+      written = header.sections[i].offset + data[i].second;
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      fprintf(stderr, "Could not write file %s\n", filename);
+    }
+    return ok;
+  }
+
+private:
+  static uint64_t align_up(uint64_t offset) {
+    return (offset + (world_snapshot_alignment - 1)) / world_snapshot_alignment * world_snapshot_alignment;
+  }
+};
+
+// A mapped snapshot, its sections point into the mapping.
+// Only the layout is checked here, indices between records are checked by world::load_snapshot.
+class world_snapshot {
+private:
+  mapped_file file;
+
+  static constexpr std::array<size_t, static_cast<size_t>(world_snapshot_section::COUNT)> record_sizes{ {
+    sizeof(snapshot_team), sizeof(snapshot_legion), sizeof(snapshot_unit), sizeof(snapshot_threat),
+    sizeof(snapshot_obstacle), sizeof(vector_2f), 1
+  } };
+
+  bool check_layout() const {
+    if (file.size() < sizeof(world_snapshot_header)) {
+      return false;
+    }
+    world_snapshot_header const& h = header();
+    if ((std::memcmp(h.magic, "WMSS", 4) != 0) || (h.version != world_snapshot_version)) {
+      return false;
+    }
+    for (size_t i = 0; i < h.sections.size(); i++) {
+      world_snapshot_range const& range = h.sections[i];
+      if ((range.offset < sizeof(world_snapshot_header)) || (range.offset % world_snapshot_alignment != 0) ||
+          (range.offset > file.size()) || (range.count > (file.size() - range.offset) / record_sizes[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template<typename T>
+  snapshot_records<T> section(world_snapshot_section s) const {
+    assert(sizeof(T) == record_sizes[static_cast<size_t>(s)]);
+    world_snapshot_range const& range = header().sections[static_cast<size_t>(s)];
+    return { reinterpret_cast<T const*>(file.data() + range.offset), static_cast<size_t>(range.count) };
+  }
+
+public:
+  /*
+  Maps the snapshot, the snapshot is invalid if the file is missing or is not a snapshot of this version.
+  O(1)
+  */
+  explicit world_snapshot(char const* filename) : file(filename) {
+    if (!file.report(filename)) {
+      return;
+    }
+    if (!check_layout()) {
+      fprintf(stderr, "%s is not a world snapshot of version %u\n", filename, world_snapshot_version);
+      file = mapped_file();
+    }
+  }
+
+  // do not copy or assign, sections point into the mapping
+  world_snapshot(world_snapshot&) = delete;
+  world_snapshot& operator=(const world_snapshot&) = delete;
+
+  bool valid() const {
+    return file.valid();
+  }
+
+  world_snapshot_header const& header() const {
+    assert(file.size() >= sizeof(world_snapshot_header));
+    return *reinterpret_cast<world_snapshot_header const*>(file.data());
+  }
+
+  snapshot_records<snapshot_team> teams() const {
+    return section<snapshot_team>(world_snapshot_section::teams);
+  }
+
+  snapshot_records<snapshot_legion> legions() const {
+    return section<snapshot_legion>(world_snapshot_section::legions);
+  }
+
+  snapshot_records<snapshot_unit> units() const {
+    return section<snapshot_unit>(world_snapshot_section::units);
+  }
+
+  snapshot_records<snapshot_threat> threats() const {
+    return section<snapshot_threat>(world_snapshot_section::threats);
+  }
+
+  snapshot_records<snapshot_obstacle> obstacles() const {
+    return section<snapshot_obstacle>(world_snapshot_section::obstacles);
+  }
+
+  snapshot_records<vector_2f> points() const {
+    return section<vector_2f>(world_snapshot_section::points);
+  }
+
+  /*
+  The points first to first + count, or null if they are not all in the points section.
+  O(1)
+  */
+  vector_2f const* point_range(uint32_t first, uint32_t count) const {
+    snapshot_records<vector_2f> all = points();
+    if ((first > all.size()) || (count > all.size() - first)) {
+      return nullptr;
+    }
+    return all.records + first;
+  }
+
+  std::string rng_state() const {
+    snapshot_records<char> text = section<char>(world_snapshot_section::rng_state);
+    return std::string(text.begin(), text.end());
+  }
+};